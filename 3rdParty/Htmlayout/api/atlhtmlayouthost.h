@@ -60,14 +60,14 @@ public:
 	{
 		T* pT = static_cast<T*>(this);
 		ATLASSERT(::IsWindow(pT->m_hWnd));
-		::HTMLayoutWindowAttachEventHandler(pT->m_hWnd, &htmlayout::event_handler::element_proc, lpEventHandler, subscription);
+		::HTMLayoutWindowAttachEventHandler(pT->m_hWnd, lpEventHandler->event_proc(), lpEventHandler, subscription);
 	}
 
 	VOID DetachEventHandler(htmlayout::event_handler *lpEventHandler, UINT subscription = HANDLE_ALL)
 	{
 		T* pT = static_cast<T*>(this);
 		ATLASSERT(::IsWindow(pT->m_hWnd));
-		::HTMLayoutWindowDetachEventHandler(pT->m_hWnd, &htmlayout::event_handler::element_proc, lpEventHandler);
+		::HTMLayoutWindowDetachEventHandler(pT->m_hWnd, lpEventHandler->event_proc(), lpEventHandler);
 	}
 
 	virtual LRESULT OnHtmlNotify(UINT uMsg, WPARAM wParam, LPARAM lParam)
@@ -0,0 +1,163 @@
+#ifndef __aux_hash_h__
+#define __aux_hash_h__
+
+/*
+ * Terra Informatica Sciter and HTMLayout Engines
+ * http://terrainformatica.com/sciter, http://terrainformatica.com/htmlayout
+ *
+ * name hashing and read-only name tables.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+/**\file
+ * \brief name hashing and read-only name tables
+ **/
+
+/*
+
+  aux::name_hash() - FNV-1a hash of zero terminated or sized string
+  aux::name_table<T> - open addressing table: name -> T*.
+                       Built once, looked up without locks.
+  aux::publish_ptr() - lock-free publication of pointer built by one of threads.
+
+*/
+
+#include <string.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#endif
+
+namespace aux
+{
+  inline unsigned name_hash( const char* s )
+  {
+    unsigned h = 2166136261u;
+    for( ; *s; ++s ) { h ^= (unsigned char)*s; h *= 16777619u; }
+    return h;
+  }
+  inline unsigned name_hash( const char* s, size_t length )
+  {
+    unsigned h = 2166136261u;
+    for( const char* end = s + length; s < end; ++s ) { h ^= (unsigned char)*s; h *= 16777619u; }
+    return h;
+  }
+  inline unsigned name_hash( const wchar_t* s )
+  {
+    unsigned h = 2166136261u;
+    for( ; *s; ++s ) { h ^= (unsigned)*s; h *= 16777619u; }
+    return h;
+  }
+
+  /** name_table - open addressing hash table of named objects.
+   *  T is not owned. Names must be pointers to static strings.
+   *  Table is filled once (normally at startup) and then used for lookups
+   *  that do no writes, so it can be read by any number of threads.
+   **/
+  template <typename T>
+    class name_table
+    {
+      struct slot
+      {
+        unsigned    hash;
+        const char* name;
+        T*          value;
+      };
+      slot*    _slots;
+      unsigned _mask;
+      unsigned _count;
+
+      name_table(const name_table&);
+      name_table& operator=(const name_table&);
+
+      void grow()
+      {
+        slot*    old = _slots;
+        unsigned old_size = _slots? _mask + 1: 0;
+        unsigned size = old_size? old_size * 2: 16;
+        _slots = new slot[size];
+        memset(_slots, 0, sizeof(slot) * size);
+        _mask = size - 1;
+        _count = 0;
+        for( unsigned n = 0; n < old_size; ++n )
+          if( old[n].name )
+            put(old[n].hash, old[n].name, old[n].value);
+        delete[] old;
+      }
+      void put( unsigned h, const char* name, T* value )
+      {
+        unsigned i = h & _mask;
+        while( _slots[i].name ) i = (i + 1) & _mask;
+        _slots[i].hash = h; _slots[i].name = name; _slots[i].value = value;
+        ++_count;
+      }
+
+    public:
+      name_table(): _slots(0), _mask(0), _count(0) {}
+      ~name_table() { delete[] _slots; }
+
+      /** adds named object. returns false if such name is already there. **/
+      bool insert( const char* name, T* value )
+      {
+        if( find(name) )
+          return false;
+        if( !_slots || (_count + 1) * 2 > _mask + 1 ) // load factor <= 0.5
+          grow();
+        put( name_hash(name), name, value );
+        return true;
+      }
+
+      T* find( const char* name ) const
+      {
+        if( !_slots ) return 0;
+        unsigned h = name_hash(name);
+        for( unsigned i = h & _mask; _slots[i].name; i = (i + 1) & _mask )
+          if( _slots[i].hash == h && strcmp(_slots[i].name, name) == 0 )
+            return _slots[i].value;
+        return 0;
+      }
+
+      /** the same but for sized names, e.g. slices **/
+      T* find( const char* name, size_t length ) const
+      {
+        if( !_slots ) return 0;
+        unsigned h = name_hash(name, length);
+        for( unsigned i = h & _mask; _slots[i].name; i = (i + 1) & _mask )
+          if( _slots[i].hash == h && strncmp(_slots[i].name, name, length) == 0 && _slots[i].name[length] == 0 )
+            return _slots[i].value;
+        return 0;
+      }
+
+      unsigned size() const { return _count; }
+    };
+
+  /** publish_ptr - stores value into location if it is still equal to expected.
+   *  Returns true if the value was published. Full memory barrier.
+   **/
+  template <typename T>
+    inline bool publish_ptr( T* volatile* location, T* value, T* expected )
+    {
+#if defined(_WIN32)
+      return InterlockedCompareExchangePointer( (PVOID volatile*)location, value, expected ) == expected;
+#else
+      return __sync_bool_compare_and_swap( location, expected, value );
+#endif
+    }
+  /** read of pointer published by publish_ptr **/
+  template <typename T>
+    inline T* acquire_ptr( T* volatile* location )
+    {
+#if defined(_MSC_VER)
+      return *location; // volatile read has acquire semantics in VC
+#else
+      return __atomic_load_n( location, __ATOMIC_ACQUIRE );
+#endif
+    }
+
+}
+
+#endif
@@ -422,7 +422,7 @@ template <typename T >
              result = result*base + value;
              cp++;
      }
-     span.length = unsigned int(cp - span.start);
+     span.length = (unsigned int)(cp - span.start);
      return result;
   }
 
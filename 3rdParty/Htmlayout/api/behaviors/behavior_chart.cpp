@@ -1,5 +1,7 @@
 #include "behavior_aux.h"
 #include "htmlayout_canvas.hpp"
+#include "htmlayout_timers.hpp"
+#include "htmlayout_methods.hpp"
 
 #include <math.h>
 #include <time.h>
@@ -37,7 +39,7 @@ struct chart: public canvas
       super::attached(he);
       dom::element el = he;
       if(el.visible())
-        HTMLayoutSetTimer( he, 10 ); // animation timer      
+        timers::set( he, this, 10 ); // animation timer      
 
       // get data for our chart:
       const wchar_t* data_selector = el.get_attribute("data");
@@ -52,25 +54,29 @@ struct chart: public canvas
   
     virtual void detached  (HELEMENT he ) 
     { 
-      HTMLayoutSetTimer( he, 0 ); // remove timer if any
-      data.clear();
+      data.clear(); // timer, if any, is removed by timers service
       super::detached(he);
     } 
 
-    // demonstrates calls from CSSS! script
-    virtual BOOL on_script_call(HELEMENT he, LPCSTR name, UINT argc, json::value* argv, json::value& retval) 
+    // demonstrates calls from CSSS! script: self.animate() or self.animate(n)
+    static script_methods<chart> methods;
+
+    virtual BOOL handle_script_call(HELEMENT he, XCALL_PARAMS& params) 
     { 
-      if(aux::streq(name, "animate"))
-      {
-        if( argc == 1 && argv[0].is_int() ) // we accept single parameter - n - number of steps.
-          steps = argv[0].get(32);
+      return methods.call(this, he, params);
+    }
 
-        // simply call initial animation
-        step = 0;
-        attached(he);
-        return TRUE; // done, method found
-      }
-      return FALSE; 
+    void animate(HELEMENT he)
+    {
+      // simply call initial animation
+      step = 0;
+      attached(he);
+    }
+    void animate_steps(HELEMENT he, const json::value& n) // n - number of steps.
+    {
+      if( n.is_int() )
+        steps = n.get(32);
+      animate(he);
     }
 
 
@@ -99,12 +105,12 @@ struct chart: public canvas
         if(reason /* shown */)
         {
           step = 0;
-          HTMLayoutSetTimer( he, 10 ); // set 10 milliseconds timer 
+          timers::set( he, this, 10 ); // set 10 milliseconds timer 
         }
         else
         {
           step = steps - 1;
-          HTMLayoutSetTimer( he, 0 ); // remove timer
+          timers::kill( he, this ); // remove timer
         }
       }
       return false;
@@ -190,6 +196,14 @@ struct chart: public canvas
    
 };
 
+static script_methods<chart>::def chart_method_defs[] = 
+{
+  { "animate", script_method(&chart::animate) },
+  { "animate", script_method(&chart::animate_steps) },
+  { 0, 0 }
+};
+script_methods<chart> chart::methods( chart_method_defs );
+
 // instantiating and attaching it to the global list
 canvas_factory<chart> graphin_chart_factory("chart");
 
@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_timers.hpp"
 
 #include <math.h>
 #include <time.h>
@@ -24,14 +25,9 @@ struct clock: public behavior
     { 
       dom::element el = he;
       if(el.visible())
-        HTMLayoutSetTimer( he, 1000 ); // set one second timer      
+        timers::set( he, this, 1000 ); // set one second timer      
     } 
    
-    virtual void detached  (HELEMENT he ) 
-    { 
-      HTMLayoutSetTimer( he, 0 ); // remove timer
-    } 
-
     virtual BOOL handle_mouse  (HELEMENT he, MOUSE_PARAMS& params ) 
     {
       if(params.cmd == MOUSE_MOVE)
@@ -51,9 +47,9 @@ struct clock: public behavior
       if( type == VISIUAL_STATUS_CHANGED )
       {
         if(reason /* shown */)
-          HTMLayoutSetTimer( he, 1000 ); // set one second timer      
+          timers::set( he, this, 1000 ); // set one second timer      
         else
-          HTMLayoutSetTimer( he, 0 ); // remove timer
+          timers::kill( he, this ); // remove timer
       }
       return false;
     }
@@ -1,5 +1,6 @@
 #include "behavior_aux.h"
 #include "htmlayout_canvas.hpp"
+#include "htmlayout_timers.hpp"
 
 #include <math.h>
 #include <time.h>
@@ -31,13 +32,12 @@ struct graphin_clock: public canvas
       super::attached(he);
       dom::element el = he;
       if(el.visible())
-        HTMLayoutSetTimer( he, 1000 ); // set one second timer      
+        timers::set( he, this, 1000 ); // set one second timer      
     } 
    
     virtual void detached  (HELEMENT he ) 
     { 
-      HTMLayoutSetTimer( he, 0 ); // remove timer
-      super::detached(he);
+      super::detached(he); // timer is removed by timers service
     } 
 
     // for set cursor testing purposes:
@@ -64,9 +64,9 @@ struct graphin_clock: public canvas
       if( type == VISIUAL_STATUS_CHANGED )
       {
         if(reason /* shown */)
-          HTMLayoutSetTimer( he, 1000 ); // set one second timer      
+          timers::set( he, this, 1000 ); // set one second timer      
         else
-          HTMLayoutSetTimer( he, 0 ); // remove timer
+          timers::kill( he, this ); // remove timer
       }
       return false;
     }
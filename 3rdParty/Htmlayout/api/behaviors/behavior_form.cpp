@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_pool.hpp"
 
 // OBSOLETE
 // OBSOLETE
@@ -28,7 +29,7 @@ TYPICAL USE CASE and SAMPLE:
 // Each form has unique form_instance object assosiated with the element. 
 // Reason: each form has its own collection of initial_values (to be reset).
 
-struct form_instance: public event_handler
+struct form_instance: public event_handler, public pooled<form_instance>
 {
     named_values  initial_values;
     wchar_t       uri[2048];
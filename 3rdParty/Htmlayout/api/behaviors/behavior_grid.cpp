@@ -1,4 +1,6 @@
 #include "behavior_aux.h"
+#include "htmlayout_traversal.hpp"
+#include "htmlayout_sort.hpp"
 
 namespace htmlayout 
 {
@@ -34,12 +36,13 @@ struct grid: public behavior
        dom::element table = he;
        assert( aux::streq(table.get_element_type(), "table") ); // must be table.
 #endif
+       dom::attribute_cache::enable(he); // fixedrows, multiple
     } 
 
     /** is it multiple selectable? **/
 	  bool is_multiple (const dom::element& table)
     {
-		  return table.get_attribute ("multiple") != 0;
+		  return dom::attribute_cache::get_bool(table, "multiple");
 	  }
 
     /** Click on column header (fixed row).
@@ -96,21 +99,17 @@ struct grid: public behavior
 
     dom::element target_row(const dom::element& table, const dom::element& target)
     {
-      if( !target.is_valid() || target.parent() == table)
-        return target;
-      return target_row(table,target.parent());
+      return dom::closest(target, dom::child_of(table));
     }
 
     dom::element target_header(const dom::element& header_row, const dom::element& target)
     {
-      if( !target.is_valid() || target.parent() == header_row)
-        return target;
-      return target_header(header_row,target.parent());
+      return dom::closest(target, dom::child_of(header_row));
     }
 
     int fixed_rows( const dom::element& table )
     {
-      return table.get_attribute_int("fixedrows",0);
+      return dom::attribute_cache::get_int(table, "fixedrows", 0);
     }
 	
 	  void set_checked_row( dom::element& table, dom::element& row, bool toggle = false )
@@ -434,34 +433,12 @@ struct sortable_grid: public grid
 
   }
 
-  struct row_sorter: public dom::element::comparator
-  {
-    int column_no;
-
-    row_sorter( int col_no ): column_no(col_no) {}
-
-    virtual int compare(const htmlayout::dom::element& r1, const htmlayout::dom::element& r2)
-    {
-      if( !r1.is_valid() || !r2.is_valid() )
-        return 0;
-
-      htmlayout::dom::element c1 = r1.child(column_no);
-      htmlayout::dom::element c2 = r2.child(column_no);
-
-      const wchar_t* t1 = c1.text();
-      const wchar_t* t2 = c2.text();
-      if( !t1 || !t2 ) return 0;
-
-      return wcscmp(t1,t2);
-    }
-  };
-
+  // text of each cell in the column is fetched once, 
+  // rows are reordered by minimal number of swaps.
   void sort_rows( dom::element& table, int column_no )
   {
-    row_sorter rs( column_no );
-
     int fr = fixed_rows( table );
-    table.sort(rs,fr);
+    dom::sort_children_by_text( table, column_no, fr );
   }
 };
 
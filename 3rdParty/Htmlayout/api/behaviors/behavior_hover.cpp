@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_timers.hpp"
 
 /*
 BEHAVIOR: hover-click
@@ -41,13 +42,13 @@ namespace htmlayout
                 return false;
 
               UINT delay = el.get_attribute_int("delay", ::GetDoubleClickTime() + 10);
-              el.start_timer(delay);
+              timers::set(he, this, delay);
             }
             break;
           case MOUSE_LEAVE: 
             {
               dom::element el = he;
-              el.stop_timer();            
+              timers::kill(he, this);
               HTMLayoutHidePopup(el.find_first(":popup"));
             }
             break;
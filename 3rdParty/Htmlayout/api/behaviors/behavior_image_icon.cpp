@@ -1,5 +1,6 @@
 
 #include "behavior_aux.h"
+#include "htmlayout_pool.hpp"
 
 //////////////////////////////////////////////////////////////////////////
 //Format in ico file
@@ -62,7 +63,7 @@ typedef struct
 
 namespace htmlayout 
 {
-struct image_icon: public event_handler
+struct image_icon: public event_handler, public pooled<image_icon>
 {
     // ctor
     image_icon(): event_handler(HANDLE_DRAW | HANDLE_BEHAVIOR_EVENT | HANDLE_DATA_ARRIVED | HANDLE_INITIALIZATION ), miIconX(0), miIconY(0), mhIcon(0) {}
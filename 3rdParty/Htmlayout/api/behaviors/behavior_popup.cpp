@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_traversal.hpp"
 
 #include <commctrl.h> // for tooltip support
 
@@ -15,13 +16,9 @@ TYPICAL USE CASE:
 SAMPLE:
 */
 
-bool belongs_to( dom::element parent, dom::element child )
+bool belongs_to( const dom::element& parent, const dom::element& child )
 {
-  if( !child.is_valid()) 
-    return false;
-  if( parent == child )
-    return true;
-  return belongs_to( parent, child.parent() );
+  return parent.is_valid() && dom::is_inside( child, parent );
 }
 
 struct dropdown: public behavior
@@ -1,16 +1,17 @@
 #include "behavior_aux.h"
+#include "htmlayout_coalesce.hpp"
 
 namespace htmlayout 
 {
  
 /** behavior:scroller, 
- * another way of scrolling  
+ * another way of scrolling, scrolls at most once per tick while mouse moves
  **/
     
-struct scroller: public behavior
+struct scroller: public coalesced_input<behavior>
 {
     // ctor
-    scroller(const char* name = "scroller"): behavior(HANDLE_MOUSE, name) {}
+    scroller(const char* name = "scroller"): coalesced_input<behavior>(HANDLE_MOUSE, name) {}
     
     virtual void attached  (HELEMENT he ) 
     { 
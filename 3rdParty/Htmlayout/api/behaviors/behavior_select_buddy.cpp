@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_batch.hpp"
 
 
 namespace htmlayout 
@@ -115,25 +116,27 @@ struct select_buddy: public behavior
       selected_cb options;
       select_src.find_all(&options, selected_only?"option:checked":"option"); // select all currently selected <option>s
 
-      // move elements from one container to another
+      // move elements from one container to another,
+      // both <select>s get updated once when batch goes out of scope.
+      dom::batch moves;
       if(from_src_to_dst)
         for( int n = options.elements.size() - 1; n >= 0 ; --n )
         {
           dom::element& opt = options.elements[n];
           unsigned int idx = opt.index();
           wchar_t buf[32]; swprintf(buf,L"%d",idx);
-          opt.set_attribute("-srcindex",buf);
-          select_dst.insert( opt, 0 );
+          moves.set_attribute(opt,"-srcindex",buf);
+          moves.insert( select_dst, opt, 0 );
         }
       else
         for( unsigned int n = 0; n < options.elements.size() ; ++n )
         {
           int i = _wtoi(options.elements[n].get_attribute("-srcindex"));
-          select_dst.insert( options.elements[n], i );
+          moves.insert( select_dst, options.elements[n], i );
         }
 
-      select_src.update();
-      select_dst.update();
+      moves.update(select_src);
+      moves.update(select_dst);
       return true;
     }
   
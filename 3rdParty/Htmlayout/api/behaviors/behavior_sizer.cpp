@@ -1,18 +1,20 @@
 #include "behavior_aux.h"
+#include "htmlayout_pool.hpp"
+#include "htmlayout_coalesce.hpp"
 
 namespace htmlayout 
 {
  
 /** behavior:sizer, 
- * allows to resize elements 
+ * allows to resize elements, resizes at most once per tick while mouse moves
  **/
     
-struct sizer: public event_handler
+struct sizer: public coalesced_input< behavior_impl<sizer> >, public pooled<sizer>
 {
     bool tracking;
     SIZE delta;
-    // ctor
-    sizer(const char* name = "sizer"): event_handler(HANDLE_MOUSE), tracking(false) {}
+    // ctor, subscribed to HANDLE_MOUSE by behavior_impl
+    sizer(const char* name = "sizer"): tracking(false) {}
     
     virtual void attached  (HELEMENT he ) 
     { 
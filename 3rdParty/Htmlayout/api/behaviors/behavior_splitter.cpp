@@ -1,4 +1,5 @@
 #include "behavior_aux.h"
+#include "htmlayout_coalesce.hpp"
 
 namespace htmlayout 
 {
@@ -35,10 +36,10 @@ bool is_spring(const wchar_t* val)
   return val[length-2] == '%' && val[length-1] == '%';
 }
 
-struct splitter: public behavior
+struct splitter: public coalesced_input<behavior>
 {
-    // ctor
-    splitter(): behavior(HANDLE_MOUSE, "splitter") {}
+    // ctor, moves are delivered (and parent is updated) at most once per tick
+    splitter(): coalesced_input<behavior>(HANDLE_MOUSE, "splitter") {}
 
     int pressed_offset;
     int previous_value;
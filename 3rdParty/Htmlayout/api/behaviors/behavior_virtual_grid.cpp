@@ -1,4 +1,6 @@
 #include "behavior_aux.h"
+#include "htmlayout_traversal.hpp"
+#include "htmlayout_pool.hpp"
 
 namespace htmlayout 
 {
@@ -11,18 +13,24 @@ namespace htmlayout
  *
  **/
     
-struct virtual_grid: public event_handler
+struct virtual_grid: public behavior_impl<virtual_grid>, public pooled<virtual_grid>
 {
     int first_row_idx;
     int num_rows;
+    UINT first_changed_row; // rows that got new records on scroll, see get_rows_data()
+    UINT last_changed_row;
+    bool rows_rotated;
 
-    // ctor
-    virtual_grid(): event_handler(HANDLE_MOUSE | HANDLE_KEY | HANDLE_FOCUS | HANDLE_SCROLL | HANDLE_BEHAVIOR_EVENT) {}
+    // ctor, mouse, key, scroll and behavior events are subscribed by behavior_impl from handlers below,
+    // HANDLE_FOCUS makes the grid focusable.
+    virtual_grid(): behavior_impl<virtual_grid>(HANDLE_FOCUS) {}
     
     virtual void attached  (HELEMENT he ) 
     {
       first_row_idx = 0;
       num_rows = 0;
+      rows_rotated = false;
+      dom::attribute_cache::enable(get_table(he)); // fixedrows
       dom::element self = he;
       self.post_event(INIT_DATA_VIEW);
 
@@ -46,6 +54,8 @@ struct virtual_grid: public event_handler
     // this is the case when element is a data source and a view at the same time.
     
     // Another solution is to derive your own behavior from this one and override get_rows_data completely.
+    // After a scroll rows that stay visible already show their records, only rows 
+    // changed_rows(he, ...) need new content - the override may fill just them.
     
     virtual void get_rows_data( HELEMENT he )
     {
@@ -56,14 +66,73 @@ struct virtual_grid: public event_handler
       drp.totalRecords = num_rows;
       drp.firstRowIdx = fixed_rows(tbl);
       drp.lastRowIdx = tbl.children_count() - 1;
+      changed_rows(he, drp.firstChangedRowIdx, drp.lastChangedRowIdx);
+      bool partial = rows_rotated;
+      rows_rotated = false;
 
       dom::element self = he;
       self.send_event(ROWS_DATA_REQUEST, (UINT_PTR)&drp,tbl);
 
+      bool moved = int(drp.firstRecord) != first_row_idx;
       first_row_idx = drp.firstRecord;
       num_rows      = drp.totalRecords;
+
+      // the source has shown other records than requested (e.g. clamped to its end):
+      // rows that were rotated in advance do not show their records, refill all of them
+      if( moved && partial )
+        get_rows_data(he);
     }
 
+    // rows that need new content in get_rows_data(), all data rows unless the grid has just scrolled
+    void changed_rows( HELEMENT he, UINT& first, UINT& last )
+    {
+      if( rows_rotated )
+      {
+        first = first_changed_row;
+        last = last_changed_row;
+      }
+      else
+      {
+        dom::element tbl = get_table(he);
+        first = fixed_rows(tbl);
+        last = tbl.children_count() - 1;
+      }
+    }
+
+    // Scroll by delta records that is less than number of rows: rows that stay visible 
+    // are moved in the DOM to their new positions, rows that get new records are returned.
+    // Returns false if nothing can be reused.
+    bool rotate_rows( dom::element& tbl, int delta, UINT& first_changed, UINT& last_changed )
+    {
+      int first = fixed_rows(tbl);
+      int last = int(tbl.children_count()) - 1;
+      int n = last - first + 1;
+      if( delta == 0 || delta >= n || -delta >= n ) 
+        return false;
+      if( delta > 0 ) // top rows go down
+      {
+        for( int i = 0; i < delta; ++i )
+          tbl.insert( tbl.child(first), last ); // disconnected first, so it lands at the end
+        first_changed = last - delta + 1;
+        last_changed = last;
+      }
+      else // bottom rows go up
+      {
+        for( int i = 0; i < -delta; ++i )
+          tbl.insert( tbl.child(last), first );
+        first_changed = first;
+        last_changed = first - delta - 1;
+      }
+      // rows that got other records are not current anymore
+      for( UINT r = first_changed; r <= last_changed; ++r )
+      {
+        dom::element row = tbl.child(r);
+        if( row.get_state(STATE_CURRENT) )
+          row.set_state(0, STATE_CURRENT, false);
+      }
+      tbl.update(true); // positions of moved rows
+      return true;
+    }
 
     HELEMENT get_table( HELEMENT he )
     {
@@ -121,21 +190,17 @@ struct virtual_grid: public event_handler
 
     dom::element target_row(const dom::element& table, const dom::element& target)
     {
-      if( !target.is_valid() || target.parent() == table)
-        return target;
-      return target_row(table,target.parent());
+      return dom::closest(target, dom::child_of(table));
     }
 
     dom::element target_header(const dom::element& header_row, const dom::element& target)
     {
-      if( !target.is_valid() || target.parent() == header_row)
-        return target;
-      return target_header(header_row,target.parent());
+      return dom::closest(target, dom::child_of(header_row));
     }
 
     int fixed_rows( const dom::element& table )
     {
-      return table.get_attribute_int("fixedrows",0);
+      return dom::attribute_cache::get_int(table, "fixedrows", 0);
     }
 
     virtual BOOL on_mouse(HELEMENT he, HELEMENT target, UINT event_type, POINT pt, UINT mouseButtons, UINT keyboardStates )
@@ -262,6 +327,9 @@ struct virtual_grid: public event_handler
       
       if( row == first_row_idx ) return TRUE;
 
+      dom::element tbl = get_table(he);
+      rows_rotated = rotate_rows(tbl, row - first_row_idx, first_changed_row, last_changed_row);
+
       first_row_idx = row;
 
       get_rows_data(he);
@@ -278,6 +346,7 @@ struct virtual_grid: public event_handler
        if( type != INIT_DATA_VIEW ) return FALSE; 
 
        first_row_idx = 0;
+       rows_rotated = false;
        get_rows_data( he ); 
 
        dom::scrollbar sb = get_v_scrollbar(he);
@@ -31,9 +31,17 @@ struct sample_data_source: public behavior
 
       dom::element tbl = table_el;
 
-      int i = drp.firstRecord;
+      // on scroll virtual-grid reuses rows that stay visible, only the changed ones are filled
+      unsigned int first = drp.firstRowIdx, last = drp.lastRowIdx;
+      if( drp.firstChangedRowIdx >= first && drp.firstChangedRowIdx <= drp.lastChangedRowIdx && drp.lastChangedRowIdx <= last )
+      {
+        first = drp.firstChangedRowIdx;
+        last = drp.lastChangedRowIdx;
+      }
+
+      int i = drp.firstRecord + (first - drp.firstRowIdx);
 
-      for(unsigned int n = drp.firstRowIdx ; n <= drp.lastRowIdx; ++n, ++i )
+      for(unsigned int n = first ; n <= last; ++n, ++i )
       {
         dom::element row = tbl.child(n);
         wchar_t buffer[256];
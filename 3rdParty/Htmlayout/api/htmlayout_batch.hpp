@@ -0,0 +1,254 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Deferred DOM mutations applied as one batch.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_batch_hpp__
+#define __htmlayout_batch_hpp__
+
+#pragma once
+
+/*!\file
+\brief dom::batch - deferred mutations with coalesced updates.
+*/
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "htmlayout_dom.hpp"
+#include "htmlayout_update_set.h"
+
+namespace htmlayout
+{
+  namespace dom
+  {
+
+    /** batch - RAII scope that collects DOM mutations and applies them at once.
+     *
+     *  Structural mutations (insert/move) are applied first, in order of recording,
+     *  as their indexes depend on each other. Then text, attributes and states
+     *  are applied in document order of their targets.
+     *  Finally parents of inserted elements and targets of other mutations get
+     *  one HTMLayoutUpdateElementEx call per top-most dirty subtree. Text targets are
+     *  not updated: the engine updates the element on set_text itself.
+     *
+     *  Example:
+     *    {
+     *      dom::batch b;
+     *      for( ... ) b.append(table, row);
+     *    } // <- applied here, table is updated once.
+     **/
+    class batch
+    {
+      enum op_type { OP_INSERT, OP_TEXT, OP_ATTRIBUTE, OP_STYLE, OP_STATE };
+
+      struct op
+      {
+        op_type       type;
+        element       target;
+        element       what;  // OP_INSERT - element to insert/move
+        std::string   name;
+        std::wstring  value;
+        bool          has_value;
+        UINT          bits;  // OP_INSERT - index, OP_STATE - bits to set
+        UINT          bits_to_clear;
+      };
+
+      // document position of the op target, used for sorting
+      struct op_position
+      {
+        std::vector<UINT> path;
+        size_t            idx;
+        bool operator < ( const op_position& r ) const
+        {
+          if( path != r.path )
+            return std::lexicographical_compare(path.begin(),path.end(),r.path.begin(),r.path.end());
+          return idx < r.idx;
+        }
+      };
+
+      std::vector<op> _ops;
+      update_set      _updates;
+      UINT            _update_flags;
+      UINT            _needed;       // updates the mutations would need without the batch
+
+      batch(const batch&);
+      batch& operator=(const batch&);
+
+    public:
+      /** \param update_flags \b UINT, UPDATE_ELEMENT_FLAGS used for elements touched by the batch.
+       **/
+      batch( UINT update_flags = RESET_STYLE_DEEP | MEASURE_DEEP ): _update_flags(update_flags), _needed(0) {}
+      ~batch() { apply(); }
+
+      void set_text( const element& el, const wchar_t* text, size_t text_length )
+      {
+        op& o = push(OP_TEXT, el);
+        if(text) o.value.assign(text, text_length);
+        o.has_value = true;
+      }
+      void set_text( const element& el, const wchar_t* text )
+      {
+        set_text(el, text, text? wcslen(text): 0);
+      }
+
+      void set_attribute( const element& el, const char* name, const wchar_t* value )
+      {
+        op& o = push(OP_ATTRIBUTE, el);
+        o.name = name;
+        if( value ) { o.value = value; o.has_value = true; }
+      }
+      void remove_attribute( const element& el, const char* name ) { set_attribute(el, name, 0); }
+
+      void set_style_attribute( const element& el, const char* name, const wchar_t* value )
+      {
+        op& o = push(OP_STYLE, el);
+        o.name = name;
+        if( value ) { o.value = value; o.has_value = true; }
+      }
+
+      void set_state( const element& el, UINT bits_to_set, UINT bits_to_clear = 0 )
+      {
+        op& o = push(OP_STATE, el);
+        o.bits = bits_to_set;
+        o.bits_to_clear = bits_to_clear;
+      }
+
+      /** insert (or move if it is already in the DOM) element what into parent at index.
+       **/
+      void insert( const element& parent, const element& what, UINT index )
+      {
+        op& o = push(OP_INSERT, parent);
+        o.what = what;
+        o.bits = index;
+      }
+      void append( const element& parent, const element& what ) { insert(parent, what, 0x7FFFFFFF); }
+      void move( const element& what, const element& new_parent, UINT index ) { insert(new_parent, what, index); }
+
+      /** explicit update request, will be coalesced with others **/
+      void update( const element& el, UINT flags )
+      {
+        ++_needed;
+        _updates.add(el, flags);
+      }
+      void update( const element& el ) { update(el, _update_flags); }
+
+      /** number of mutations pending **/
+      size_t size() const { return _ops.size(); }
+
+      /** applies pending mutations and updates. Called automatically by destructor. **/
+      void apply()
+      {
+        if( _ops.empty() && _updates.is_empty() )
+          return;
+
+        std::vector<op> ops;
+        ops.swap(_ops);
+
+        // 1. structural changes, in order of recording
+        for( size_t n = 0; n < ops.size(); ++n )
+        {
+          op& o = ops[n];
+          if( o.type != OP_INSERT ) continue;
+          HELEMENT old_parent = o.what.parent();
+          HLDOM_RESULT r = HTMLayoutInsertElement( o.what, o.target, o.bits );
+          assert(r == HLDOM_OK); r;
+          if( old_parent && old_parent != (HELEMENT)o.target )
+          {
+            ++_needed;
+            _updates.add(old_parent, _update_flags);
+          }
+          ++_needed;
+          _updates.add(o.target, _update_flags);
+        }
+
+        // 2. content changes, in document order
+        std::vector<op_position> order;
+        order.reserve(ops.size());
+        for( size_t n = 0; n < ops.size(); ++n )
+        {
+          if( ops[n].type == OP_INSERT ) continue;
+          order.push_back(op_position());
+          order.back().idx = n;
+          position_of(ops[n].target, order.back().path);
+        }
+        std::sort(order.begin(),order.end());
+
+        for( size_t n = 0; n < order.size(); ++n )
+        {
+          op& o = ops[order[n].idx];
+          switch( o.type )
+          {
+            case OP_TEXT:
+              o.target.set_text(o.value.c_str(), o.value.length());
+              break;
+            case OP_ATTRIBUTE:
+              o.target.set_attribute(o.name.c_str(), o.has_value? o.value.c_str(): 0);
+              break;
+            case OP_STYLE:
+              o.target.set_style_attribute(o.name.c_str(), o.has_value? o.value.c_str(): 0);
+              break;
+            case OP_STATE:
+              o.target.set_state(o.bits, o.bits_to_clear, false); // view is updated below
+              break;
+            default:
+              break;
+          }
+          if( o.type == OP_TEXT )
+            continue;
+          ++_needed;
+          _updates.add(o.target, _update_flags);
+        }
+
+        // 3. one update per affected subtree, targets are folded into their top-most dirty ancestor
+        _updates.flush();
+      }
+
+      /** Instrumentation: number of engine update calls avoided so far.
+       *  Each mutation that needs an update counts as one call that would be made without
+       *  the batch, set_text does not: the engine updates on it anyway.
+       **/
+      UINT saved_calls() const  { return _needed > _updates.issued()? _needed - _updates.issued(): 0; }
+      UINT issued_calls() const { return _updates.issued(); }
+
+    private:
+      op& push( op_type t, const element& target )
+      {
+        assert( target.is_valid() );
+        _ops.push_back(op());
+        op& o = _ops.back();
+        o.type = t;
+        o.target = target;
+        o.has_value = false;
+        o.bits = o.bits_to_clear = 0;
+        return o;
+      }
+
+      // path of child indexes from the root to the element
+      static void position_of( HELEMENT he, std::vector<UINT>& path )
+      {
+        while( he )
+        {
+          UINT idx = 0;
+          HTMLayoutGetElementIndex(he, &idx);
+          path.push_back(idx);
+          HELEMENT hp = 0;
+          HTMLayoutGetParentElement(he, &hp);
+          he = hp;
+        }
+        std::reverse(path.begin(), path.end());
+      }
+    };
+
+  } // dom namespace
+
+} // htmlayout namespace
+
+#endif
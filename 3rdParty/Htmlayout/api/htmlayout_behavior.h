@@ -485,6 +485,10 @@
 
   // request to data source to fill the data.
   // used by virtual-grid and virtual list 
+  // Layout change: firstChangedRowIdx/lastChangedRowIdx were added at the end, sizeof grew by 8.
+  // The engine does not create this structure, grids and data sources of the application do -
+  // sources built with the old header read the same first fields, but a source that reads
+  // the new fields shall not get requests from a grid built with the old header.
   struct DATA_ROWS_PARAMS
   {
       UINT totalRecords;
@@ -493,6 +497,11 @@
       UINT firstRowIdx; // idx of the first row in the table,
       UINT lastRowIdx;  // idx of the last row in the table. 
                         // content of these rows has to be updated.
+
+      UINT firstChangedRowIdx; // only rows firstChangedRowIdx..lastChangedRowIdx need new content,
+      UINT lastChangedRowIdx;  // other rows already show their records firstRecord + (row - firstRowIdx) -
+                               // virtual-grid moves them on scroll. Equal to firstRowIdx..lastRowIdx on full refresh.
+                               // If data source changes firstRecord the grid requests all rows again.
   };
 
 
@@ -25,6 +25,11 @@
 #include <assert.h>
 #include "htmlayout.h"
 #include "htmlayout_behavior.h"
+#include "aux-hash.h"
+
+#if defined(HTMLAYOUT_PROFILE_EVENTS)
+  #include "aux-profiler.h"
+#endif
 
 #if defined(_MSC_VER) && (_MSC_VER / 100) == 13 // appears as really bad number indeed
   #define BRAINS_OFF #pragma optimize( "", off )
@@ -37,6 +42,34 @@
 namespace htmlayout 
 {
 
+#if defined(HTMLAYOUT_RECORD_EVENTS)
+  struct event_handler;
+
+  // observer of all element_proc calls, see event_recorder/event_replay in htmlayout_recorder.hpp.
+  // Taps are installed and called in the GUI thread.
+  struct event_tap
+  {
+    event_tap* next_tap;
+
+    event_tap(): next_tap(0) {}
+    virtual ~event_tap() {}
+    virtual void on_event( event_handler* h, HELEMENT he, UINT evtg, LPVOID prms ) = 0;
+
+    void install() { next_tap = first(); first() = this; }
+    void uninstall()
+    {
+      for( event_tap** pt = &first(); *pt; pt = &(*pt)->next_tap )
+        if( *pt == this ) { *pt = next_tap; break; }
+    }
+    static void notify( event_handler* h, HELEMENT he, UINT evtg, LPVOID prms )
+    {
+      for( event_tap* t = first(); t; t = t->next_tap )
+        t->on_event(h, he, evtg, prms);
+    }
+    static event_tap*& first() { static event_tap* _first = 0; return _first; }
+  };
+#endif
+
   // event handler which can be attached to any DOM element.
   // event handler can be attached to the element as a "behavior" (see below)
   // or by htmlayout::dom::element::attach( event_handler* eh )
@@ -151,13 +184,30 @@ namespace htmlayout
     static BOOL CALLBACK  element_proc(LPVOID tag, HELEMENT he, UINT evtg, LPVOID prms )
     {
       event_handler* pThis = static_cast<event_handler*>(tag);
+#if defined(HTMLAYOUT_RECORD_EVENTS)
+      if( pThis ) event_tap::notify(pThis, he, evtg, prms);
+#endif
+#if defined(HTMLAYOUT_PROFILE_EVENTS)
+      if( !pThis ) return FALSE;
+      aux::profiler::event_scope ps( aux::profiler::name_of(pThis), evtg );
+      return ps.done( dispatch_event(pThis, he, evtg, prms) );
+#else
+      return dispatch_event(pThis, he, evtg, prms);
+#endif
+    }
+
+    static BOOL dispatch_event(event_handler* pThis, HELEMENT he, UINT evtg, LPVOID prms )
+    {
       if( pThis ) switch( evtg )
         {
           case HANDLE_INITIALIZATION:
             {
               INITIALIZATION_PARAMS *p = (INITIALIZATION_PARAMS *)prms;
               if(p->cmd == BEHAVIOR_DETACH)
+              {
+                if( detach_hook() ) detach_hook()(pThis, he);
                 pThis->detached(he);
+              }
               else if(p->cmd == BEHAVIOR_ATTACH)
                 pThis->attached(he);
               return TRUE;
@@ -189,28 +239,234 @@ namespace htmlayout
       return FALSE;
     }
 
+    // ElementEventProc to be used with this handler, see behavior_impl below 
+    virtual ElementEventProc* event_proc() { return &element_proc; }
+
+    // function called before detached() of any handler, used by htmlayout_timers.hpp to cancel timers
+    // and by htmlayout_workers.hpp to cancel element tokens. Hooks chain: keep the previous one and call it.
+    typedef void detach_hook_t( event_handler* h, HELEMENT he );
+    static detach_hook_t*& detach_hook() { static detach_hook_t* _hook = 0; return _hook; }
+
     UINT             subscribed_to;
   };
 
+  // compile time detection of handlers defined (overriden) in class D,
+  // defines_xxx<D>::value is true if D or any of its bases other than event_handler declares xxx
+  #define HTMLAYOUT_DEFINES_HANDLER(NAME, ARGS) \
+    template <class D> struct defines_##NAME \
+    { \
+      static char test( BOOL (event_handler::*) ARGS ); \
+      template <class C> static long test( BOOL (C::*) ARGS ); \
+      static long test(...); /* D declares NAME with other signature, hiding ours */ \
+      enum { value = sizeof(test(&D::NAME)) != sizeof(char) }; \
+    };
+
+  namespace detail
+  {
+    HTMLAYOUT_DEFINES_HANDLER(handle_mouse, (HELEMENT, MOUSE_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_mouse, (HELEMENT, HELEMENT, UINT, POINT, UINT, UINT))
+    HTMLAYOUT_DEFINES_HANDLER(handle_key, (HELEMENT, KEY_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_key, (HELEMENT, HELEMENT, UINT, UINT, UINT))
+    HTMLAYOUT_DEFINES_HANDLER(handle_focus, (HELEMENT, FOCUS_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_focus, (HELEMENT, HELEMENT, UINT))
+    HTMLAYOUT_DEFINES_HANDLER(handle_timer, (HELEMENT, TIMER_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_timer, (HELEMENT))
+    HTMLAYOUT_DEFINES_HANDLER(handle_scroll, (HELEMENT, SCROLL_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_scroll, (HELEMENT, HELEMENT, SCROLL_EVENTS, INT, BOOL))
+    HTMLAYOUT_DEFINES_HANDLER(handle_draw, (HELEMENT, DRAW_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_draw, (HELEMENT, UINT, HDC, const RECT&))
+    HTMLAYOUT_DEFINES_HANDLER(handle_method_call, (HELEMENT, METHOD_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_method_call, (HELEMENT, UINT, METHOD_PARAMS*))
+    HTMLAYOUT_DEFINES_HANDLER(handle_script_call, (HELEMENT, XCALL_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_script_call, (HELEMENT, LPCSTR, UINT, json::value*, json::value&))
+    HTMLAYOUT_DEFINES_HANDLER(handle_event, (HELEMENT, BEHAVIOR_EVENT_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_event, (HELEMENT, HELEMENT, BEHAVIOR_EVENTS, UINT_PTR))
+    HTMLAYOUT_DEFINES_HANDLER(handle_data_arrived, (HELEMENT, DATA_ARRIVED_PARAMS&))
+    HTMLAYOUT_DEFINES_HANDLER(on_data_arrived, (HELEMENT, HELEMENT, LPCBYTE, UINT, UINT))
+
+    // void handle_size/on_size 
+    template <class D> struct defines_size
+    {
+      static char test( void (event_handler::*)(HELEMENT) );
+      template <class C> static long test( void (C::*)(HELEMENT) );
+      static long test(...);
+      enum { value = sizeof(test(&D::handle_size)) != sizeof(char) || sizeof(test(&D::on_size)) != sizeof(char) };
+    };
+    // on_timer is overloaded, on_timer(he, id) is checked separately
+    template <class D> struct defines_ext_timer
+    {
+      static char test( BOOL (event_handler::*)(HELEMENT, UINT_PTR) );
+      template <class C> static long test( BOOL (C::*)(HELEMENT, UINT_PTR) );
+      static long test(...);
+      enum { value = sizeof(test(&D::on_timer)) != sizeof(char) };
+    };
+  }
+
+  /** behavior_impl<Derived, Base> - event handler with subscription mask and dispatch
+   *  derived at compile time from handlers Derived actually defines.
+   *
+   *  \code
+   *    struct my_behavior: behavior_impl<my_behavior, behavior>
+   *    {
+   *      my_behavior(): behavior_impl<my_behavior, behavior>("my-behavior") {} // subscribed to HANDLE_MOUSE only
+   *      virtual BOOL on_mouse(HELEMENT he, HELEMENT target, UINT event_type, POINT pt, UINT mouseButtons, UINT keyboardStates ) { ... }
+   *    };
+   *  \endcode
+   *
+   *  Handlers are called by qualified names so Derived shall be the final class:
+   *  overrides of handlers in classes derived from Derived are not called.
+   *  Event groups that have side effects without handling (e.g. HANDLE_FOCUS makes element focusable)
+   *  can be added by extra_subscriptions.
+   **/
+  template <class Derived, class Base = event_handler>
+    struct behavior_impl: public Base
+    {
+      // mask of event groups Derived has handlers for
+      static UINT subscriptions()
+      {
+        using namespace detail;
+        UINT m = 0;
+        if( defines_handle_mouse<Derived>::value || defines_on_mouse<Derived>::value ) m |= HANDLE_MOUSE;
+        if( defines_handle_key<Derived>::value   || defines_on_key<Derived>::value )   m |= HANDLE_KEY;
+        if( defines_handle_focus<Derived>::value || defines_on_focus<Derived>::value ) m |= HANDLE_FOCUS;
+        if( defines_handle_timer<Derived>::value || defines_on_timer<Derived>::value || defines_ext_timer<Derived>::value ) m |= HANDLE_TIMER;
+        if( defines_handle_scroll<Derived>::value || defines_on_scroll<Derived>::value ) m |= HANDLE_SCROLL;
+        if( defines_handle_draw<Derived>::value  || defines_on_draw<Derived>::value )  m |= HANDLE_DRAW;
+        if( defines_size<Derived>::value ) m |= HANDLE_SIZE;
+        if( defines_handle_method_call<Derived>::value || defines_on_method_call<Derived>::value ||
+            defines_handle_script_call<Derived>::value || defines_on_script_call<Derived>::value ) m |= HANDLE_METHOD_CALL;
+        if( defines_handle_event<Derived>::value || defines_on_event<Derived>::value ) m |= HANDLE_BEHAVIOR_EVENT;
+        if( defines_handle_data_arrived<Derived>::value || defines_on_data_arrived<Derived>::value ) m |= HANDLE_DATA_ARRIVED;
+        return m;
+      }
+
+      behavior_impl( UINT extra_subscriptions = 0 ): Base( subscriptions() | extra_subscriptions ) {}
+      behavior_impl( const char* name, UINT extra_subscriptions = 0 ): Base( subscriptions() | extra_subscriptions, name ) {}
+
+      virtual ElementEventProc* event_proc() { return &static_element_proc; }
+
+      // ElementEventProc with static dispatch. 
+      static BOOL CALLBACK static_element_proc(LPVOID tag, HELEMENT he, UINT evtg, LPVOID prms )
+      {
+        Derived* self = static_cast<Derived*>(static_cast<event_handler*>(tag));
+        if( !self ) return FALSE;
+#if defined(HTMLAYOUT_RECORD_EVENTS)
+        event_tap::notify(self, he, evtg, prms);
+#endif
+#if defined(HTMLAYOUT_PROFILE_EVENTS)
+        aux::profiler::event_scope ps( aux::profiler::name_of(self), evtg );
+        return ps.done( static_dispatch(self, he, evtg, prms) );
+#else
+        return static_dispatch(self, he, evtg, prms);
+#endif
+      }
+
+      // Constant conditions below are resolved at compile time.
+      static BOOL static_dispatch(Derived* self, HELEMENT he, UINT evtg, LPVOID prms )
+      {
+        using namespace detail;
+        switch( evtg )
+        {
+          case HANDLE_INITIALIZATION:
+            {
+              INITIALIZATION_PARAMS *p = (INITIALIZATION_PARAMS *)prms;
+              if(p->cmd == BEHAVIOR_DETACH)
+              {
+                if( event_handler::detach_hook() ) event_handler::detach_hook()(self, he);
+                self->detached(he); // virtual, may "delete this"
+              }
+              else if(p->cmd == BEHAVIOR_ATTACH)
+                self->attached(he);
+              return TRUE;
+            }
+          case HANDLE_MOUSE:
+            {
+              MOUSE_PARAMS *p = (MOUSE_PARAMS *)prms;
+              if( defines_handle_mouse<Derived>::value ) return self->Derived::handle_mouse( he, *p );
+              return self->Derived::on_mouse( he, p->target, p->cmd, p->pos, p->button_state, p->alt_state );
+            }
+          case HANDLE_KEY:
+            {
+              KEY_PARAMS *p = (KEY_PARAMS *)prms;
+              if( defines_handle_key<Derived>::value ) return self->Derived::handle_key( he, *p );
+              return self->Derived::on_key( he, p->target, p->cmd, p->key_code, p->alt_state );
+            }
+          case HANDLE_FOCUS:
+            {
+              FOCUS_PARAMS *p = (FOCUS_PARAMS *)prms;
+              if( defines_handle_focus<Derived>::value ) return self->Derived::handle_focus( he, *p );
+              return self->Derived::on_focus( he, p->target, p->cmd );
+            }
+          case HANDLE_DRAW:
+            {
+              DRAW_PARAMS *p = (DRAW_PARAMS *)prms;
+              if( defines_handle_draw<Derived>::value ) return self->Derived::handle_draw( he, *p );
+              return self->Derived::on_draw( he, p->cmd, p->hdc, p->area );
+            }
+          case HANDLE_TIMER:
+            {
+              TIMER_PARAMS *p = (TIMER_PARAMS *)prms;
+              return self->Derived::handle_timer( he, *p ); // on_timer is overloaded, goes through handle_timer
+            }
+          case HANDLE_BEHAVIOR_EVENT:
+            {
+              BEHAVIOR_EVENT_PARAMS *p = (BEHAVIOR_EVENT_PARAMS *)prms;
+              if( defines_handle_event<Derived>::value ) return self->Derived::handle_event( he, *p );
+              return self->Derived::on_event( he, p->heTarget, (BEHAVIOR_EVENTS)p->cmd, p->reason );
+            }
+          case HANDLE_METHOD_CALL:
+            {
+              METHOD_PARAMS *p = (METHOD_PARAMS *)prms;
+              if(p->methodID == XCALL)
+              {
+                XCALL_PARAMS *xp = (XCALL_PARAMS *)p;
+                if( defines_handle_script_call<Derived>::value ) return self->Derived::handle_script_call( he, *xp );
+                return self->Derived::on_script_call( he, xp->method_name, xp->argc, xp->argv, xp->retval );
+              }
+              if( defines_handle_method_call<Derived>::value ) return self->Derived::handle_method_call( he, *p );
+              return self->Derived::on_method_call( he, p->methodID, p );
+            }
+          case HANDLE_DATA_ARRIVED:
+            {
+              DATA_ARRIVED_PARAMS *p = (DATA_ARRIVED_PARAMS *)prms;
+              if( defines_handle_data_arrived<Derived>::value ) return self->Derived::handle_data_arrived( he, *p );
+              return self->Derived::on_data_arrived( he, p->initiator, p->data, p->dataSize, p->dataType );
+            }
+          case HANDLE_SIZE:
+            {
+              self->Derived::handle_size( he );
+              return FALSE;
+            }
+          case HANDLE_SCROLL:
+            {
+              SCROLL_PARAMS *p = (SCROLL_PARAMS *)prms;
+              if( defines_handle_scroll<Derived>::value ) return self->Derived::handle_scroll( he, *p );
+              return self->Derived::on_scroll( he, p->target, (SCROLL_EVENTS)p->cmd, p->pos, p->vertical );
+            }
+        }
+        return FALSE;
+      }
+    };
+
   // "manually" attach event_handler proc to the DOM element 
   inline void attach_event_handler(HELEMENT he, event_handler* p_event_handler, UINT subscription = HANDLE_ALL )
   {
-    HTMLayoutAttachEventHandlerEx(he, &event_handler::element_proc, p_event_handler, subscription);
+    HTMLayoutAttachEventHandlerEx(he, p_event_handler->event_proc(), p_event_handler, subscription);
   }
 
   inline void detach_event_handler(HELEMENT he, event_handler* p_event_handler )
   {
-    HTMLayoutDetachEventHandler(he, &event_handler::element_proc, p_event_handler);
+    HTMLayoutDetachEventHandler(he, p_event_handler->event_proc(), p_event_handler);
   }
 
   // "manually" attach event_handler proc to the window 
   inline void attach_event_handler(HWND hwndLayout, event_handler* p_event_handler, UINT subscription = HANDLE_ALL )
   {
-    HTMLayoutWindowAttachEventHandler(hwndLayout, &event_handler::element_proc, p_event_handler, subscription);
+    HTMLayoutWindowAttachEventHandler(hwndLayout, p_event_handler->event_proc(), p_event_handler, subscription);
   }  
   inline void detach_event_handler(HWND hwndLayout, event_handler* p_event_handler )
   {
-    HTMLayoutWindowDetachEventHandler(hwndLayout, &event_handler::element_proc, p_event_handler);
+    HTMLayoutWindowDetachEventHandler(hwndLayout, p_event_handler->event_proc(), p_event_handler);
   }
 
   //
@@ -229,15 +485,76 @@ namespace htmlayout
   #pragma optimize( "", off )
   #endif
 
+  struct behavior;
+
+  // set of behaviors that override global ones in particular window(s):
+  //   static behavior_set my_set;
+  //   static my_grid my_grid_instance(my_set); // uses behavior(subscriptions, "grid", my_set) ctor
+  //   ...
+  //   my_set.attach_to(hwnd);
+  struct behavior_set
+  {
+    aux::name_table<behavior> table;
+    unsigned                  duplicates; // behaviors rejected by add(): the name is in the set already
+
+    behavior_set(): duplicates(0) {}
+
+    bool add(behavior* b, const char* name) 
+    { 
+      bool r = table.insert(name, b);
+      assert(r); // duplicate name in the set, the first one stays
+      if( !r ) ++duplicates;
+      return r;
+    }
+    void attach_to(HWND hwnd)   
+    { 
+      if( ::SetPropA(hwnd, prop_name(), this) ) 
+        ::InterlockedIncrement(&attached_count()); 
+    }
+    void detach_from(HWND hwnd) 
+    { 
+      if( ::RemovePropA(hwnd, prop_name()) ) 
+        ::InterlockedDecrement(&attached_count()); 
+    }
+
+    static behavior_set* of(HWND hwnd)
+    {
+      if( !attached_count() ) return 0; // fast path, no overrides at all
+      return static_cast<behavior_set*>(::GetPropA(hwnd, prop_name()));
+    }
+  private:
+    static const char* prop_name() { return "htmlayout::behavior_set"; }
+    static volatile LONG& attached_count() { static volatile LONG n = 0; return n; }
+  };
+
   struct behavior: event_handler 
   {
 
     behavior(UINT subsriptions, const char* external_name)
       :next(0),name(external_name), event_handler(subsriptions)
     {
+      // a behavior with such name is registered already: the first one stays, this one is counted in duplicates().
+      // Static initialization order decides which one is the first, use behavior_set to override.
+      for(behavior* t = root(); t; t = t->next)
+        if( strcmp(t->name,external_name) == 0 )
+        {
+          assert(false);
+          ++duplicates();
+          return;
+        }
       // add this implementation to the list (singleton)
       next = root();
       root(this);
+      // registration after first lookup, e.g. by dynamically loaded module
+      if( aux::acquire_ptr(&table()) )
+        freeze();
+    }
+
+    // behavior that goes to the override set rather than to the global list
+    behavior(UINT subsriptions, const char* external_name, behavior_set& overrides)
+      :next(0),name(external_name), event_handler(subsriptions)
+    {
+      overrides.add(this, external_name);
     }
 
     // behavior list support
@@ -247,13 +564,35 @@ namespace htmlayout
     // returns behavior implementation by name.
     static event_handler* find(const char* name, HELEMENT he)
     {
-      for(behavior* t = root(); t; t = t->next)
-        if(strcmp(t->name,name)==0)
-        {
-          return t->attach(he);
-        }
-      return 0; // not found
+      behavior* t = lookup(name);
+      return t? t->attach(he): 0; 
     }
+
+    // returns behavior by name, looking first in overrides of the window (if any)
+    static behavior* lookup(const char* name, HWND hwnd = 0)
+    {
+#if defined(HTMLAYOUT_PROFILE_LOOKUPS)
+      LARGE_INTEGER t0; ::QueryPerformanceCounter(&t0);
+#endif
+      behavior* t = 0;
+      if( hwnd )
+      {
+        behavior_set* ps = behavior_set::of(hwnd);
+        if( ps ) t = ps->table.find(name);
+      }
+      if( !t )
+      {
+        registry* pr = aux::acquire_ptr(&table());
+        if( !pr ) pr = freeze();
+        t = pr->find(name);
+      }
+#if defined(HTMLAYOUT_PROFILE_LOOKUPS)
+      LARGE_INTEGER t1; ::QueryPerformanceCounter(&t1);
+      stats().add(t1.QuadPart - t0.QuadPart);
+#endif
+      return t;
+    }
+
     // implementation of static list of behaviors  
     static behavior* root(behavior* to_set = 0)
     {
@@ -262,20 +601,53 @@ namespace htmlayout
       return _root;
     }
 
+    // number of behaviors not registered because their name was taken
+    static unsigned& duplicates() { static unsigned n = 0; return n; }
+
     // standard implementation of HLN_ATTACH_BEHAVIOR notification
     static bool handle( LPNMHL_ATTACH_BEHAVIOR lpab )
     {
-      htmlayout::event_handler *pb = htmlayout::behavior::find(lpab->behaviorName, lpab->element);
+      behavior* t = lookup(lpab->behaviorName, lpab->hdr.hwndFrom);
+      htmlayout::event_handler *pb = t? t->attach(lpab->element): 0;
       if(pb) 
       {
         lpab->elementTag  = pb;
-        lpab->elementProc = htmlayout::event_handler::element_proc;
+        lpab->elementProc = pb->event_proc();
         lpab->elementEvents = pb->subscribed_to;
         return true;
       }
       return false;
     }
 
+#if defined(HTMLAYOUT_PROFILE_LOOKUPS)
+    // instrumentation: number of lookups and time spent in them, HTMLAYOUT_PROFILE_LOOKUPS builds only
+    struct lookup_stats
+    {
+      volatile LONG     lookups;
+      volatile LONGLONG ticks; // QueryPerformanceCounter units
+      void add(LONGLONG dt) { ::InterlockedIncrement(&lookups); ::InterlockedExchangeAdd64(&ticks, dt); }
+      double seconds() const { LARGE_INTEGER f; ::QueryPerformanceFrequency(&f); return f.QuadPart? double(ticks) / double(f.QuadPart): 0; }
+    };
+    static lookup_stats& stats() { static lookup_stats s = {0,0}; return s; }
+#endif
+
+  private:
+    typedef aux::name_table<behavior> registry;
+
+    // frozen (read-only) table of the list, built on first lookup
+    static registry* volatile& table() { static registry* volatile _table = 0; return _table; }
+
+    static registry* freeze()
+    {
+      registry* pr = new registry();
+      for(behavior* t = root(); t; t = t->next)
+        pr->insert(t->name,t); // first one wins, as in the list 
+      registry* current = aux::acquire_ptr(&table());
+      if( aux::publish_ptr(&table(), pr, current) )
+        return pr; // previous table (if any) is not deleted as it may be in use by other threads
+      delete pr;   // other thread was first
+      return aux::acquire_ptr(&table());
+    }
   };
 
   #if defined(_MSC_VER) && (_MSC_VER / 100) == 13 
@@ -19,6 +19,7 @@
 #include "htmlayout_aux.h"
 #include "htmlayout_graphin.h"
 #include "htmlayout_behavior.hpp"
+#include "htmlayout_pool.hpp"
 
 namespace htmlayout
 {
@@ -93,10 +94,11 @@ namespace htmlayout
   {
     canvas_factory(const char* name): behavior(HANDLE_INITIALIZATION, name) {}
 
-    // this behavior has unique instance for each element it is attached to
+    // this behavior has unique instance for each element it is attached to,
+    // instances are taken from and returned to per-type pool.
     virtual event_handler* attach (HELEMENT /*he*/ ) 
     { 
-      return new CANVAS(); 
+      return new pooled_object<CANVAS>(); 
     }
   };
   //  e.g. 
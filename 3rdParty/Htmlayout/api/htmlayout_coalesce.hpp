@@ -0,0 +1,311 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Coalescing of high frequency input events.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_coalesce_hpp__
+#define __htmlayout_coalesce_hpp__
+
+#pragma once
+
+/*!\file
+\brief coalesced_input<Base> - delivers mouse moves, wheel and SCROLL_POS events
+       at most once per tick.
+
+First event of a burst is delivered immediately and opens the tick window
+(element timer). Events that arrive while the window is open are accumulated:
+on the tick handler gets the latest of them, the wheel delta is summed up.
+The window closes on a tick that has nothing to deliver.
+
+Other events (buttons, enter/leave, other scroll commands) are never deferred:
+pending events of the element are delivered before them, so order is preserved.
+
+Deferred events return to the engine what the last delivered event of that kind returned.
+
+Moves while dragging (DRAGGING | MOUSE_MOVE) are coalesced separately from plain moves.
+Deferred mouse events keep references to their target and dragging elements.
+If the target left the element by the time of delivery the event is retargeted to the element itself,
+if the dragged element left the DOM the event is dropped.
+
+\par Example:
+\code
+  struct my_splitter: public coalesced_input<behavior>
+  {
+    my_splitter(): coalesced_input<behavior>(HANDLE_MOUSE, "my-splitter") {}
+    virtual BOOL on_mouse(...) { ... coalesced_count(), coalesced_delta() ... }
+  };
+\endcode
+*/
+
+#include <vector>
+#include <string.h>
+
+#include "htmlayout_behavior.hpp"
+
+namespace htmlayout
+{
+
+  /** coalesced_input<Base> - wraps ElementEventProc of the Base,
+   *  so it works with any handlers of derived classes (on_xxx, handle_xxx, behavior_impl).
+   *  Base is event_handler, behavior or behavior_impl<Derived>.
+   **/
+  template <class Base = event_handler>
+    struct coalesced_input: public Base
+    {
+      UINT coalesce_ms; // tick, milliseconds
+      UINT received;    // coalescable events received
+      UINT delivered;   // of them delivered to handlers
+
+      coalesced_input(): Base() { init(); }
+      template <typename A>
+        coalesced_input( A a ): Base(a) { init(); }
+      template <typename A, typename B>
+        coalesced_input( A a, B b ): Base(a, b) { init(); }
+      template <typename A, typename B, typename C>
+        coalesced_input( A a, B b, C c ): Base(a, b, c) { init(); }
+
+      // inside handler: number of events the delivered one stands for, 1 - not coalesced
+      UINT  coalesced_count() const { return _current? _current->count: 1; }
+      // inside handler: mouse position (or scroll pos in x) change since previous delivery
+      POINT coalesced_delta() const
+      {
+        POINT d = { 0, 0 };
+        if( _current && _current->has_last )
+        {
+          if( _current->group == HANDLE_MOUSE )
+          {
+            d.x = _current->mouse.pos.x - _current->last_pos.x;
+            d.y = _current->mouse.pos.y - _current->last_pos.y;
+          }
+          else
+            d.x = _current->scroll.pos - _current->last_pos.x;
+        }
+        return d;
+      }
+
+      virtual ElementEventProc* event_proc() { return &coalescing_proc; }
+
+    protected:
+
+      struct pending
+      {
+        HELEMENT      he;
+        UINT          group;      // HANDLE_MOUSE or HANDLE_SCROLL
+        UINT          cmd;
+        UINT          count;      // accumulated events, 0 - nothing pending
+        int           wheel;      // accumulated wheel delta
+        MOUSE_PARAMS  mouse;      // latest
+        SCROLL_PARAMS scroll;     // latest
+        BOOL          last_result;
+        POINT         last_pos;   // of the last delivered
+        bool          has_last;
+      };
+      std::vector<pending>  _pending;  // of elements with open window, in order of arrival
+      std::vector<HELEMENT> _windows;  // elements with running tick timer
+      pending*              _current;  // being delivered
+
+      void init()
+      {
+        coalesce_ms = 16; received = 0; delivered = 0; _current = 0;
+        this->subscribed_to |= HANDLE_TIMER;
+      }
+
+      UINT_PTR timer_id() const { return UINT_PTR(this); }
+
+      static bool is_coalescable_mouse( UINT cmd )
+      {
+        UINT c = cmd & ~(SINKING | HANDLED | DRAGGING); // moves over drop targets too
+        return c == MOUSE_MOVE || c == MOUSE_WHEEL;
+      }
+
+      bool window_open( HELEMENT he ) const
+      {
+        for( size_t n = 0; n < _windows.size(); ++n )
+          if( _windows[n] == he ) return true;
+        return false;
+      }
+
+      static void use( HELEMENT h )   { if( h ) HTMLayout_UseElement(h); }
+      static void unuse( HELEMENT h ) { if( h ) HTMLayout_UnuseElement(h); }
+
+      // top-most ancestor of h (h itself if it was removed from the DOM), 0 - h is dead
+      static HELEMENT root_of( HELEMENT h )
+      {
+        for( HELEMENT parent = 0; h; h = parent )
+          if( HTMLayoutGetParentElement(h, &parent) != HLDOM_OK ) return 0;
+          else if( !parent ) break;
+        return h;
+      }
+      // h is he or its descendant, false if h was removed from the element
+      static bool is_within( HELEMENT h, HELEMENT he )
+      {
+        for( HELEMENT parent = 0; h; h = parent )
+        {
+          if( h == he ) return true;
+          if( HTMLayoutGetParentElement(h, &parent) != HLDOM_OK ) return false;
+        }
+        return false;
+      }
+
+      // deferred mouse event owns references to its elements
+      static void release( pending& p )
+      {
+        if( p.group != HANDLE_MOUSE ) return;
+        unuse(p.mouse.target); p.mouse.target = 0;
+        unuse(p.mouse.dragging); p.mouse.dragging = 0;
+      }
+
+      pending& slot( HELEMENT he, UINT group, UINT cmd )
+      {
+        for( size_t n = 0; n < _pending.size(); ++n )
+          if( _pending[n].he == he && _pending[n].group == group && _pending[n].cmd == cmd )
+            return _pending[n];
+        pending p; memset(&p, 0, sizeof(p));
+        p.he = he; p.group = group; p.cmd = cmd;
+        _pending.push_back(p);
+        return _pending.back();
+      }
+
+      BOOL deliver( ElementEventProc* next, LPVOID tag, pending& p )
+      {
+        // p may move if handler causes new events of this element,
+        // the copy takes references of p
+        pending copy = p;
+        p.count = 0; p.wheel = 0;
+        if( p.group == HANDLE_MOUSE ) p.mouse.target = p.mouse.dragging = 0;
+        BOOL r;
+        if( copy.group == HANDLE_MOUSE )
+        {
+          MOUSE_PARAMS mp = copy.mouse;
+          if( mp.dragging && root_of(mp.dragging) != root_of(copy.he) )
+          {
+            release(copy); // the dragged element is gone, so is the drag
+            return copy.last_result;
+          }
+          if( !is_within(mp.target, copy.he) )
+            mp.target = copy.he; // removed while the event waited
+          if( (mp.cmd & ~(SINKING | HANDLED)) == MOUSE_WHEEL )
+            mp.button_state = UINT(copy.wheel);
+          _current = &copy;
+          r = next(tag, copy.he, HANDLE_MOUSE, &mp);
+        }
+        else
+        {
+          SCROLL_PARAMS sp = copy.scroll;
+          _current = &copy;
+          r = next(tag, copy.he, HANDLE_SCROLL, &sp);
+        }
+        _current = 0;
+        release(copy);
+        ++delivered;
+
+        pending& q = slot(copy.he, copy.group, copy.cmd);
+        q.last_result = r;
+        q.has_last = true;
+        if( copy.group == HANDLE_MOUSE ) q.last_pos = copy.mouse.pos;
+        else { q.last_pos.x = copy.scroll.pos; q.last_pos.y = 0; }
+        return r;
+      }
+
+      // delivers everything pending for the element, in order of arrival
+      void flush( ElementEventProc* next, LPVOID tag, HELEMENT he )
+      {
+        for( size_t n = 0; n < _pending.size(); ++n )
+          if( _pending[n].he == he && _pending[n].count )
+            deliver(next, tag, _pending[n]);
+      }
+
+      void close_window( HELEMENT he )
+      {
+        for( size_t n = _pending.size(); n > 0; --n )
+          if( _pending[n - 1].he == he )
+          {
+            release(_pending[n - 1]);
+            _pending.erase(_pending.begin() + (n - 1));
+          }
+        for( size_t n = 0; n < _windows.size(); ++n )
+          if( _windows[n] == he ) { _windows.erase(_windows.begin() + n); break; }
+      }
+
+      BOOL defer( ElementEventProc* next, LPVOID tag, HELEMENT he, UINT group, LPVOID prms )
+      {
+        ++received;
+        UINT cmd = group == HANDLE_MOUSE? ((MOUSE_PARAMS*)prms)->cmd: ((SCROLL_PARAMS*)prms)->cmd;
+        pending& p = slot(he, group, cmd);
+        if( group == HANDLE_MOUSE )
+        {
+          release(p);
+          p.mouse = *(MOUSE_PARAMS*)prms;
+          use(p.mouse.target); use(p.mouse.dragging);
+          p.wheel += int(p.mouse.button_state);
+        }
+        else
+          p.scroll = *(SCROLL_PARAMS*)prms;
+        ++p.count;
+
+        if( window_open(he) )
+          return p.last_result;
+
+        // leading event of the burst goes immediately
+        _windows.push_back(he);
+        HTMLayoutSetTimerEx(he, coalesce_ms, timer_id());
+        return deliver(next, tag, p);
+      }
+
+      BOOL tick( ElementEventProc* next, LPVOID tag, HELEMENT he )
+      {
+        bool any = false;
+        for( size_t n = 0; n < _pending.size(); ++n )
+          if( _pending[n].he == he && _pending[n].count )
+          {
+            deliver(next, tag, _pending[n]);
+            any = true;
+          }
+        if( any ) return TRUE; // keep ticking
+        close_window(he);
+        return FALSE; // stop the timer
+      }
+
+      static BOOL CALLBACK coalescing_proc( LPVOID tag, HELEMENT he, UINT evtg, LPVOID prms )
+      {
+        coalesced_input* self = static_cast<coalesced_input*>(static_cast<event_handler*>(tag));
+        if( !self ) return FALSE;
+        ElementEventProc* next = self->Base::event_proc();
+        switch( evtg )
+        {
+          case HANDLE_INITIALIZATION:
+            if( ((INITIALIZATION_PARAMS*)prms)->cmd == BEHAVIOR_DETACH )
+            {
+              if( self->window_open(he) )
+                HTMLayoutSetTimerEx(he, 0, self->timer_id());
+              self->close_window(he); // before detached() that may delete this
+            }
+            break;
+          case HANDLE_MOUSE:
+            if( is_coalescable_mouse( ((MOUSE_PARAMS*)prms)->cmd ) )
+              return self->defer(next, tag, he, HANDLE_MOUSE, prms);
+            self->flush(next, tag, he);
+            break;
+          case HANDLE_SCROLL:
+            if( ((SCROLL_PARAMS*)prms)->cmd == SCROLL_POS )
+              return self->defer(next, tag, he, HANDLE_SCROLL, prms);
+            self->flush(next, tag, he);
+            break;
+          case HANDLE_TIMER:
+            if( ((TIMER_PARAMS*)prms)->timerId == self->timer_id() )
+              return self->tick(next, tag, he);
+            break;
+        }
+        return next(tag, he, evtg, prms);
+      }
+    };
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * C++20 coroutines: switching between GUI and worker threads, awaiting element data.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_coro_hpp__
+#define __htmlayout_coro_hpp__
+
+#pragma once
+
+/*!\file
+\brief coro::task - fire and forget coroutine of GUI code with awaitables:
+
+ - co_await coro::gui_thread() - continue in GUI thread, through gui_queue;
+ - co_await coro::background(pool) - continue in a thread of htmlayout::workers pool;
+ - co_await coro::data_arrived(he, url) - HTMLayoutRequestElementData and wait for the delivery;
+ - co_await coro::bound_to(he) - the coroutine belongs to the element.
+
+The coroutine starts in the calling thread and runs till the first suspension.
+When the element it is bound to gets detached the coroutine is destroyed at its current
+suspension point instead of being resumed: destructors of its locals run, the rest of
+its code does not. Coroutines waiting for data of the element are destroyed on its detach too.
+Frames are destroyed in the GUI thread only: a coroutine that ends in a worker thread
+is destroyed by a task posted to the GUI queue, so its parameters die in the GUI thread.
+Locals die where their scope ends, so a coroutine that keeps GUI-only locals like
+dom::element shall co_await gui_thread() before it ends.
+
+Data is delivered by the handler of the element, it shall forward the event.
+Waiters are matched by the URL as requested or as combined with the document URL:
+\code
+  virtual BOOL handle_data_arrived( HELEMENT he, DATA_ARRIVED_PARAMS& params )
+  {
+    return coro::data_waiters::instance().deliver(he, params) || event_handler::handle_data_arrived(he, params);
+  }
+\endcode
+
+Frames come from block pools of FRAME_SIZE_0 .. FRAME_SIZE_0 << (FRAME_CLASSES - 1) bytes,
+bigger ones from the heap.
+
+\par Example:
+\code
+  coro::task load( HELEMENT he, std::wstring url )
+  {
+    co_await coro::bound_to(he);
+    coro::data d = co_await coro::data_arrived(he, url.c_str());
+    if( !d.ok() ) co_return;
+    co_await coro::background(pool);
+    rows r = parse(d.bytes);         // worker thread
+    co_await coro::gui_thread();
+    populate(he, r);                 // GUI thread, he is alive
+  }
+\endcode
+*/
+
+#if !defined(__cpp_impl_coroutine) || !defined(__has_include)
+  #error htmlayout_coro.hpp needs C++20 compiler with coroutines
+#elif !__has_include(<coroutine>)
+  #error htmlayout_coro.hpp needs <coroutine>
+#endif
+
+#include <coroutine>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "htmlayout_dom.h"
+#include "htmlayout_workers.hpp"
+#include "htmlayout_pool.hpp"
+
+namespace htmlayout
+{
+
+  namespace coro
+  {
+    enum
+    {
+      FRAME_SIZE_0  = 256,
+      FRAME_CLASSES = 4    // 256, 512, 1024, 2048
+    };
+
+    // frames are freed in GUI thread and may be allocated in any, so pools are thread cached
+    inline block_pool& frame_pool( UINT cls )
+    {
+      static block_pool _pools[FRAME_CLASSES] =
+      {
+        block_pool( FRAME_SIZE_0,      "coro_frame", 32, true ),
+        block_pool( FRAME_SIZE_0 << 1, "coro_frame", 32, true ),
+        block_pool( FRAME_SIZE_0 << 2, "coro_frame", 16, true ),
+        block_pool( FRAME_SIZE_0 << 3, "coro_frame", 16, true )
+      };
+      return _pools[cls];
+    }
+    inline UINT frame_class( size_t sz ) // FRAME_CLASSES - too big
+    {
+      UINT cls = 0;
+      for( size_t limit = FRAME_SIZE_0; cls < FRAME_CLASSES && sz > limit; limit <<= 1 )
+        ++cls;
+      return cls;
+    }
+
+    /** task - coroutine return type, nothing to wait for: the coroutine owns itself **/
+    struct task
+    {
+      struct promise_type
+      {
+        cancel_token token; // of the element the coroutine is bound to
+        queue*       gui;   // set while the coroutine runs in a worker thread
+
+        // frame of the coroutine that ends in a worker thread goes to the GUI thread to be destroyed
+        struct final_hop
+        {
+          bool await_ready() const noexcept { return false; }
+          bool await_suspend( std::coroutine_handle<promise_type> h ) noexcept
+          {
+            queue* gq = h.promise().gui;
+            if( !gq ) return false; // GUI thread, the frame is destroyed right here
+            gq->post( [h]() { h.destroy(); } );
+            return true;
+          }
+          void await_resume() const noexcept {}
+        };
+
+        promise_type(): gui(0) {}
+
+        task                get_return_object() { return task(); }
+        std::suspend_never  initial_suspend() noexcept { return std::suspend_never(); }
+        final_hop           final_suspend() noexcept { return final_hop(); }
+        void                return_void() {}
+        void                unhandled_exception() { assert(false); } // nobody to rethrow to
+
+        static void* operator new( size_t sz )
+        {
+          UINT cls = frame_class(sz);
+          return cls < FRAME_CLASSES? frame_pool(cls).alloc(): ::operator new(sz);
+        }
+        static void operator delete( void* p, size_t sz )
+        {
+          UINT cls = frame_class(sz);
+          if( cls < FRAME_CLASSES ) frame_pool(cls).free(p); else ::operator delete(p);
+        }
+      };
+    };
+
+    typedef std::coroutine_handle<task::promise_type> handle;
+
+    // GUI thread: the coroutine goes on unless the element it is bound to is gone
+    inline void resume_or_destroy( handle h )
+    {
+      h.promise().gui = 0;
+      if( h.promise().token.cancelled() )
+        h.destroy();
+      else
+        h.resume();
+    }
+
+    /** co_await bound_to(he) - the coroutine is destroyed, instead of resuming, once he is detached.
+     *  GUI thread only.
+     **/
+    struct bound_to
+    {
+      HELEMENT he;
+      explicit bound_to( HELEMENT h ): he(h) {}
+      bool await_ready() const { return false; }
+      bool await_suspend( handle h ) { h.promise().token = element_token(he); return false; } // no suspension
+      void await_resume() {}
+    };
+
+    /** co_await gui_thread() - continue in the GUI thread.
+     *  From the GUI thread it yields to the tasks that are already in the queue.
+     **/
+    struct gui_thread
+    {
+      queue& q;
+      UINT   priority;
+      explicit gui_thread( queue& gq = gui_queue, UINT prio = TASK_NORMAL ): q(gq), priority(prio) {}
+      bool await_ready() const { return false; }
+      void await_suspend( handle h ) { q.post( [h]() { resume_or_destroy(h); }, priority ); }
+      void await_resume() {}
+    };
+
+    /** co_await background(pool) - continue in a worker thread of the pool **/
+    struct background
+    {
+      workers& pool;
+      explicit background( workers& p ): pool(p) {}
+      bool await_ready() const { return false; }
+      void await_suspend( handle h )
+      {
+        queue* gq = &pool.gui();
+        pool.run( [h, gq]()
+        {
+          if( h.promise().token.cancelled() )
+            gq->post( [h]() { h.destroy(); } ); // locals are destroyed in GUI thread
+          else
+          {
+            h.promise().gui = gq;
+            h.resume();
+          }
+        });
+      }
+      void await_resume() {}
+    };
+
+    /** data - what data_arrived gives **/
+    struct data
+    {
+      UINT              status;   // see DATA_ARRIVED_PARAMS::status, 0 - request failed
+      UINT              type;     // HTMLayoutResourceType
+      std::vector<BYTE> bytes;
+      data(): status(0), type(0) {}
+      bool ok() const { return !bytes.empty() && (status == 0 || (status >= 200 && status < 300)); } // local files have no status
+    };
+
+    class data_waiters;
+
+    /** co_await data_arrived(he, url [, type]) - requests the data for he and waits for the delivery **/
+    struct data_arrived
+    {
+      HELEMENT     he;
+      std::wstring url;
+      std::wstring combined; // url combined with the document url, as the engine may report it
+      UINT         type;
+      HELEMENT     initiator;
+      data         result;
+      handle       waiting;
+
+      data_arrived( HELEMENT h, LPCWSTR u, UINT t = HLRT_DATA_HTML, HELEMENT init = 0 ): he(h), url(u), type(t), initiator(init) {}
+      bool await_ready() const { return false; }
+      inline bool await_suspend( handle h );
+      data await_resume() { return std::move(result); }
+    };
+
+    /** data_waiters - coroutines waiting for element data, GUI thread only **/
+    class data_waiters
+    {
+    public:
+      static data_waiters& instance()
+      {
+        static data_waiters _instance;
+        static bool _hooked = hook(); _hooked;
+        return _instance;
+      }
+
+      // call it from handle_data_arrived of the element, TRUE if the data was awaited
+      BOOL deliver( HELEMENT he, const DATA_ARRIVED_PARAMS& params )
+      {
+        waiters_t::iterator it = find(he, params.uri);
+        if( it == _waiters.end() ) return FALSE;
+        data_arrived* pa = it->second;
+        _waiters.erase(it);
+        pa->result.status = params.status;
+        pa->result.type = params.dataType;
+        if( params.data && params.dataSize )
+          pa->result.bytes.assign(params.data, params.data + params.dataSize);
+        resume_or_destroy(pa->waiting); // pa is in the frame, it may be gone after this
+        return TRUE;
+      }
+
+      size_t size() const { return _waiters.size(); }
+
+    private:
+      friend struct data_arrived;
+      typedef std::multimap<HELEMENT, data_arrived*> waiters_t;
+      waiters_t _waiters;
+
+      data_waiters() {}
+
+      void add( data_arrived* pa ) { _waiters.insert( std::make_pair(pa->he, pa) ); }
+      void remove( data_arrived* pa )
+      {
+        for( waiters_t::iterator it = _waiters.lower_bound(pa->he); it != _waiters.end() && it->first == pa->he; ++it )
+          if( it->second == pa ) { _waiters.erase(it); return; }
+      }
+
+      // by url as requested or as combined, data of other requests of the element is not taken
+      waiters_t::iterator find( HELEMENT he, LPCWSTR uri )
+      {
+        if( !uri ) return _waiters.end();
+        for( waiters_t::iterator it = _waiters.lower_bound(he); it != _waiters.end() && it->first == he; ++it )
+          if( it->second->url == uri || it->second->combined == uri ) return it;
+        return _waiters.end();
+      }
+
+      static event_handler::detach_hook_t*& previous_hook() { static event_handler::detach_hook_t* _prev = 0; return _prev; }
+      static bool hook()
+      {
+        previous_hook() = event_handler::detach_hook();
+        event_handler::detach_hook() = &on_detach;
+        return true;
+      }
+      static void on_detach( event_handler* h, HELEMENT he )
+      {
+        data_waiters& self = instance();
+        for( waiters_t::iterator it; (it = self._waiters.find(he)) != self._waiters.end(); )
+        {
+          handle ch = it->second->waiting;
+          self._waiters.erase(it);
+          ch.destroy();
+        }
+        if( previous_hook() ) previous_hook()(h, he);
+      }
+    };
+
+    inline bool data_arrived::await_suspend( handle h )
+    {
+      waiting = h;
+      WCHAR buf[2048];
+      if( url.length() < sizeof(buf) / sizeof(buf[0]) )
+      {
+        wcscpy(buf, url.c_str());
+        if( HTMLayoutCombineURL(he, buf, sizeof(buf) / sizeof(buf[0])) == HLDOM_OK )
+          combined = buf;
+      }
+      data_waiters& dw = data_waiters::instance();
+      dw.add(this);
+      if( HTMLayoutRequestElementData(he, url.c_str(), type, initiator) == HLDOM_OK )
+        return true; // data may come right in the call, this is not used after it
+      dw.remove(this); // result.status == 0, go on without suspension
+      return false;
+    }
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Typed paged data sources for behavior:virtual-grid.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_data_source_hpp__
+#define __htmlayout_data_source_hpp__
+
+#pragma once
+
+/*!\file
+\brief data_source - typed column batches of record ranges, data_pager - LRU cache of pages
+       fetched and prefetched on worker threads, paged_rows_source - ROWS_DATA_REQUEST handler over them.
+
+The grid never waits for the source: rows of pages that are not in the cache yet are left
+empty with :busy state and filled when the page arrives. Pages next to the visible window
+are prefetched in direction of the scroll, so sequential scrolling finds them ready.
+
+Needs C++11 (htmlayout_workers.hpp).
+
+\par Example:
+\code
+  // <div style="behavior:virtual-grid"><table fixedrows=1>...</table><widget type="vscrollbar"/></div>
+  static workers pool;
+  dom::element grid = root.find_first("div#log");
+  attach_event_handler( grid, new paged_rows_source( std::make_shared<log_source>(path), pool ), HANDLE_BEHAVIOR_EVENT );
+  grid.post_event(INIT_DATA_VIEW);
+\endcode
+*/
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <functional>
+
+#include "htmlayout_dom.hpp"
+#include "htmlayout_batch.hpp"
+#include "htmlayout_workers.hpp"
+
+namespace htmlayout
+{
+
+  enum DATA_COLUMN_TYPE
+  {
+    DATA_INT,
+    DATA_REAL,
+    DATA_TEXT
+  };
+
+  /** column_batch - values of one column for the record range, only the vector of the type is used **/
+  struct column_batch
+  {
+    DATA_COLUMN_TYPE           type;
+    std::vector<LONGLONG>      ints;
+    std::vector<double>        reals;
+    std::vector<std::wstring>  texts;
+    std::vector<unsigned char> nulls; // non-zero - null value, empty - no nulls
+
+    column_batch( DATA_COLUMN_TYPE t = DATA_TEXT ): type(t) {}
+
+    bool is_null( UINT i ) const { return i < nulls.size() && nulls[i]; }
+
+    // text of the cell
+    void format( UINT i, std::wstring& out ) const
+    {
+      out.clear();
+      if( is_null(i) ) return;
+      wchar_t buf[64];
+      switch( type )
+      {
+        case DATA_INT:  swprintf(buf, 64, L"%lld", ints[i]); out = buf; break;
+        case DATA_REAL: swprintf(buf, 64, L"%g", reals[i]); out = buf; break;
+        case DATA_TEXT: out = texts[i]; break;
+      }
+    }
+  };
+
+  /** record_batch - records first .. first + count - 1 **/
+  struct record_batch
+  {
+    UINT                      first;
+    UINT                      count;
+    std::vector<column_batch> columns;
+    record_batch(): first(0), count(0) {}
+  };
+
+  /** data_source - what grid shows. fetch() is called from worker threads,
+   *  concurrently for different ranges, the rest - from the GUI thread.
+   **/
+  class data_source
+  {
+  public:
+    virtual ~data_source() {}
+    virtual UINT total_records() = 0;
+    virtual UINT columns() = 0;
+    // fills columns of records first..first + count - 1, fewer at the end. May be slow.
+    virtual bool fetch( UINT first, UINT count, record_batch& batch ) = 0;
+  };
+
+  struct pager_stats
+  {
+    UINT hits;       // find() with the page ready
+    UINT misses;     // find() without
+    UINT fetched;    // pages delivered
+    UINT prefetched; // of them requested ahead of the view
+    UINT evicted;
+    UINT failed;     // fetch() returned false
+  };
+
+  /** data_pager - LRU cache of pages of the source, GUI thread only.
+   *  Missing pages are fetched by the workers pool, pages delivered are announced
+   *  by on_ready(page_no) callback.
+   **/
+  class data_pager
+  {
+  public:
+    typedef std::function<void(UINT page_no)> ready_callback;
+
+    data_pager( const std::shared_ptr<data_source>& src, workers& pool, UINT page_size = 128, UINT max_pages = 64, UINT prefetch_pages = 2 ):
+      _src(src), _pool(pool), _page_size(page_size? page_size: 1), _max_pages(max_pages), _prefetch(prefetch_pages),
+      _token(cancel_token::make()), _last_first(0)
+    {
+      memset(&_stats, 0, sizeof(_stats));
+    }
+    // fetches in flight are not delivered
+    ~data_pager() { _token.cancel(); }
+
+    void on_ready( const ready_callback& cb ) { _on_ready = cb; }
+
+    data_source& source() const { return *_src; }
+    UINT page_size() const { return _page_size; }
+    const pager_stats& stats() const { return _stats; }
+
+    // the page of the record if it is ready, 0 otherwise. Ready page becomes the most recently used.
+    const record_batch* find( UINT record )
+    {
+      index_t::iterator it = _index.find(record / _page_size);
+      if( it == _index.end() ) { ++_stats.misses; return 0; }
+      ++_stats.hits;
+      _lru.splice(_lru.begin(), _lru, it->second);
+      return &it->second->batch;
+    }
+
+    // window of the view: requests missing pages of it, then pages ahead in direction of the scroll
+    void want( UINT first, UINT count )
+    {
+      UINT total = _src->total_records();
+      if( !total || !count ) return;
+      UINT last = (std::min)(first + count, total) - 1;
+      UINT first_page = first / _page_size, last_page = last / _page_size;
+      for( UINT p = first_page; p <= last_page; ++p )
+        request(p, false);
+      UINT pages = (total + _page_size - 1) / _page_size;
+      int dir = first > _last_first? 1: first < _last_first? -1: 0;
+      _last_first = first;
+      for( UINT n = 1; n <= _prefetch; ++n )
+      {
+        if( dir >= 0 && last_page + n < pages ) request(last_page + n, true);
+        if( dir <= 0 && first_page >= n )       request(first_page - n, true);
+      }
+    }
+
+    // source data has changed: pages are dropped, fetches in flight are not delivered
+    void invalidate()
+    {
+      _token.cancel();
+      _token = cancel_token::make();
+      _lru.clear();
+      _index.clear();
+      _pending.clear();
+    }
+
+  private:
+    struct page
+    {
+      UINT         no;
+      record_batch batch;
+    };
+    typedef std::list<page>                          lru_t;  // most recently used first
+    typedef std::map<UINT, lru_t::iterator>          index_t;
+
+    std::shared_ptr<data_source> _src;
+    workers&                     _pool;
+    UINT                         _page_size;
+    UINT                         _max_pages;
+    UINT                         _prefetch;
+    cancel_token                 _token;
+    lru_t                        _lru;
+    index_t                      _index;
+    std::map<UINT, bool>         _pending; // page -> is prefetch
+    ready_callback               _on_ready;
+    UINT                         _last_first;
+    pager_stats                  _stats;
+
+    data_pager( const data_pager& );
+    data_pager& operator=( const data_pager& );
+
+    void request( UINT page_no, bool prefetch )
+    {
+      if( _index.find(page_no) != _index.end() || _pending.find(page_no) != _pending.end() )
+        return;
+      _pending[page_no] = prefetch;
+      std::shared_ptr<data_source> src = _src;
+      UINT first = page_no * _page_size, count = _page_size;
+      _pool.run( [src, first, count]() -> std::shared_ptr<record_batch>
+        {
+          std::shared_ptr<record_batch> b = std::make_shared<record_batch>();
+          b->first = first;
+          if( !src->fetch(first, count, *b) ) b.reset();
+          return b;
+        })
+        .cancel_with(_token)
+        .then_on_gui( [this, page_no](std::shared_ptr<record_batch> b) { arrived(page_no, b); },
+                      prefetch? TASK_IDLE: TASK_NORMAL );
+    }
+
+    void arrived( UINT page_no, const std::shared_ptr<record_batch>& b )
+    {
+      std::map<UINT, bool>::iterator pit = _pending.find(page_no);
+      bool prefetch = pit != _pending.end() && pit->second;
+      if( pit != _pending.end() ) _pending.erase(pit);
+      if( !b ) { ++_stats.failed; return; }
+      ++_stats.fetched;
+      if( prefetch ) ++_stats.prefetched;
+      page pg;
+      pg.no = page_no;
+      _lru.push_front(pg);
+      _lru.front().batch = std::move(*b);
+      _index[page_no] = _lru.begin();
+      while( _lru.size() > _max_pages )
+      {
+        _index.erase(_lru.back().no);
+        _lru.pop_back();
+        ++_stats.evicted;
+      }
+      if( _on_ready ) _on_ready(page_no);
+    }
+  };
+
+  /** paged_rows_source - data source of behavior:virtual-grid over the data_pager.
+   *  Attach it to the grid element or to its container, it deletes itself on detach.
+   **/
+  class paged_rows_source: public event_handler
+  {
+  public:
+    paged_rows_source( const std::shared_ptr<data_source>& src, workers& pool, UINT page_size = 128, UINT max_pages = 64 ):
+      event_handler(HANDLE_BEHAVIOR_EVENT), _pager(src, pool, page_size, max_pages), _has_view(false)
+    {
+      _pager.on_ready( [this](UINT page_no) { page_ready(page_no); } );
+    }
+
+    data_pager& pager() { return _pager; }
+
+    virtual void detached( HELEMENT ) { delete this; }
+
+    virtual BOOL on_event( HELEMENT he, HELEMENT target, BEHAVIOR_EVENTS type, UINT_PTR reason )
+    {
+      if( type != ROWS_DATA_REQUEST ) return FALSE;
+      DATA_ROWS_PARAMS& drp = *((DATA_ROWS_PARAMS*)reason);
+      drp.totalRecords = _pager.source().total_records();
+      _table = target;
+      _view = drp;
+      _has_view = true;
+      if( drp.lastRowIdx < drp.firstRowIdx ) return TRUE;
+      _pager.want(drp.firstRecord, drp.lastRowIdx - drp.firstRowIdx + 1);
+
+      UINT first = drp.firstRowIdx, last = drp.lastRowIdx;
+      if( drp.firstChangedRowIdx >= first && drp.firstChangedRowIdx <= drp.lastChangedRowIdx && drp.lastChangedRowIdx <= last )
+      {
+        first = drp.firstChangedRowIdx;
+        last = drp.lastChangedRowIdx;
+      }
+      fill(first, last);
+      return TRUE;
+    }
+
+  protected:
+    data_pager       _pager;
+    dom::element     _table;
+    DATA_ROWS_PARAMS _view; // last request
+    bool             _has_view;
+
+    // rows of the last request that show records of the page
+    void page_ready( UINT page_no )
+    {
+      if( !_has_view || !_table.is_valid() ) return;
+      UINT ps = _pager.page_size();
+      UINT rows = _view.lastRowIdx - _view.firstRowIdx + 1;
+      UINT first_rec = (std::max)(page_no * ps, _view.firstRecord);
+      UINT last_rec = (std::min)(page_no * ps + ps, _view.firstRecord + rows) - 1;
+      if( first_rec > last_rec ) return; // prefetched, not visible yet
+      fill(_view.firstRowIdx + first_rec - _view.firstRecord, _view.firstRowIdx + last_rec - _view.firstRecord);
+    }
+
+    // rows that have their pages ready get text, others are cleared and marked :busy
+    virtual void fill( UINT first_row, UINT last_row )
+    {
+      dom::batch cells;
+      std::wstring text;
+      UINT total = _view.totalRecords;
+      for( UINT n = first_row; n <= last_row && n < _table.children_count(); ++n )
+      {
+        dom::element row = _table.child(n);
+        UINT rec = _view.firstRecord + n - _view.firstRowIdx;
+        const record_batch* b = rec < total? _pager.find(rec): 0;
+        UINT ncells = row.children_count();
+        for( UINT c = 0; c < ncells; ++c )
+        {
+          text.clear();
+          if( b && c < b->columns.size() && rec - b->first < b->count )
+            b->columns[c].format(rec - b->first, text);
+          cells.set_text(row.child(c), text.c_str(), text.length());
+        }
+        bool busy = !b && rec < total;
+        if( busy != row.get_state(STATE_BUSY) )
+          cells.set_state(row, busy? STATE_BUSY: 0, busy? 0: STATE_BUSY);
+      }
+    }
+  };
+
+}
+
+#endif
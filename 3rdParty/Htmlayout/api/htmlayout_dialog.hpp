@@ -137,7 +137,7 @@ namespace htmlayout
         alignment, 
         style, style_ex, 
         &notification_handler<dialog>::callback, 
-        &event_handler::element_proc,
+        event_proc(),
         this, html, html_length );
     }
 
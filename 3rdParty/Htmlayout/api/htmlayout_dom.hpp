@@ -51,6 +51,7 @@ namespace htmlayout
       virtual bool on_element(HELEMENT he) = 0;
     };
     class expando; // DOM element expando structure
+    inline void invalidate_attribute_cache( HELEMENT he ); // see attribute_cache below
 
 	/**DOM element. 
      Smart pointer, pretty much std::shared_ptr thing */
@@ -212,6 +213,7 @@ namespace htmlayout
 	  void set_attribute( const char* name, const wchar_t* value )
       { 
         HTMLayoutSetAttributeByName(he, name, value);
+        invalidate_attribute_cache(he);
       }
 
 	  /**Get attribute integer value by name.
@@ -263,6 +265,7 @@ namespace htmlayout
 	  void remove_attribute( const char* name ) 
       { 
         HTMLayoutSetAttributeByName(he, name, 0);
+        invalidate_attribute_cache(he);
       }
       
 
@@ -289,6 +292,7 @@ namespace htmlayout
 	  void set_style_attribute( const char* name, const wchar_t* value )  
       { 
         HTMLayoutSetStyleAttribute(he, name, value);
+        invalidate_attribute_cache(he);
       }
 
 	  /** Clear style attribute that was defined by set_style_attribute.
@@ -300,6 +304,7 @@ namespace htmlayout
 	  void clear_style_attribute( const char* name )  
       { 
         HTMLayoutSetStyleAttribute(he, name, 0);
+        invalidate_attribute_cache(he);
       }
 
 	  /** Clear all style attribute that was defined by set_style_attribute.
@@ -307,6 +312,7 @@ namespace htmlayout
 	  void clear_all_style_attributes() 
       { 
         HTMLayoutSetStyleAttribute(he, 0, 0);
+        invalidate_attribute_cache(he);
       }
 
 
@@ -1135,6 +1141,180 @@ namespace htmlayout
       return static_cast<expando*>(pexp);
     }
 
+    /**Attribute cache - expando that memoizes parsed attribute values of the element.
+      *
+      * Cache is opt-in: element can have only one expando, so attribute_cache::enable(he)
+      * takes it for elements that are known to have no other expando, e.g. elements of a behavior.
+      * On other elements values are parsed on each call (and counted as misses).
+      *
+      * Value is parsed on first request and returned from the cache after that.
+      * Names starting from '-' are resolved as element::attribute() does:
+      * element attribute first and then custom style attribute. Such values depend on styles
+      * that change without notification (classes, states) so they are parsed on each call too.
+      *
+      * Cache is dropped by element::set_attribute, remove_attribute, set_style_attribute and
+      * clear_style_attribute. If attributes are changed bypassing dom::element (by plain API or by scripts)
+      * call attribute_cache::invalidate(he).
+      *
+      * \par Example:
+      * \code
+      *   virtual void attached( HELEMENT he ) { dom::attribute_cache::enable(he); }
+      *   ...
+      *   int fr = dom::attribute_cache::get_int(table, "fixedrows", 0);
+      * \endcode
+      **/
+    class attribute_cache: public expando
+    {
+      enum value_type { T_INT, T_BOOL, T_COLOR, T_ATOM };
+      enum { MAX_ENTRIES = 8, MAX_NAME = 32 };
+
+      struct entry 
+      {
+        char        name[MAX_NAME];
+        value_type  type;
+        const void* atoms;    // T_ATOM - table of atoms
+        int         defval;   // default value used for parsing
+        int         value;
+      };
+      entry    _entries[MAX_ENTRIES];
+      unsigned _count;
+      unsigned _next; // slot to replace when full
+
+      static void CALLBACK _cache_finalizer(HTMLayoutElementExpando* pexp, HELEMENT he) { static_cast<attribute_cache*>(pexp)->finalize(); }
+
+      attribute_cache(): _count(0), _next(0) { finalizer = _cache_finalizer; }
+
+    public:
+
+      /**Integer value of the attribute.
+       * \param name \b const \b char*, name of the attribute, "-name" for attribute or custom style attribute.
+       **/
+      static int get_int( const element& el, const char* name, int default_value = 0 )
+      {
+        return lookup( el, name, T_INT, 0, default_value );
+      }
+
+      /**true if the attribute is defined, as HTML boolean attributes, e.g. <table multiple>.
+       **/
+      static bool get_bool( const element& el, const char* name )
+      {
+        return lookup( el, name, T_BOOL, 0, 0 ) != 0;
+      }
+
+      /**Color value of the attribute. 
+       **/
+      static color get_color( const element& el, const char* name, color default_value = color() )
+      {
+        return color( (unsigned int)lookup( el, name, T_COLOR, 0, int(to_uint(default_value)) ) );
+      }
+
+      /**Enumerated value - index of the attribute value in NULL terminated atoms table,
+       * or default_index if attribute is not defined or does not match any of atoms.
+       * Atoms table shall be static. 
+       * \par Example:
+       * \code
+       *   static const wchar_t* modes[] = { L"single", L"multiple", 0 };
+       *   int mode = dom::attribute_cache::get_atom(el, "selection", modes, 0);
+       * \endcode
+       **/
+      static int get_atom( const element& el, const char* name, const wchar_t* const* atoms, int default_index = -1 )
+      {
+        return lookup( el, name, T_ATOM, atoms, default_index );
+      }
+
+      /**Attach the cache to the element if it has no expando yet.
+       * Returns true if the element has the cache.
+       **/
+      static bool enable( HELEMENT he )
+      {
+        return get(he, true) != 0;
+      }
+
+      /**Drop all cached values of the element.
+       **/
+      static void invalidate( HELEMENT he )
+      {
+        attribute_cache* pc = get(he, false);
+        if( pc ) pc->_count = pc->_next = 0;
+      }
+
+      // instrumentation
+      static unsigned& hits()   { static unsigned n = 0; return n; }
+      static unsigned& misses() { static unsigned n = 0; return n; }
+      static void reset_counters() { hits() = misses() = 0; }
+
+    private:
+      static unsigned to_uint( const color& c ) 
+      {
+        return unsigned(c.r) | (unsigned(c.g) << 8) | (unsigned(c.b) << 16) | (unsigned(c.t) << 24);
+      }
+
+      static attribute_cache* get( HELEMENT he, bool create )
+      {
+        HTMLayoutElementExpando* pexp = 0;
+        if( !he || HTMLayoutElementGetExpando(he, &pexp) != HLDOM_OK )
+          return 0;
+        if( pexp )
+          return pexp->finalizer == _cache_finalizer? static_cast<attribute_cache*>(pexp): 0;
+        if( !create )
+          return 0;
+        attribute_cache* pc = new attribute_cache();
+        if( HTMLayoutElementSetExpando(he, pc) != HLDOM_OK )
+        {
+          delete pc;
+          return 0;
+        }
+        return pc;
+      }
+
+      static int lookup( const element& el, const char* name, value_type type, const void* atoms, int defval )
+      {
+        attribute_cache* pc = name[0] != '-' && strlen(name) < MAX_NAME? get(el, false): 0;
+        if( pc )
+          for( unsigned n = 0; n < pc->_count; ++n )
+          {
+            const entry& e = pc->_entries[n];
+            if( e.type == type && e.defval == defval && e.atoms == atoms && strcmp(e.name, name) == 0 )
+            {
+              ++hits();
+              return e.value;
+            }
+          }
+        ++misses();
+        int v = parse( el, name, type, atoms, defval );
+        if( pc )
+        {
+          unsigned slot = pc->_count < MAX_ENTRIES? pc->_count++: (pc->_next++ % MAX_ENTRIES);
+          entry& e = pc->_entries[slot];
+          strcpy(e.name, name);
+          e.type = type; e.atoms = atoms; e.defval = defval; e.value = v;
+        }
+        return v;
+      }
+
+      static int parse( const element& el, const char* name, value_type type, const void* atoms, int defval )
+      {
+        const wchar_t* txt = name[0] == '-'? el.attribute( name, (const wchar_t*)0 ): el.get_attribute( name );
+        switch( type )
+        {
+          case T_INT:   
+            return aux::wtoi( txt, defval );
+          case T_BOOL:  
+            return txt? 1: 0;
+          case T_COLOR: 
+            return txt? int(to_uint(color::parse(aux::chars_of(txt), color((unsigned int)defval)))): defval;
+          case T_ATOM:
+            if( txt )
+              for( const wchar_t* const* pa = (const wchar_t* const*)atoms; *pa; ++pa )
+                if( aux::wcseqi(txt, *pa) ) return int(pa - (const wchar_t* const*)atoms);
+            return defval;
+        }
+        return defval;
+      }
+    };
+
+    inline void invalidate_attribute_cache( HELEMENT he ) { attribute_cache::invalidate(he); }
+
 
     #define STD_CTORS(T,PT) \
       T() { } \
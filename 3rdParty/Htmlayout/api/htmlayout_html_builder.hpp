@@ -0,0 +1,344 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * HTML fragment builder for bulk population of elements.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_html_builder_hpp__
+#define __htmlayout_html_builder_hpp__
+
+#pragma once
+
+/*!\file
+\brief dom::html_builder - composes escaped UTF-8 markup and submits it by chunks.
+*/
+
+#include <stdio.h>
+#include <float.h>
+#include <vector>
+#include <string>
+
+#include "htmlayout_dom.hpp"
+
+namespace htmlayout
+{
+  namespace dom
+  {
+
+    /** field - value of row_template placeholder.
+     **/
+    struct field
+    {
+      enum type { NONE, INT, REAL, TEXT, ATEXT };
+      type            t;
+      int             i;
+      double          d;
+      const wchar_t*  ws;
+      const char*     as;
+
+      field():                  t(NONE),  i(0), d(0), ws(0), as(0) {}
+      field(int v):             t(INT),   i(v), d(0), ws(0), as(0) {}
+      field(unsigned int v):    t(INT),   i(int(v)), d(0), ws(0), as(0) {}
+      field(double v):          t(REAL),  i(0), d(v), ws(0), as(0) {}
+      field(const wchar_t* v):  t(TEXT),  i(0), d(0), ws(v), as(0) {}
+      field(const char* v):     t(ATEXT), i(0), d(0), ws(0), as(v) {}
+      field(const std::wstring& v): t(TEXT), i(0), d(0), ws(v.c_str()), as(0) {}
+    };
+
+    /** row_template - markup with {0}..{N} placeholders, parsed once.
+     *  Placeholder values get escaped. "{{" stands for literal '{'.
+     *
+     *  Example:
+     *    dom::row_template tpl("<tr><td>{0}</td><td class=name>{1}</td></tr>");
+     **/
+    class row_template
+    {
+      friend class html_builder;
+
+      struct segment
+      {
+        std::string literal;
+        int         field_no; // -1 - none, literal only
+      };
+      std::vector<segment> _segments;
+
+    public:
+      row_template( const char* markup )
+      {
+        segment seg; seg.field_no = -1;
+        const char* pc = markup;
+        while( *pc )
+        {
+          if( pc[0] == '{' && pc[1] == '{' ) { seg.literal += '{'; pc += 2; continue; }
+          if( pc[0] == '{' && pc[1] >= '0' && pc[1] <= '9' )
+          {
+            const char* pe = pc + 1;
+            int n = 0;
+            while( *pe >= '0' && *pe <= '9' ) n = n * 10 + (*pe++ - '0');
+            if( *pe == '}' )
+            {
+              seg.field_no = n;
+              _segments.push_back(seg);
+              seg.literal.clear(); seg.field_no = -1;
+              pc = pe + 1;
+              continue;
+            }
+          }
+          seg.literal += *pc++;
+        }
+        if( seg.literal.length() )
+          _segments.push_back(seg);
+      }
+    };
+
+    /** html_builder - composes UTF-8 markup in memory and submits it
+     *  to the target element by HTMLayoutSetElementHtml calls.
+     *
+     *  When rows_per_chunk is not zero the builder flushes itself
+     *  each rows_per_chunk rows, so loading of N rows
+     *  takes N / rows_per_chunk engine calls.
+     *
+     *  Example:
+     *    {
+     *      dom::html_builder hb(table, 500);
+     *      for( int i = 0; i < 100000; ++i )
+     *        hb.row_begin().cell(i).cell(names[i]).cell(prices[i],2).row_end();
+     *    } // <- rest is submitted here.
+     **/
+    class html_builder
+    {
+      pod::byte_buffer  _buf;
+      element           _target;
+      int               _where;
+      UINT              _rows_per_chunk;
+      UINT              _rows_in_chunk;
+      UINT              _rows;
+      UINT              _chunks;
+      size_t            _bytes;
+
+      html_builder(const html_builder&);
+      html_builder& operator=(const html_builder&);
+
+    public:
+      /** builder that just composes markup, use data()/length() to get it. **/
+      html_builder(): _where(SIH_APPEND_AFTER_LAST), _rows_per_chunk(0), _rows_in_chunk(0), _rows(0), _chunks(0), _bytes(0) {}
+
+      /** \param target \b element, container to populate.
+       *  \param rows_per_chunk \b UINT, number of rows submitted by one call, 0 - submit on flush() only.
+       *  \param where \b int, SIH_* mode of the first chunk. Following chunks are always SIH_APPEND_AFTER_LAST.
+       **/
+      html_builder( const element& target, UINT rows_per_chunk = 1000, int where = SIH_APPEND_AFTER_LAST ):
+        _target(target), _where(where), _rows_per_chunk(rows_per_chunk), _rows_in_chunk(0), _rows(0), _chunks(0), _bytes(0) {}
+
+      ~html_builder() { flush(); }
+
+      /** raw markup, not escaped **/
+      html_builder& raw( const char* markup )
+      {
+        _buf.push((const byte*)markup, strlen(markup));
+        return *this;
+      }
+      html_builder& raw( const char* markup, size_t length )
+      {
+        _buf.push((const byte*)markup, length);
+        return *this;
+      }
+
+      /** escaped text **/
+      html_builder& text( const wchar_t* str )
+      {
+        if( str ) text(str, wcslen(str));
+        return *this;
+      }
+      html_builder& text( const wchar_t* str, size_t length );
+      html_builder& text( const char* ascii )
+      {
+        if( !ascii ) return *this;
+        for( const char* pc = ascii; *pc; ++pc )
+          if( !escape(*pc) ) _buf.push(byte(*pc));
+        return *this;
+      }
+      html_builder& number( int n )
+      {
+        char buf[16]; char* p = buf + sizeof(buf);
+        unsigned int u = n < 0? 0u - unsigned(n): unsigned(n);
+        do { *--p = char('0' + u % 10); u /= 10; } while( u );
+        if( n < 0 ) *--p = '-';
+        _buf.push((const byte*)p, buf + sizeof(buf) - p);
+        return *this;
+      }
+      // fractional_digits is limited to 0..MAX_FRACTIONAL_DIGITS
+      enum { MAX_FRACTIONAL_DIGITS = 20 };
+      html_builder& number( double d, int fractional_digits = 1 )
+      {
+        // sign, DBL_MAX_10_EXP + 1 integer digits, point, fraction, terminator
+        char buf[1 + DBL_MAX_10_EXP + 1 + 1 + MAX_FRACTIONAL_DIGITS + 1];
+        if( fractional_digits < 0 ) fractional_digits = 0;
+        else if( fractional_digits > MAX_FRACTIONAL_DIGITS ) fractional_digits = MAX_FRACTIONAL_DIGITS;
+        int n = _snprintf(buf, sizeof(buf), "%.*f", fractional_digits, d);
+        if( n < 0 || n > int(sizeof(buf)) ) n = sizeof(buf);
+        _buf.push((const byte*)buf, n);
+        return *this;
+      }
+
+      /** <tag attributes> and </tag> **/
+      html_builder& open( const char* tag, const char* attributes = 0 )
+      {
+        _buf.push('<'); raw(tag);
+        if( attributes && attributes[0] ) { _buf.push(' '); raw(attributes); }
+        _buf.push('>');
+        return *this;
+      }
+      html_builder& close( const char* tag )
+      {
+        _buf.push('<'); _buf.push('/'); raw(tag); _buf.push('>');
+        return *this;
+      }
+
+      // table helpers
+      html_builder& row_begin( const char* attributes = 0 ) { return open("tr", attributes); }
+      html_builder& row_end()
+      {
+        close("tr");
+        return row_done();
+      }
+
+      html_builder& cell( const wchar_t* str )                    { open("td"); text(str); return close("td"); }
+      html_builder& cell( const char* ascii )                     { open("td"); text(ascii); return close("td"); }
+      html_builder& cell( const std::wstring& str )               { open("td"); text(str.c_str(), str.length()); return close("td"); }
+      html_builder& cell( int n )                                 { open("td"); number(n); return close("td"); }
+      html_builder& cell( double d, int fractional_digits = 1 )   { open("td"); number(d, fractional_digits); return close("td"); }
+
+      /** appends row made from the template, counts it as a row. **/
+      html_builder& row( const row_template& tpl,
+                         const field& p0 = field(), const field& p1 = field(), const field& p2 = field(), const field& p3 = field(),
+                         const field& p4 = field(), const field& p5 = field(), const field& p6 = field(), const field& p7 = field() )
+      {
+        const field* fields[8] = { &p0, &p1, &p2, &p3, &p4, &p5, &p6, &p7 };
+        for( size_t n = 0; n < tpl._segments.size(); ++n )
+        {
+          const row_template::segment& seg = tpl._segments[n];
+          raw(seg.literal.c_str(), seg.literal.length());
+          if( seg.field_no >= 0 && seg.field_no < 8 )
+            put(*fields[seg.field_no]);
+        }
+        return row_done();
+      }
+      /** the same as above but for templates with more than 8 placeholders. **/
+      html_builder& row( const row_template& tpl, const field* fields, size_t fields_count )
+      {
+        for( size_t n = 0; n < tpl._segments.size(); ++n )
+        {
+          const row_template::segment& seg = tpl._segments[n];
+          raw(seg.literal.c_str(), seg.literal.length());
+          if( seg.field_no >= 0 && size_t(seg.field_no) < fields_count )
+            put(fields[seg.field_no]);
+        }
+        return row_done();
+      }
+
+      /** submits composed markup to the target. **/
+      void flush()
+      {
+        if( !_target.is_valid() || _buf.length() == 0 )
+          return;
+        _bytes += _buf.length();
+        _target.set_html(_buf.data(), _buf.length(), _where);
+        _where = SIH_APPEND_AFTER_LAST;
+        _buf.clear();
+        _rows_in_chunk = 0;
+        ++_chunks;
+      }
+
+      /** composed markup, used when builder has no target **/
+      const byte* data()     { return _buf.data(); }
+      size_t      length() const { return _buf.length(); }
+      void        clear()    { _buf.clear(); _rows_in_chunk = 0; }
+
+      // statistics
+      UINT   rows() const   { return _rows; }   // rows appended so far
+      UINT   chunks() const { return _chunks; } // number of set_html calls made
+      size_t bytes() const  { return _bytes; }  // bytes submitted
+
+    private:
+      html_builder& row_done()
+      {
+        ++_rows;
+        if( _rows_per_chunk && ++_rows_in_chunk >= _rows_per_chunk )
+          flush();
+        return *this;
+      }
+
+      bool escape( unsigned int c )
+      {
+        switch(c)
+        {
+          case '<':  raw("&lt;",4); return true;
+          case '>':  raw("&gt;",4); return true;
+          case '&':  raw("&amp;",5); return true;
+          case '"':  raw("&quot;",6); return true;
+          case '\'': raw("&#39;",5); return true;
+        }
+        return false;
+      }
+
+      void put( const field& f )
+      {
+        switch( f.t )
+        {
+          case field::INT:   number(f.i); break;
+          case field::REAL:  number(f.d, 2); break;
+          case field::TEXT:  text(f.ws); break;
+          case field::ATEXT: text(f.as); break;
+          default: break;
+        }
+      }
+    };
+
+    inline html_builder& html_builder::text( const wchar_t* str, size_t length )
+    {
+      const wchar_t* end = str + length;
+      for( const wchar_t* pc = str; pc < end; ++pc )
+      {
+        unsigned int c = *pc;
+        if( c < 0x80 )
+        {
+          if( !escape(c) ) _buf.push(byte(c));
+          continue;
+        }
+        // UTF-16 surrogate pair
+        if( c >= 0xD800 && c <= 0xDBFF && pc + 1 < end && pc[1] >= 0xDC00 && pc[1] <= 0xDFFF )
+          c = 0x10000 + ((c - 0xD800) << 10) + (unsigned(*++pc) - 0xDC00);
+
+        if( c < (1 << 11) )
+        {
+          _buf.push(byte((c >> 6) | 0xc0));
+          _buf.push(byte((c & 0x3f) | 0x80));
+        }
+        else if( c < (1 << 16) )
+        {
+          _buf.push(byte((c >> 12) | 0xe0));
+          _buf.push(byte(((c >> 6) & 0x3f) | 0x80));
+          _buf.push(byte((c & 0x3f) | 0x80));
+        }
+        else
+        {
+          _buf.push(byte((c >> 18) | 0xf0));
+          _buf.push(byte(((c >> 12) & 0x3f) | 0x80));
+          _buf.push(byte(((c >> 6) & 0x3f) | 0x80));
+          _buf.push(byte((c & 0x3f) | 0x80));
+        }
+      }
+      return *this;
+    }
+
+  } // dom namespace
+
+} // htmlayout namespace
+
+#endif
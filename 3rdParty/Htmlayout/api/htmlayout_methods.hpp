@@ -0,0 +1,267 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Hashed tables of script methods of behaviors.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_methods_hpp__
+#define __htmlayout_methods_hpp__
+
+#pragma once
+
+/*!\file
+\brief script_methods<B> - name -> typed member handler table for XCALL_PARAMS calls.
+
+The table is built once from the static list of definitions (normally at static
+initialization of the module) and then is used without locks: the call costs
+one name hash, the probe and one virtual call of the method thunk.
+
+Handlers are members of the behavior B:
+ - typed: R B::f(HELEMENT he [, A0 [, A1 [, A2]]]) where A is int, bool, double, aux::wchars,
+   std::wstring or const json::value&; result (if not void) goes to retval;
+ - raw: BOOL B::f(HELEMENT he, UINT argc, json::value* argv, json::value& retval).
+
+The same name can be defined for different numbers of arguments. Calls with arguments
+that do not match any definition are not handled (FALSE) and go further as before.
+
+\par Example:
+\code
+  struct my_behavior: public behavior
+  {
+    void select( HELEMENT he, int index );
+    int  count( HELEMENT he );
+    static script_methods<my_behavior> methods;
+    virtual BOOL handle_script_call( HELEMENT he, XCALL_PARAMS& params ) { return methods.call(this, he, params); }
+  };
+
+  static script_methods<my_behavior>::def my_behavior_method_defs[] =
+  {
+    { "select", script_method(&my_behavior::select) },
+    { "count",  script_method(&my_behavior::count) },
+    { 0, 0 }
+  };
+  script_methods<my_behavior> my_behavior::methods( my_behavior_method_defs );
+\endcode
+*/
+
+#include <string>
+#include <vector>
+
+#include "htmlayout_behavior.hpp"
+#include "aux-hash.h"
+
+namespace htmlayout
+{
+
+  /** script_arg<T> - conversion of the script argument to T.
+   *  is() checks the type, get() reads the value, strings are not copied for aux::wchars.
+   **/
+  template <typename T> struct script_arg; // no conversion to this type
+
+  template <typename T> struct script_arg<const T>: script_arg<T> {};
+  template <typename T> struct script_arg<const T&>: script_arg<T> {};
+
+  template <> struct script_arg<int>
+  {
+    static bool is( const json::value& v ) { return v.is_int(); }
+    static int  get( const json::value& v ) { return v.get(0); }
+  };
+  template <> struct script_arg<bool>
+  {
+    static bool is( const json::value& v ) { return v.is_bool() || v.is_int(); }
+    static bool get( const json::value& v ) { return v.get(false); }
+  };
+  template <> struct script_arg<double>
+  {
+    static bool   is( const json::value& v ) { return v.is_float() || v.is_int(); }
+    static double get( const json::value& v ) { return v.is_int()? double(v.get(0)): v.get(0.0); }
+  };
+  template <> struct script_arg<aux::wchars>
+  {
+    static bool        is( const json::value& v ) { return v.is_string(); }
+    static aux::wchars get( const json::value& v ) { return v.get_chars(); }
+  };
+  template <> struct script_arg<std::wstring>
+  {
+    static bool         is( const json::value& v ) { return v.is_string(); }
+    static std::wstring get( const json::value& v ) { aux::wchars s = v.get_chars(); return std::wstring(s.start, s.length); }
+  };
+  template <> struct script_arg<json::value>
+  {
+    static bool               is( const json::value& ) { return true; }
+    static const json::value& get( const json::value& v ) { return v; }
+  };
+
+  /** script_result - receiver of the handler result: "f(...), script_result(retval)".
+   *  For void handlers the built-in comma is used and retval is left as is.
+   **/
+  struct script_result
+  {
+    json::value& retval;
+    explicit script_result( json::value& rv ): retval(rv) {}
+  };
+  template <typename T>
+    inline void operator , ( const T& v, const script_result& r ) { r.retval = json::value(v); }
+
+  template <class B>
+    class script_methods
+    {
+    public:
+      /** method - thunk of the member handler **/
+      struct method
+      {
+        UINT    argc;   // number of arguments, UINT(-1) - any (raw handler)
+        method* next;   // with the same name and other argc
+        method( UINT n ): argc(n), next(0) {}
+        virtual ~method() {}
+        virtual BOOL call( B* self, HELEMENT he, UINT argc, json::value* argv, json::value& retval ) const = 0;
+      };
+
+      struct def
+      {
+        const char* name; // static string
+        method*     m;    // owned by the table
+      };
+
+      script_methods( const def* defs )
+      {
+        for( ; defs->name; ++defs )
+        {
+          _methods.push_back(defs->m);
+          if( _table.insert(defs->name, defs->m) )
+            continue;
+          method* pm = _table.find(defs->name); // overload by number of arguments
+          while( pm->next ) pm = pm->next;
+          pm->next = defs->m;
+        }
+      }
+      ~script_methods()
+      {
+        for( size_t n = 0; n < _methods.size(); ++n )
+          delete _methods[n];
+      }
+
+      BOOL call( B* self, HELEMENT he, XCALL_PARAMS& params ) const
+      {
+        return call(self, he, params.method_name, params.argc, params.argv, params.retval);
+      }
+      BOOL call( B* self, HELEMENT he, LPCSTR name, UINT argc, json::value* argv, json::value& retval ) const
+      {
+        for( const method* pm = _table.find(name); pm; pm = pm->next )
+          if( pm->argc == argc || pm->argc == UINT(-1) )
+            return pm->call(self, he, argc, argv, retval);
+        return FALSE;
+      }
+
+      unsigned size() const { return _table.size(); }
+
+    private:
+      aux::name_table<method> _table;
+      std::vector<method*>    _methods;
+
+      script_methods(const script_methods&);
+      script_methods& operator=(const script_methods&);
+    };
+
+  namespace methods_impl
+  {
+    template <class B, class PM>
+      struct raw_method: script_methods<B>::method
+      {
+        PM pm;
+        raw_method( PM p ): script_methods<B>::method(UINT(-1)), pm(p) {}
+        virtual BOOL call( B* self, HELEMENT he, UINT argc, json::value* argv, json::value& retval ) const
+        {
+          return (self->*pm)(he, argc, argv, retval);
+        }
+      };
+
+    template <class B, class PM>
+      struct method0: script_methods<B>::method
+      {
+        PM pm;
+        method0( PM p ): script_methods<B>::method(0), pm(p) {}
+        virtual BOOL call( B* self, HELEMENT he, UINT, json::value*, json::value& retval ) const
+        {
+          ((self->*pm)(he), script_result(retval));
+          return TRUE;
+        }
+      };
+
+    template <class B, class A0, class PM>
+      struct method1: script_methods<B>::method
+      {
+        PM pm;
+        method1( PM p ): script_methods<B>::method(1), pm(p) {}
+        virtual BOOL call( B* self, HELEMENT he, UINT, json::value* argv, json::value& retval ) const
+        {
+          if( !script_arg<A0>::is(argv[0]) ) return FALSE;
+          ((self->*pm)(he, script_arg<A0>::get(argv[0])), script_result(retval));
+          return TRUE;
+        }
+      };
+
+    template <class B, class A0, class A1, class PM>
+      struct method2: script_methods<B>::method
+      {
+        PM pm;
+        method2( PM p ): script_methods<B>::method(2), pm(p) {}
+        virtual BOOL call( B* self, HELEMENT he, UINT, json::value* argv, json::value& retval ) const
+        {
+          if( !script_arg<A0>::is(argv[0]) || !script_arg<A1>::is(argv[1]) ) return FALSE;
+          ((self->*pm)(he, script_arg<A0>::get(argv[0]), script_arg<A1>::get(argv[1])), script_result(retval));
+          return TRUE;
+        }
+      };
+
+    template <class B, class A0, class A1, class A2, class PM>
+      struct method3: script_methods<B>::method
+      {
+        PM pm;
+        method3( PM p ): script_methods<B>::method(3), pm(p) {}
+        virtual BOOL call( B* self, HELEMENT he, UINT, json::value* argv, json::value& retval ) const
+        {
+          if( !script_arg<A0>::is(argv[0]) || !script_arg<A1>::is(argv[1]) || !script_arg<A2>::is(argv[2]) ) return FALSE;
+          ((self->*pm)(he, script_arg<A0>::get(argv[0]), script_arg<A1>::get(argv[1]), script_arg<A2>::get(argv[2])), script_result(retval));
+          return TRUE;
+        }
+      };
+  }
+
+  // script_method(&B::handler) - thunk for the script_methods<B>::def
+  template <class B>
+    inline typename script_methods<B>::method* script_method( BOOL (B::*pm)(HELEMENT, UINT, json::value*, json::value&) )
+      { return new methods_impl::raw_method<B, BOOL (B::*)(HELEMENT, UINT, json::value*, json::value&)>(pm); }
+  template <class B, class R>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT) )
+      { return new methods_impl::method0<B, R (B::*)(HELEMENT)>(pm); }
+  template <class B, class R, class A0>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0) )
+      { return new methods_impl::method1<B, A0, R (B::*)(HELEMENT, A0)>(pm); }
+  template <class B, class R, class A0, class A1>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0, A1) )
+      { return new methods_impl::method2<B, A0, A1, R (B::*)(HELEMENT, A0, A1)>(pm); }
+  template <class B, class R, class A0, class A1, class A2>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0, A1, A2) )
+      { return new methods_impl::method3<B, A0, A1, A2, R (B::*)(HELEMENT, A0, A1, A2)>(pm); }
+  template <class B, class R>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT) const )
+      { return new methods_impl::method0<B, R (B::*)(HELEMENT) const>(pm); }
+  template <class B, class R, class A0>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0) const )
+      { return new methods_impl::method1<B, A0, R (B::*)(HELEMENT, A0) const>(pm); }
+  template <class B, class R, class A0, class A1>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0, A1) const )
+      { return new methods_impl::method2<B, A0, A1, R (B::*)(HELEMENT, A0, A1) const>(pm); }
+  template <class B, class R, class A0, class A1, class A2>
+    inline typename script_methods<B>::method* script_method( R (B::*pm)(HELEMENT, A0, A1, A2) const )
+      { return new methods_impl::method3<B, A0, A1, A2, R (B::*)(HELEMENT, A0, A1, A2) const>(pm); }
+
+}
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Pooled allocation of per-element event handlers.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_pool_hpp__
+#define __htmlayout_pool_hpp__
+
+#pragma once
+
+/*!\file
+\brief Fixed size block pools and pooled<T> mixin for event handlers
+       that are created in attach() and deleted in detached().
+
+\par Example:
+\code
+  struct my_handler: public event_handler, public pooled<my_handler>
+  {
+    my_handler(): event_handler(HANDLE_MOUSE) {}
+    virtual void detached(HELEMENT) { delete this; } // goes back to the pool
+  };
+  ...
+  virtual event_handler* attach(HELEMENT) { return new my_handler(); } // taken from the pool
+\endcode
+*/
+
+#include <windows.h>
+#include <assert.h>
+#include <new>
+
+#if defined(_CPPRTTI)
+  #include <typeinfo>
+#endif
+
+#include "htmlayout_queue.h" // mutex
+
+namespace htmlayout
+{
+
+  /** pool_stats - counters of a pool, all pools are in one global list.
+   *  for( pool_stats* ps = pool_stats::first(); ps; ps = ps->next ) ...
+   **/
+  struct pool_stats
+  {
+    const char*   name;
+    size_t        block_size;
+    volatile LONG live;       // blocks in use
+    volatile LONG peak;       // max of live
+    volatile LONG allocs;     // total number of allocations
+    volatile LONG slabs;      // number of slabs taken from the heap
+    pool_stats*   next;
+
+    pool_stats( const char* pool_name, size_t sz ): name(pool_name), block_size(sz), live(0), peak(0), allocs(0), slabs(0), next(0)
+    {
+      next = first();
+      first(this);
+    }
+
+    static pool_stats* first( pool_stats* to_set = 0 )
+    {
+      static pool_stats* _first = 0;
+      if( to_set ) _first = to_set;
+      return _first;
+    }
+
+    void on_alloc()
+    {
+      ::InterlockedIncrement(&allocs);
+      LONG n = ::InterlockedIncrement(&live);
+      for( LONG p = peak; n > p; p = peak )
+        if( ::InterlockedCompareExchange(&peak, n, p) == p ) break;
+    }
+    void on_free() { ::InterlockedDecrement(&live); }
+  };
+
+  /** block_pool - allocator of fixed size blocks.
+   *  Blocks are carved from slabs and never returned to the heap
+   *  (pools are meant to be static objects). Pools of task_node_pool() and pooled<T>
+   *  are never destroyed: blocks can be freed by destructors of other statics
+   *  (e.g. gui_queue.clear() in a global destructor) and stats stay in pool_stats list.
+   *
+   *  With thread_cache == true each thread keeps up to CACHE_SIZE
+   *  free blocks in fiber local storage and takes/returns them without locking,
+   *  blocks move between the cache and the pool by CACHE_SIZE/2.
+   *  The cache of a thread goes back to the pool when the thread exits
+   *  (FLS callback) or when the thread calls flush().
+   *  Use it for pools of objects that are created and destroyed
+   *  by long living (GUI) threads.
+   *  With lazy_stats == true stats of a cached pool are updated on these moves only:
+   *  live counts blocks in thread caches too and allocs lags by up to CACHE_SIZE
+   *  per thread. Otherwise stats are exact.
+   **/
+  class block_pool
+  {
+    struct free_block { free_block* next; };
+    struct thread_cache_t { block_pool* owner; free_block* head; UINT count; LONG allocs; };
+
+    enum { CACHE_SIZE = 32 };
+
+    size_t      _block_size; // rounded up to MEMORY_ALLOCATION_ALIGNMENT
+    UINT        _blocks_per_slab;
+    free_block* _free;
+    mutex       _guard;
+    DWORD       _fls;
+    bool        _lazy_stats;
+    pool_stats  _stats;
+
+    block_pool(const block_pool&);
+    block_pool& operator=(const block_pool&);
+
+    void add_slab() // under lock
+    {
+      char* slab = static_cast<char*>(::operator new(_block_size * _blocks_per_slab));
+      for( UINT n = 0; n < _blocks_per_slab; ++n )
+      {
+        free_block* fb = reinterpret_cast<free_block*>(slab + n * _block_size);
+        fb->next = _free;
+        _free = fb;
+      }
+      ::InterlockedIncrement(&_stats.slabs);
+    }
+
+    void account( thread_cache_t* tc, LONG moved ) // under lock, lazy stats only
+    {
+      ::InterlockedExchangeAdd(&_stats.allocs, tc->allocs); tc->allocs = 0;
+      LONG n = ::InterlockedExchangeAdd(&_stats.live, moved) + moved;
+      if( n > _stats.peak ) ::InterlockedExchange(&_stats.peak, n);
+    }
+
+    thread_cache_t* cache()
+    {
+      if( _fls == FLS_OUT_OF_INDEXES ) return 0;
+      thread_cache_t* tc = static_cast<thread_cache_t*>(::FlsGetValue(_fls));
+      if( !tc )
+      {
+        tc = new thread_cache_t();
+        tc->owner = this; tc->head = 0; tc->count = 0; tc->allocs = 0;
+        ::FlsSetValue(_fls, tc);
+      }
+      return tc;
+    }
+
+    // gives all blocks of the cache back to the pool and deletes the cache
+    void release( thread_cache_t* tc )
+    {
+      {
+        critical_section cs(_guard);
+        LONG moved = 0;
+        while( tc->head )
+        {
+          free_block* t = tc->head;
+          tc->head = t->next;
+          t->next = _free;
+          _free = t;
+          ++moved;
+        }
+        if( _lazy_stats ) account(tc, -moved);
+      }
+      delete tc;
+    }
+
+    // FLS callback, called on thread exit and by FlsFree()
+    static void WINAPI release_cache( void* p )
+    {
+      if( p )
+      {
+        thread_cache_t* tc = static_cast<thread_cache_t*>(p);
+        tc->owner->release(tc);
+      }
+    }
+
+  public:
+    block_pool( size_t block_size, const char* name = "block_pool", UINT blocks_per_slab = 64, bool thread_cache = false, bool lazy_stats = false ):
+      _block_size( (block_size + MEMORY_ALLOCATION_ALIGNMENT - 1) & ~size_t(MEMORY_ALLOCATION_ALIGNMENT - 1) ),
+      _blocks_per_slab(blocks_per_slab? blocks_per_slab: 1), _free(0),
+      _fls( thread_cache? ::FlsAlloc(&release_cache): FLS_OUT_OF_INDEXES ),
+      _lazy_stats(thread_cache && lazy_stats),
+      _stats(name, block_size)
+    {
+    }
+    ~block_pool()
+    {
+      if( _fls != FLS_OUT_OF_INDEXES )
+        ::FlsFree(_fls); // releases caches of threads that are still running
+    }
+
+    size_t block_size() const { return _block_size; }
+    const pool_stats& stats() const { return _stats; }
+
+    // gives free blocks cached by the current thread back to the pool,
+    // e.g. before a thread that used the pool goes idle for a long time
+    void flush()
+    {
+      if( _fls == FLS_OUT_OF_INDEXES ) return;
+      thread_cache_t* tc = static_cast<thread_cache_t*>(::FlsGetValue(_fls));
+      if( !tc ) return;
+      ::FlsSetValue(_fls, 0);
+      release(tc);
+    }
+
+    void* alloc()
+    {
+      thread_cache_t* tc = cache();
+      if( tc )
+      {
+        if( !tc->head )
+        {
+          // refill the cache by half in one go
+          critical_section cs(_guard);
+          while( tc->count < CACHE_SIZE / 2 )
+          {
+            if( !_free ) add_slab();
+            free_block* fb = _free;
+            _free = fb->next;
+            fb->next = tc->head;
+            tc->head = fb; ++tc->count;
+          }
+          if( _lazy_stats ) account(tc, CACHE_SIZE / 2);
+        }
+        free_block* fb = tc->head;
+        tc->head = fb->next; --tc->count;
+        if( _lazy_stats ) ++tc->allocs;
+        else _stats.on_alloc();
+        return fb;
+      }
+      _stats.on_alloc();
+      critical_section cs(_guard);
+      if( !_free ) add_slab();
+      free_block* fb = _free;
+      _free = fb->next;
+      return fb;
+    }
+
+    void free( void* p )
+    {
+      if( !p ) return;
+      free_block* fb = static_cast<free_block*>(p);
+      thread_cache_t* tc = cache();
+      if( tc )
+      {
+        if( !_lazy_stats ) _stats.on_free();
+        fb->next = tc->head;
+        tc->head = fb; ++tc->count;
+        if( tc->count < CACHE_SIZE ) 
+          return;
+        // cache is full, give half of it back in one go
+        critical_section cs(_guard);
+        while( tc->count > CACHE_SIZE / 2 )
+        {
+          free_block* t = tc->head;
+          tc->head = t->next; --tc->count;
+          t->next = _free;
+          _free = t;
+        }
+        if( _lazy_stats ) account(tc, -LONG(CACHE_SIZE / 2));
+        return;
+      }
+      _stats.on_free();
+      critical_section cs(_guard);
+      fb->next = _free;
+      _free = fb;
+    }
+  };
+
+#if defined(HTMLAYOUT_QUEUE_POST)
+  /** nodes of tasks posted by queue::post(), see htmlayout_queue.h.
+   *  Producers take blocks from their thread caches, GUI thread returns them.
+   *  Stats are lazy: live includes blocks cached by producer threads.
+   **/
+  inline block_pool& task_node_pool()
+  {
+    static block_pool& _pool = *new block_pool( TASK_NODE_SIZE, "gui_task", 256, true, true ); // never destroyed
+    return _pool;
+  }
+  inline void* alloc_task_node()         { return task_node_pool().alloc(); }
+  inline void  free_task_node( void* p ) { task_node_pool().free(p); }
+#endif
+
+  /** pooled<T> - mixin that makes new/delete of T to use per-type block_pool.
+   *  Instances of classes derived from T (that have different size) go to the general heap.
+   *  Recycling happens in the regular delete, e.g. "delete this;" in event_handler::detached().
+   **/
+  template <class T>
+    struct pooled
+    {
+      static void* operator new( size_t sz )
+      {
+        if( sz != sizeof(T) ) return ::operator new(sz);
+        return pool().alloc();
+      }
+      static void operator delete( void* p, size_t sz )
+      {
+        if( sz != sizeof(T) ) ::operator delete(p);
+        else pool().free(p);
+      }
+
+      static block_pool& pool()
+      {
+#if defined(_CPPRTTI)
+        static block_pool& _pool = *new block_pool( sizeof(T), typeid(T).name(), 64, true ); // never destroyed
+#else
+        static block_pool& _pool = *new block_pool( sizeof(T), "pooled", 64, true ); // never destroyed
+#endif
+        return _pool;
+      }
+      // number of live instances of T
+      static LONG live() { return pool().stats().live; }
+    };
+
+  /** pooled_object<T> - pooled version of T that is not pooled by itself,
+   *  e.g. canvas_factory uses new pooled_object<CANVAS>().
+   **/
+  template <class T>
+    struct pooled_object: public T, public pooled< pooled_object<T> >
+    {
+      pooled_object() {}
+      static void* operator new( size_t sz ) { return pooled< pooled_object<T> >::operator new(sz); }
+      static void operator delete( void* p, size_t sz ) { pooled< pooled_object<T> >::operator delete(p, sz); }
+    };
+
+}
+
+#endif
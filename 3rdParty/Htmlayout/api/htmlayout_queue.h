@@ -20,10 +20,24 @@
 */
 #include <windows.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 
 #if defined(__cplusplus) && !defined( PLAIN_API_ONLY )
 
+#include "htmlayout_update_set.h"
+
+// queue::post(callable) needs move semantics and thread safe static initialization
+#if !defined(HTMLAYOUT_QUEUE_POST) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+  #define HTMLAYOUT_QUEUE_POST
+#endif
+
+#if defined(HTMLAYOUT_QUEUE_POST)
+  #include <memory>
+  #include <utility>
+  #include <type_traits>
+#endif
+
 namespace htmlayout 
 {
   class mutex 
@@ -43,80 +57,410 @@ namespace htmlayout
     ~critical_section() { m.unlock(); }
   };
 
+  // priority classes of tasks, each one has its own queue
+  enum GUI_TASK_PRIORITY
+  {
+    TASK_INPUT  = 0, // input-critical: feedback of user actions
+    TASK_NORMAL = 1,
+    TASK_IDLE   = 2, // background updates
+    TASK_PRIORITIES = 3
+  };
+
   // derive your own tasks from this and implement your own exec()
   class gui_task 
   {
     friend class queue;
     gui_task* next;
+    LONGLONG  pushed_at; // QueryPerformanceCounter
   public:
-    gui_task(): next(0) {}
+    gui_task(): next(0), pushed_at(0) {}
     virtual ~gui_task() {}
     virtual void exec() = 0; // override it 
   };
+
+  // metrics of one priority class, times are in QueryPerformanceCounter units
+  struct queue_stats
+  {
+    volatile LONG pushed;
+    LONG          executed;
+    LONG          dropped;     // by clear()
+    LONG          starved;     // tasks that ran before higher classes as they waited too long
+    LONGLONG      wait_ticks;  // total, push -> start of exec()
+    LONGLONG      wait_max;
+    LONGLONG      exec_ticks;  // total, of exec()
+    LONGLONG      exec_max;
+
+    LONG   depth() const { return pushed - executed - dropped; }
+    double avg_wait_ms() const { return executed? ms(wait_ticks) / executed: 0; }
+    double avg_exec_ms() const { return executed? ms(exec_ticks) / executed: 0; }
+    double max_wait_ms() const { return ms(wait_max); }
+    double max_exec_ms() const { return ms(exec_max); }
+
+    static LONGLONG now() { LARGE_INTEGER t; QueryPerformanceCounter(&t); return t.QuadPart; }
+    static LONGLONG frequency() { static LONGLONG f = 0; if( !f ) { LARGE_INTEGER t; QueryPerformanceFrequency(&t); f = t.QuadPart; } return f; }
+    static double   ms( LONGLONG ticks ) { return double(ticks) * 1000.0 / double(frequency()); }
+  };
+
+  // wakes up the GUI thread when the queue becomes non-empty
+  class queue_wakeup
+  {
+  public:
+    virtual ~queue_wakeup() {}
+    virtual void signal() = 0;
+  };
+
+  // default wakeup - WM_NULL to the message queue of the GUI thread
+  class thread_message_wakeup: public queue_wakeup
+  {
+    DWORD thread_id;
+  public:
+    thread_message_wakeup( DWORD gui_thread_id = GetCurrentThreadId() ): thread_id(gui_thread_id) {}
+    void set_thread( DWORD gui_thread_id ) { thread_id = gui_thread_id; }
+    virtual void signal() { PostThreadMessage(thread_id, WM_NULL, 0,0); }
+  };
+
+  // message to the window, it is dispatched by modal loops too (menus, dialogs, window move/size),
+  // window procedure shall call queue::execute() on it
+  class window_message_wakeup: public queue_wakeup
+  {
+    HWND hwnd;
+    UINT msg;
+  public:
+    window_message_wakeup( HWND hw, UINT message ): hwnd(hw), msg(message) {}
+    virtual void signal() { PostMessage(hwnd, msg, 0,0); }
+  };
   
+#if defined(HTMLAYOUT_QUEUE_POST)
+
+  enum { TASK_NODE_SIZE = 64 }; // cache line
+
+  // storage of task nodes, defined in htmlayout_pool.hpp
+  inline void* alloc_task_node();
+  inline void  free_task_node( void* p );
+
+  // tasks made by queue::post(), taken from the pool of TASK_NODE_SIZE blocks
+  class posted_task: public gui_task
+  {
+  public:
+    static void* operator new( size_t sz ) { assert(sz <= TASK_NODE_SIZE); sz; return alloc_task_node(); }
+    static void  operator delete( void* p ) { free_task_node(p); }
+  protected:
+    template <class F>
+      static void run( F& f )
+      {
+        try { f(); }
+        catch(...) { assert(false); } // exceptions shall not leave GUI tasks to the message pump
+      }
+  };
+
+  // callable stored in the node
+  template <class F>
+    class inline_task: public posted_task
+    {
+      F f;
+      inline_task(const inline_task&);
+      inline_task& operator=(const inline_task&);
+    public:
+      explicit inline_task( F&& fn ): f(std::move(fn)) {}
+      virtual void exec() { run(f); }
+    };
+
+  // callable that does not fit into the node, on the heap
+  template <class F>
+    class boxed_task: public posted_task
+    {
+      std::unique_ptr<F> pf;
+      boxed_task(const boxed_task&);
+      boxed_task& operator=(const boxed_task&);
+    public:
+      explicit boxed_task( F&& fn ): pf(new F(std::move(fn))) {}
+      virtual void exec() { run(*pf); }
+    };
+
+  template <class F, bool FITS = (sizeof(inline_task<F>) <= TASK_NODE_SIZE && std::alignment_of<F>::value <= MEMORY_ALLOCATION_ALIGNMENT)>
+    struct posted_task_of { typedef inline_task<F> type; };
+  template <class F>
+    struct posted_task_of<F, false> { typedef boxed_task<F> type; };
+
+#endif
+
   // this one needs to be created as singleton - one instance per GUI thread(s)
+  // push() is lock-free and can be called from any thread, execute() - from the GUI thread only.
+  // Producers push into the LIFO list of the priority class with CAS, the GUI thread takes
+  // whole lists with one exchange and keeps them as FIFO backlogs.
+  // The wakeup is signalled when a list goes from empty to non-empty. A signal can be lost,
+  // e.g. thread message in a modal loop, so while the list stays non-empty and execute() was not
+  // called since the last signal pushes signal again, not more often than once per resignal interval.
+  // Element updates requested by tasks through queue::update() are collected while execute()
+  // runs and issued at its end, one per top-most dirty element. dom::element::update() and
+  // updates made by code outside of tasks go to the engine immediately.
   class queue
   { 
-    gui_task* head;
-    gui_task* tail;
-    mutex     guard;
+    struct lane
+    {
+      gui_task* volatile inbox;   // last pushed
+      gui_task*          first;   // backlog, GUI thread only
+      gui_task*          last;
+      LONGLONG           max_wait; // starvation threshold, ticks
+      queue_stats        stats;
+    };
+    lane                  lanes[TASK_PRIORITIES];
+    queue_wakeup*         wakeup;
+    thread_message_wakeup default_wakeup; // of the thread that created the queue
+    volatile LONG         wakeups;
+    volatile LONG         executions;   // execute() calls
+    volatile LONG         signal_epoch; // executions at the last signal
+    volatile LONG         signal_tick;  // GetTickCount() at the last signal
+    UINT                  resignal_ms;
+    bool                  starved_turn; // last task was taken by starvation rule
+    bool                  coalesce;     // collect updates of tasks
+    dom::update_set       updates;      // dirtied by tasks of the current execute()
   
   public:
-    queue():head(0),tail(0) {}
+    queue():wakeups(0),executions(0),signal_epoch(0),signal_tick(0),resignal_ms(100),starved_turn(false),coalesce(true) 
+    { 
+      wakeup = &default_wakeup;
+      memset(lanes, 0, sizeof(lanes));
+      set_max_wait(TASK_NORMAL, 50);
+      set_max_wait(TASK_IDLE, 250);
+    }
+
+    // GUI thread is not the one that created the queue
+    void set_gui_thread( DWORD thread_id ) { default_wakeup.set_thread(thread_id); }
+    // other wakeup mechanism, e.g. SetEvent for MsgWaitForMultipleObjects loops, 0 - default one
+    void set_wakeup( queue_wakeup* pw ) { wakeup = pw? pw: &default_wakeup; }
+    // task of the class that waited longer than this goes before tasks of higher classes,
+    // such tasks interleave with tasks of higher classes one to one
+    void set_max_wait( UINT priority, UINT ms ) { lanes[priority].max_wait = LONGLONG(ms) * queue_stats::frequency() / 1000; }
+    // pushes to the non-empty queue signal again if there was no execute() for this long after the last signal
+    void set_resignal_interval( UINT ms ) { resignal_ms = ms; }
     
-    void push( gui_task* new_task )
+    void push( gui_task* new_task, UINT priority = TASK_NORMAL )
     {
       assert(new_task);
+      assert(priority < TASK_PRIORITIES);
+      lane& l = lanes[priority];
+      new_task->pushed_at = queue_stats::now();
+      ::InterlockedIncrement(&l.stats.pushed);
+      gui_task* top;
+      do
+      {
+        top = l.inbox;
+        new_task->next = top;
+      } 
+      while( InterlockedCompareExchangePointer((PVOID volatile*)&l.inbox, new_task, top) != top );
+      if( !top ) 
+        signal(LONG(::GetTickCount()));
+      else if( signal_epoch == executions ) // nobody took the tasks since the last signal
       {
-        critical_section cs(guard);
-        if( tail )
-          tail->next = new_task;
-        else
-          head = new_task;
-        tail = new_task;
+        LONG last = signal_tick;
+        LONG now = LONG(::GetTickCount());
+        if( now - last >= LONG(resignal_ms) && ::InterlockedCompareExchange(&signal_tick, now, last) == last )
+          signal(now);
       }
-      PostMessage(NULL, WM_NULL, 0,0);
     }
     
     
+#if defined(HTMLAYOUT_QUEUE_POST)
+    // posts callable, e.g. lambda, to be called in GUI thread. 
+    // Small closures are stored inline in pooled nodes, no heap allocations.
+    template <class F>
+      void post( F&& f, UINT priority = TASK_NORMAL )
+      {
+        typedef typename std::decay<F>::type callable;
+        typedef typename posted_task_of<callable>::type task;
+        push( new task( callable(std::forward<F>(f)) ), priority );
+      }
+#endif
+
     // Place this call after GetMessage()/PeekMessage() in main loop
-    void execute()
+    // budget_ms and max_tasks limit the run (0 - no limit), the rest of tasks
+    // stays in the queue and the wakeup is signalled again.
+    void execute( UINT budget_ms = 0, UINT max_tasks = 0 )
     {
-      gui_task* next;
-      while(next = pop())
+      ::InterlockedIncrement(&executions);
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p )
+        collect(lanes[p]);
+      if( !has_backlog() ) 
+        return;
+      drain_scope ds(this);
+      LONGLONG now = queue_stats::now();
+      LONGLONG deadline = now + LONGLONG(budget_ms) * queue_stats::frequency() / 1000;
+      for( UINT n = 1; ; ++n )
       {
-        next->exec(); // do it
-        delete next;
+        collect(lanes[TASK_INPUT]); // may come while we are running others
+        lane* pl = next_lane(now);
+        if( !pl ) break;
+        gui_task* t = pl->first;
+        pl->first = t->next;
+        if( !pl->first ) pl->last = 0;
+
+        LONGLONG wait = now - t->pushed_at;
+        t->exec(); // do it
+        delete t;
+        LONGLONG end = queue_stats::now();
+        queue_stats& st = pl->stats;
+        ++st.executed;
+        st.wait_ticks += wait; if( wait > st.wait_max ) st.wait_max = wait;
+        st.exec_ticks += end - now; if( end - now > st.exec_max ) st.exec_max = end - now;
+        now = end;
+
+        if( (max_tasks && n >= max_tasks) || (budget_ms && now >= deadline) )
+        {
+          if( has_backlog() ) wakeup->signal(); // rest on the next round
+          break;
+        }
       }
     }
     
+    // element update from a task, issued at the end of execute().
+    // Outside of execute(), with coalescing off or with REDRAW_NOW it is issued immediately.
+    void update( HELEMENT he, UINT flags = RESET_STYLE_DEEP | MEASURE_DEEP )
+    {
+      if( coalesce && !(flags & REDRAW_NOW) && draining() == this )
+        updates.add(he, flags);
+      else
+        HTMLayoutUpdateElementEx(he, flags);
+    }
+    // issues collected updates now, e.g. before reading element positions in a task
+    UINT flush_updates() { return updates.flush(); }
+    // collect updates of tasks (default) or let them go to the engine one by one
+    void set_coalesce_updates( bool on ) { if( !on ) flush_updates(); coalesce = on; }
+
+    // queue that runs tasks in the current thread, 0 outside of execute()
+    static queue* draining() { return static_cast<queue*>(::TlsGetValue(draining_slot())); }
+
     void clear()
     {
-      gui_task* next;
-      while(next = pop())
-        delete next;
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p )
+      {
+        lane& l = lanes[p];
+        collect(l);
+        gui_task* next;
+        for( gui_task* t = l.first; t; t = next )
+        {
+          next = t->next;
+          delete t;
+          ++l.stats.dropped;
+        }
+        l.first = l.last = 0;
+      }
     }
     bool is_empty() const
     { 
-      return head == 0; 
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p )
+        if( lanes[p].inbox || lanes[p].first ) return false;
+      return true;
+    }
+
+    // instrumentation: tasks pushed and wakeups signalled
+    LONG pushed() const 
+    { 
+      LONG n = 0;
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p ) n += lanes[p].stats.pushed;
+      return n;
+    }
+    LONG woken() const  { return wakeups; }
+    // instrumentation: element updates requested by tasks, issued and avoided
+    UINT updates_requested() const { return updates.requested(); }
+    UINT updates_issued() const    { return updates.issued(); }
+    UINT updates_saved() const     { return updates.saved(); }
+    // metrics of the priority class
+    const queue_stats& stats( UINT priority ) const { return lanes[priority].stats; }
+    // tasks waiting for execution
+    LONG depth() const 
+    { 
+      LONG n = 0;
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p ) n += lanes[p].stats.depth();
+      return n;
     }
 
   private:
-    gui_task* pop()
+    void signal( LONG tick )
+    {
+      signal_epoch = executions;
+      signal_tick = tick;
+      ::InterlockedIncrement(&wakeups);
+      wakeup->signal();
+    }
+
+    static DWORD draining_slot() { static DWORD _slot = ::TlsAlloc(); return _slot; }
+
+    // marks the thread as running tasks of the queue, flushes updates when done.
+    // execute() may be nested (modal loops in tasks), the outer one is restored.
+    struct drain_scope
+    {
+      queue* q;
+      queue* outer;
+      drain_scope( queue* pq ): q(pq), outer(draining()) { ::TlsSetValue(draining_slot(), q); }
+      ~drain_scope() 
+      { 
+        q->updates.flush(); 
+        ::TlsSetValue(draining_slot(), outer); 
+      }
+    };
+
+    // moves pushed tasks to the backlog, in order of pushes 
+    void collect( lane& l )
+    {
+      if( !l.inbox ) return;
+      gui_task* t = (gui_task*)InterlockedExchangePointer((PVOID volatile*)&l.inbox, 0);
+      gui_task* fifo = 0;
+      gui_task* tail = t;
+      while( t )
+      {
+        gui_task* next = t->next;
+        t->next = fifo;
+        fifo = t;
+        t = next;
+      }
+      if( !fifo ) return;
+      if( l.last ) l.last->next = fifo; else l.first = fifo;
+      l.last = tail;
+    }
+
+    bool has_backlog() const
     {
-      critical_section cs(guard);
-      if( !head ) return 0;
-      
-      gui_task* t = head; 
-      head = head->next;
-      if( !head ) tail = 0;
-      return t;
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p )
+        if( lanes[p].first ) return true;
+      return false;
+    }
+
+    // highest class first, unless a task of lower class waits too long
+    lane* next_lane( LONGLONG now )
+    {
+      bool may_starve = !starved_turn;
+      starved_turn = false;
+      if( may_starve )
+        for( UINT p = TASK_PRIORITIES - 1; p > 0; --p )
+        {
+          lane& l = lanes[p];
+          if( l.first && now - l.first->pushed_at > l.max_wait && higher_backlog(p) )
+          {
+            ++l.stats.starved;
+            starved_turn = true;
+            return &l;
+          }
+        }
+      for( UINT p = 0; p < TASK_PRIORITIES; ++p )
+        if( lanes[p].first ) return &lanes[p];
+      return 0;
+    }
+    bool higher_backlog( UINT priority ) const
+    {
+      for( UINT p = 0; p < priority; ++p )
+        if( lanes[p].first ) return true;
+      return false;
     }
   
   };
  
 }
 
+#if defined(HTMLAYOUT_QUEUE_POST)
+  #include "htmlayout_pool.hpp" // alloc_task_node(), free_task_node()
+#endif
+
 // for one GUI thread per application cases:
 extern htmlayout::queue gui_queue;
 
@@ -128,7 +472,7 @@ extern htmlayout::queue gui_queue;
 	while (GetMessageW(&msg, NULL, 0, 0)) 
 	{
     // execute asynchronous tasks in GUI thread.
-    gui_queue.execute(); // <-- here
+    gui_queue.execute(); // <-- here, or gui_queue.execute(8) to spend at most ~8ms in tasks
 
 		if (!TranslateAcceleratorW(msg.hwnd, hAccelTable, &msg)) 
 		{
@@ -158,10 +502,22 @@ extern htmlayout::queue gui_queue;
      {
        ...
        gui_queue.push( new append_and_update( parent, child ) );
+       // or gui_queue.push( new append_and_update( parent, child ), TASK_IDLE ); for bulk updates
      }
 
      so next queue::execute() invocation will execute that append_and_update::exec().
 
+     With C++11 compiler the same is
+     
+       gui_queue.post( [=]() { parent.append(child); gui_queue.update(parent); } );
+
+     gui_queue.update() calls of tasks are not made right away: if ten tasks of one execute() 
+     append lines to the same list, the list gets one update at the end of the execute().
+     dom::element::update() is immediate as always.
+
+   If the GUI thread is not the one that constructed gui_queue call
+   gui_queue.set_gui_thread( GetCurrentThreadId() ) from it before the message loop.
+
  */
 
 
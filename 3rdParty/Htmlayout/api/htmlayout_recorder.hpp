@@ -0,0 +1,502 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Recording and replay of event streams reaching event handlers.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_recorder_hpp__
+#define __htmlayout_recorder_hpp__
+
+#pragma once
+
+/*!\file
+\brief event_recorder writes calls of event handlers to a binary log,
+       event_replay calls the same handlers with recorded events and reports timings.
+
+Requires HTMLAYOUT_RECORD_EVENTS to be defined for all sources including htmlayout_behavior.hpp,
+otherwise event_handler::element_proc has no tap to record from.
+
+Recorded are HANDLE_MOUSE, HANDLE_KEY, HANDLE_FOCUS, HANDLE_SCROLL, HANDLE_TIMER,
+HANDLE_SIZE and HANDLE_BEHAVIOR_EVENT calls. Data value of behavior events is stored
+as JSON literal and is dropped if it does not fit into params.
+Element handles are stored as paths of child indexes from the root,
+so log recorded in one session can be replayed on the same document loaded in other one.
+
+Log format (little endian):
+\code
+  header: "HLEV" UINT32 version UINT64 ticks_per_second
+  record: UINT32 evtg UINT64 ticks
+          UINT16 length + chars  - handler class name
+          path                   - element the handler is attached to
+          UINT16 count + paths   - handles referred by params (target, etc.)
+          UINT16 length + bytes  - params, for behavior events:
+                                   UINT32 cmd UINT32 reason + UTF-16 JSON literal of data
+  path:   UINT16 depth (0xFFFF - null handle) + UINT32 child indexes
+\endcode
+
+\par Example:
+\code
+  // recording session
+  event_recorder rec("grid-scroll.hlev");
+  ...
+  // replay session, event_replay is created before the document is loaded
+  // so it knows handlers attached to elements
+  event_replay replay;
+  ... load document ...
+  replay_report rep = replay.run(hwnd, "grid-scroll.hlev", 0); // 0 - as fast as possible
+  std::string json; rep.write_json(json);
+\endcode
+*/
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "htmlayout_behavior.hpp"
+#include "htmlayout_traversal.hpp"
+
+#if defined(_CPPRTTI)
+  #include <typeinfo>
+#endif
+
+#if defined(HTMLAYOUT_RECORD_EVENTS)
+
+namespace htmlayout
+{
+
+  namespace recording
+  {
+    enum { VERSION = 1, NULL_PATH = 0xFFFF };
+
+    inline const char* handler_name( event_handler* h )
+    {
+#if defined(_CPPRTTI)
+      return typeid(*h).name();
+#else
+      h;
+      return "event_handler";
+#endif
+    }
+
+    // groups that are recorded
+    inline bool is_recorded( UINT evtg )
+    {
+      switch( evtg )
+      {
+        case HANDLE_MOUSE: case HANDLE_KEY: case HANDLE_FOCUS: case HANDLE_SCROLL:
+        case HANDLE_TIMER: case HANDLE_SIZE: case HANDLE_BEHAVIOR_EVENT:
+          return true;
+      }
+      return false;
+    }
+
+    // element handle fields of params
+    inline UINT handle_offsets( UINT evtg, size_t* offsets )
+    {
+      switch( evtg )
+      {
+        case HANDLE_MOUSE:  offsets[0] = offsetof(MOUSE_PARAMS, target); offsets[1] = offsetof(MOUSE_PARAMS, dragging); return 2;
+        case HANDLE_KEY:    offsets[0] = offsetof(KEY_PARAMS, target); return 1;
+        case HANDLE_FOCUS:  offsets[0] = offsetof(FOCUS_PARAMS, target); return 1;
+        case HANDLE_SCROLL: offsets[0] = offsetof(SCROLL_PARAMS, target); return 1;
+      }
+      return 0;
+    }
+
+    inline size_t params_size( UINT evtg )
+    {
+      switch( evtg )
+      {
+        case HANDLE_MOUSE:  return sizeof(MOUSE_PARAMS);
+        case HANDLE_KEY:    return sizeof(KEY_PARAMS);
+        case HANDLE_FOCUS:  return sizeof(FOCUS_PARAMS);
+        case HANDLE_SCROLL: return sizeof(SCROLL_PARAMS);
+        case HANDLE_TIMER:  return sizeof(TIMER_PARAMS);
+      }
+      return 0;
+    }
+
+    // child indexes from the root to the element
+    inline void path_of( HELEMENT he, std::vector<UINT>& path )
+    {
+      path.clear();
+      for( HELEMENT hp; he && (hp = dom::traversal::parent_of(he)) != 0; he = hp )
+        path.push_back( dom::traversal::index_of(he) );
+      std::reverse(path.begin(), path.end());
+    }
+
+    inline HELEMENT element_at( HELEMENT root, const std::vector<UINT>& path )
+    {
+      HELEMENT he = root;
+      for( size_t n = 0; he && n < path.size(); ++n )
+        he = path[n] < dom::traversal::children_count_of(he)? dom::traversal::child_of(he, path[n]): 0;
+      return he;
+    }
+
+    inline LONGLONG now() { LARGE_INTEGER t; ::QueryPerformanceCounter(&t); return t.QuadPart; }
+    inline LONGLONG ticks_per_second() { LARGE_INTEGER f; ::QueryPerformanceFrequency(&f); return f.QuadPart; }
+  }
+
+  /** event_recorder - writes calls of event handlers to the log while it exists.
+   *  GUI thread only.
+   **/
+  class event_recorder: public event_tap
+  {
+    FILE*                 _file;
+    LONGLONG              _start;
+    std::vector<byte>     _buf;
+    std::vector<UINT>     _path;
+    UINT                  _records;
+    bool                  _paused;
+
+    event_recorder(const event_recorder&);
+    event_recorder& operator=(const event_recorder&);
+
+    void put( const void* data, size_t length ) { const byte* p = (const byte*)data; _buf.insert(_buf.end(), p, p + length); }
+    void put16( UINT v ) { WORD w = WORD(v); put(&w, 2); }
+    void put32( UINT v ) { put(&v, 4); }
+    void put64( LONGLONG v ) { put(&v, 8); }
+    void put_behavior_params( const BEHAVIOR_EVENT_PARAMS* p )
+    {
+      json::value t = p->data;
+      LPCWSTR chars = 0; UINT nc = 0;
+      if( !t.is_undefined() && ValueToString(&t, CVT_JSON_LITERAL) == HV_OK )
+        ValueStringData(&t, &chars, &nc);
+      if( 8 + nc * sizeof(WCHAR) > 0xFFFF ) nc = 0; // too big for params
+      put16(UINT(8 + nc * sizeof(WCHAR)));
+      put32(p->cmd); put32(UINT(p->reason));
+      if( nc ) put(chars, nc * sizeof(WCHAR));
+    }
+    void put_path( HELEMENT he )
+    {
+      if( !he ) { put16(recording::NULL_PATH); return; }
+      recording::path_of(he, _path);
+      put16(UINT(_path.size()));
+      for( size_t n = 0; n < _path.size(); ++n ) put32(_path[n]);
+    }
+
+  public:
+    event_recorder( const char* path ): _file( fopen(path, "wb") ), _start( recording::now() ), _records(0), _paused(false)
+    {
+      if( !_file ) return;
+      put("HLEV", 4); put32(recording::VERSION); put64(recording::ticks_per_second());
+      install();
+    }
+    ~event_recorder() { close(); }
+
+    bool is_open() const  { return _file != 0; }
+    UINT records() const  { return _records; }
+    void pause( bool on ) { _paused = on; }
+
+    void flush()
+    {
+      if( _file && _buf.size() ) { fwrite(&_buf[0], 1, _buf.size(), _file); _buf.clear(); }
+    }
+    void close()
+    {
+      if( !_file ) return;
+      uninstall();
+      flush();
+      fclose(_file);
+      _file = 0;
+    }
+
+    virtual void on_event( event_handler* h, HELEMENT he, UINT evtg, LPVOID prms )
+    {
+      if( _paused || !recording::is_recorded(evtg) ) return;
+
+      put32(evtg);
+      put64(recording::now() - _start);
+      const char* name = recording::handler_name(h);
+      put16(UINT(strlen(name))); put(name, strlen(name));
+      put_path(he);
+
+      size_t offsets[2];
+      UINT nh = recording::handle_offsets(evtg, offsets);
+      if( evtg == HANDLE_BEHAVIOR_EVENT )
+      {
+        BEHAVIOR_EVENT_PARAMS* p = (BEHAVIOR_EVENT_PARAMS*)prms;
+        put16(2); put_path(p->heTarget); put_path(p->he);
+        put_behavior_params(p);
+      }
+      else
+      {
+        put16(nh);
+        for( UINT n = 0; n < nh; ++n )
+          put_path( *(HELEMENT*)((byte*)prms + offsets[n]) );
+        size_t sz = recording::params_size(evtg);
+        put16(UINT(sz));
+        if( sz )
+        {
+          size_t at = _buf.size();
+          put(prms, sz);
+          for( UINT n = 0; n < nh; ++n ) // handles are in paths
+            memset(&_buf[at + offsets[n]], 0, sizeof(HELEMENT));
+        }
+      }
+      ++_records;
+      if( _buf.size() > 64 * 1024 ) flush();
+    }
+  };
+
+  /** replay_report - timings of one replay **/
+  struct replay_report
+  {
+    struct group_timing
+    {
+      UINT   calls;
+      UINT   handled;
+      double total_us;
+      double max_us;
+    };
+    enum { GROUPS = 11 }; // bit number of EVENT_GROUPS value + 1, 0 - HANDLE_INITIALIZATION
+
+    UINT          records;       // records read
+    UINT          replayed;      // handler calls made
+    UINT          skipped;       // records of groups not replayed
+    UINT          unresolved;    // element or handler not found
+    double        recorded_ms;   // duration of the recording
+    double        wall_ms;       // duration of the replay
+    double        handlers_ms;   // time spent in handlers
+    group_timing  groups[GROUPS];
+
+    replay_report() { memset(this, 0, sizeof(*this)); }
+
+    static UINT group_index( UINT evtg )
+    {
+      UINT n = 0;
+      while( evtg ) { ++n; evtg >>= 1; }
+      return n < GROUPS? n: GROUPS - 1;
+    }
+
+    void write_json( std::string& out ) const
+    {
+      static const char* names[GROUPS] = { "initialization", "mouse", "key", "focus", "scroll", "timer", "size", "draw", "data_arrived", "behavior_event", "method_call" };
+      char buf[256];
+      _snprintf(buf, sizeof(buf), "{\"records\":%u,\"replayed\":%u,\"skipped\":%u,\"unresolved\":%u,\"recorded_ms\":%.3f,\"wall_ms\":%.3f,\"handlers_ms\":%.3f,\"groups\":{",
+        records, replayed, skipped, unresolved, recorded_ms, wall_ms, handlers_ms);
+      out += buf;
+      bool first = true;
+      for( UINT n = 0; n < GROUPS; ++n )
+      {
+        const group_timing& g = groups[n];
+        if( !g.calls ) continue;
+        _snprintf(buf, sizeof(buf), "%s\"%s\":{\"calls\":%u,\"handled\":%u,\"total_us\":%.3f,\"avg_us\":%.3f,\"max_us\":%.3f}",
+          first? "": ",", names[n], g.calls, g.handled, g.total_us, g.total_us / g.calls, g.max_us);
+        out += buf;
+        first = false;
+      }
+      out += "}}\n";
+    }
+  };
+
+  /** event_replay - knows handlers attached to elements (learns them from calls of element_proc
+   *  while it exists) and calls them with events read from the log.
+   *  GUI thread only.
+   **/
+  class event_replay: public event_tap
+  {
+    struct attached_handler
+    {
+      HELEMENT       he;
+      event_handler* handler;
+      const char*    name;
+    };
+    std::vector<attached_handler> _handlers;
+
+    event_replay(const event_replay&);
+    event_replay& operator=(const event_replay&);
+
+    // log reading
+    const byte* _pc;
+    const byte* _end;
+
+    bool get( void* to, size_t length )
+    {
+      if( size_t(_end - _pc) < length ) { _pc = _end; return false; }
+      memcpy(to, _pc, length); _pc += length;
+      return true;
+    }
+    UINT     get16() { WORD w = 0; get(&w, 2); return w; }
+    UINT     get32() { UINT v = 0; get(&v, 4); return v; }
+    LONGLONG get64() { LONGLONG v = 0; get(&v, 8); return v; }
+    void get_path( std::vector<UINT>& path, bool& is_null )
+    {
+      UINT depth = get16();
+      path.clear();
+      is_null = depth == recording::NULL_PATH;
+      if( is_null ) return;
+      for( UINT n = 0; n < depth; ++n ) path.push_back(get32());
+    }
+
+    event_handler* find_handler( HELEMENT he, const std::string& name ) const
+    {
+      for( size_t n = 0; n < _handlers.size(); ++n )
+        if( _handlers[n].he == he && name == _handlers[n].name )
+          return _handlers[n].handler;
+      return 0;
+    }
+
+    static void pump_messages()
+    {
+      MSG msg;
+      while( ::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) )
+      {
+        ::TranslateMessage(&msg);
+        ::DispatchMessage(&msg);
+      }
+    }
+
+  public:
+    UINT groups_to_replay; // HANDLE_TIMER is not replayed by default, live timers are running anyway
+
+    event_replay(): _pc(0), _end(0),
+      groups_to_replay( HANDLE_MOUSE | HANDLE_KEY | HANDLE_FOCUS | HANDLE_SCROLL | HANDLE_SIZE | HANDLE_BEHAVIOR_EVENT )
+    {
+      install();
+    }
+    ~event_replay() { uninstall(); }
+
+    virtual void on_event( event_handler* h, HELEMENT he, UINT evtg, LPVOID prms )
+    {
+      if( evtg == HANDLE_INITIALIZATION && ((INITIALIZATION_PARAMS*)prms)->cmd == BEHAVIOR_DETACH )
+      {
+        for( size_t n = _handlers.size(); n > 0; --n )
+          if( _handlers[n - 1].he == he && _handlers[n - 1].handler == h )
+            _handlers.erase(_handlers.begin() + (n - 1));
+        return;
+      }
+      for( size_t n = 0; n < _handlers.size(); ++n )
+        if( _handlers[n].he == he && _handlers[n].handler == h )
+          return;
+      attached_handler ah = { he, h, recording::handler_name(h) };
+      _handlers.push_back(ah);
+    }
+
+    /** replays the log against document loaded in the hwnd.
+     *  \param speed \b double, 1 - with recorded timing, 2 - twice faster, etc., 0 - as fast as possible.
+     **/
+    replay_report run( HWND hwnd, const char* path, double speed = 0 )
+    {
+      replay_report rep;
+      std::vector<byte> log;
+      FILE* f = fopen(path, "rb");
+      if( !f ) return rep;
+      byte chunk[4096];
+      for( size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0; )
+        log.insert(log.end(), chunk, chunk + n);
+      fclose(f);
+      if( log.size() < 16 || memcmp(&log[0], "HLEV", 4) != 0 ) return rep;
+
+      _pc = &log[0] + 4; _end = &log[0] + log.size();
+      if( get32() != recording::VERSION ) return rep;
+      const double rec_freq = double(get64());
+      const double freq = double(recording::ticks_per_second());
+
+      HELEMENT root = 0;
+      HTMLayoutGetRootElement(hwnd, &root);
+
+      std::vector<UINT> elpath;
+      std::vector<byte> params;
+      std::string       name;
+      LONGLONG          start = recording::now();
+
+      while( _pc < _end )
+      {
+        UINT     evtg  = get32();
+        LONGLONG ticks = get64();
+        UINT     nl    = get16();
+        name.assign((const char*)_pc, (const char*)_pc + (size_t(_end - _pc) < nl? size_t(_end - _pc): nl)); _pc += name.length();
+        bool is_null;
+        get_path(elpath, is_null);
+        HELEMENT he = is_null? 0: recording::element_at(root, elpath);
+
+        HELEMENT handles[2] = { 0, 0 };
+        bool     resolved = he != 0;
+        UINT     nh = get16();
+        for( UINT n = 0; n < nh; ++n )
+        {
+          get_path(elpath, is_null);
+          HELEMENT h = is_null? 0: recording::element_at(root, elpath);
+          if( !is_null && !h ) resolved = false;
+          if( n < 2 ) handles[n] = h;
+        }
+        UINT sz = get16();
+        params.assign(_pc, _pc + (size_t(_end - _pc) < sz? size_t(_end - _pc): sz)); _pc += params.size();
+        if( params.size() != sz ) break; // truncated log
+        ++rep.records;
+        rep.recorded_ms = double(ticks) * 1000.0 / rec_freq;
+
+        if( !(evtg & groups_to_replay) ) { ++rep.skipped; continue; }
+
+        event_handler* handler = resolved? find_handler(he, name): 0;
+        if( !handler ) { ++rep.unresolved; continue; }
+
+        if( speed > 0 ) // wait for the recorded time, keeping the window alive
+        {
+          LONGLONG due = start + LONGLONG( double(ticks) / rec_freq * freq / speed );
+          for( LONGLONG t = recording::now(); t < due; t = recording::now() )
+          {
+            pump_messages();
+            DWORD ms = DWORD( double(due - t) * 1000.0 / freq );
+            if( ms ) ::MsgWaitForMultipleObjects(0, NULL, FALSE, ms, QS_ALLINPUT);
+          }
+        }
+
+        // restore params
+        BEHAVIOR_EVENT_PARAMS bep;
+        bep.cmd = 0; bep.heTarget = 0; bep.he = 0; bep.reason = 0;
+        ValueInit(&bep.data);
+        LPVOID prms = params.size()? &params[0]: 0;
+        if( evtg == HANDLE_BEHAVIOR_EVENT )
+        {
+          if( params.size() >= 8 )
+          {
+            bep.cmd = *(UINT*)&params[0];
+            bep.reason = *(UINT*)&params[4];
+          }
+          if( params.size() > 8 )
+            ValueFromString(&bep.data, (LPCWSTR)&params[8], UINT((params.size() - 8) / sizeof(WCHAR)), CVT_JSON_LITERAL);
+          bep.heTarget = handles[0]; bep.he = handles[1];
+          prms = &bep;
+        }
+        else
+        {
+          size_t offsets[2];
+          UINT no = recording::handle_offsets(evtg, offsets);
+          for( UINT n = 0; n < no && n < nh; ++n )
+            if( offsets[n] + sizeof(HELEMENT) <= params.size() )
+              *(HELEMENT*)(&params[0] + offsets[n]) = handles[n];
+        }
+
+        LONGLONG t0 = recording::now();
+        BOOL handled = handler->event_proc()(handler, he, evtg, prms);
+        double us = double(recording::now() - t0) * 1e6 / freq;
+        ValueClear(&bep.data); // the value parsed from the log
+
+        replay_report::group_timing& g = rep.groups[replay_report::group_index(evtg)];
+        ++g.calls;
+        if( handled ) ++g.handled;
+        g.total_us += us;
+        if( us > g.max_us ) g.max_us = us;
+        rep.handlers_ms += us / 1000.0;
+        ++rep.replayed;
+      }
+      _pc = _end = 0;
+      rep.wall_ms = double(recording::now() - start) * 1000.0 / freq;
+      return rep;
+    }
+  };
+
+}
+
+#endif // HTMLAYOUT_RECORD_EVENTS
+
+#endif
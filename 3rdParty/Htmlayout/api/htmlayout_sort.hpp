@@ -0,0 +1,325 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Sorting of child elements by extracted keys.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_sort_hpp__
+#define __htmlayout_sort_hpp__
+
+#pragma once
+
+/*!\file
+\brief dom::sort_children - sorts children of the element by keys extracted once per child.
+
+Unlike element::sort() (that calls the comparator, and so the DOM, O(n*log(n)) times)
+sorting here goes in four steps:
+ -# key of each child is extracted once;
+ -# permutation of indexes is sorted in memory - radix sort for integer keys,
+    merge sort split between threads for large sets;
+ -# the permutation is decomposed into cycles;
+ -# elements are put in place by HTMLayoutSwapElements, n - number_of_cycles swaps in total,
+    and the parent is remeasured once after them.
+
+All DOM access happens in the calling (GUI) thread.
+*/
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <limits.h>
+
+#include "htmlayout_dom.hpp"
+
+namespace htmlayout
+{
+  namespace dom
+  {
+
+    /** sort_stats - what sort_children has done. **/
+    struct sort_stats
+    {
+      UINT elements;    // number of elements in the sorted range
+      UINT extractions; // number of key extractions (DOM reads)
+      UINT swaps;       // number of HTMLayoutSwapElements calls
+      UINT threads;     // number of threads used for sorting
+      sort_stats(): elements(0), extractions(0), swaps(0), threads(1) {}
+    };
+
+    namespace sorting
+    {
+      // sets above this size are sorted by several threads
+      enum { PARALLEL_THRESHOLD = 16 * 1024 };
+
+      /** stable LSD radix sort of the permutation by integer keys **/
+      inline void radix_sort( const std::vector<int>& keys, std::vector<UINT>& perm, bool ascending = true )
+      {
+        const size_t n = perm.size();
+        if( n < 2 ) return;
+        std::vector<unsigned> ukeys(keys.size());
+        for( size_t i = 0; i < keys.size(); ++i )
+        {
+          unsigned u = unsigned(keys[i]) ^ 0x80000000u; // signed -> unsigned order
+          ukeys[i] = ascending? u: ~u;
+        }
+        std::vector<UINT> tmp(n);
+        for( unsigned shift = 0; shift < 32; shift += 8 )
+        {
+          size_t count[257] = {0};
+          for( size_t i = 0; i < n; ++i )
+            ++count[ ((ukeys[perm[i]] >> shift) & 0xFF) + 1 ];
+          if( count[ ((ukeys[perm[0]] >> shift) & 0xFF) + 1 ] == n )
+            continue; // all keys have the same byte here
+          for( int b = 0; b < 256; ++b )
+            count[b + 1] += count[b];
+          for( size_t i = 0; i < n; ++i )
+            tmp[ count[ (ukeys[perm[i]] >> shift) & 0xFF ]++ ] = perm[i];
+          perm.swap(tmp);
+        }
+      }
+
+      template <typename LESS>
+        struct chunk_job
+        {
+          UINT*       first;
+          UINT*       last;
+          const LESS* less;
+          static DWORD WINAPI run( LPVOID prm )
+          {
+            chunk_job* self = static_cast<chunk_job*>(prm);
+            std::stable_sort(self->first, self->last, *self->less);
+            return 0;
+          }
+        };
+
+      inline UINT number_of_cpus()
+      {
+        SYSTEM_INFO si;
+        ::GetSystemInfo(&si);
+        return si.dwNumberOfProcessors? si.dwNumberOfProcessors: 1;
+      }
+
+      /** stable sort of the permutation, LESS compares indexes.
+       *  Large sets are split in chunks sorted by separate threads and merged after that.
+       *  \return \b UINT, number of threads used.
+       **/
+      template <typename LESS>
+        inline UINT sort_permutation( std::vector<UINT>& perm, const LESS& less, size_t parallel_threshold = PARALLEL_THRESHOLD )
+        {
+          const size_t n = perm.size();
+          UINT nthreads = number_of_cpus();
+          if( nthreads > 8 ) nthreads = 8;
+          if( n < parallel_threshold || nthreads < 2 )
+          {
+            std::stable_sort(perm.begin(), perm.end(), less);
+            return 1;
+          }
+
+          std::vector< chunk_job<LESS> > jobs(nthreads);
+          std::vector<HANDLE>            threads;
+          std::vector<size_t>            bounds(nthreads + 1);
+          for( UINT t = 0; t <= nthreads; ++t )
+            bounds[t] = (n * t) / nthreads;
+
+          UINT* base = &perm[0];
+          for( UINT t = 0; t < nthreads; ++t )
+          {
+            jobs[t].first = base + bounds[t];
+            jobs[t].last = base + bounds[t + 1];
+            jobs[t].less = &less;
+            if( t == 0 ) continue; // first chunk is ours
+            HANDLE h = ::CreateThread(NULL, 0, &chunk_job<LESS>::run, &jobs[t], 0, NULL);
+            if( h )
+              threads.push_back(h);
+            else
+              chunk_job<LESS>::run(&jobs[t]);
+          }
+          chunk_job<LESS>::run(&jobs[0]);
+          if( threads.size() )
+          {
+            ::WaitForMultipleObjects(DWORD(threads.size()), &threads[0], TRUE, INFINITE);
+            for( size_t i = 0; i < threads.size(); ++i )
+              ::CloseHandle(threads[i]);
+          }
+          // merge sorted chunks pairwise
+          for( UINT step = 1; step < nthreads; step *= 2 )
+            for( UINT t = 0; t + step < nthreads; t += step * 2 )
+            {
+              UINT last = t + step * 2; if( last > nthreads ) last = nthreads;
+              std::inplace_merge(base + bounds[t], base + bounds[t + step], base + bounds[last], less);
+            }
+          return UINT(threads.size() + 1);
+        }
+
+      /** puts children [start, start + perm.size()) of the parent in order defined by the permutation:
+       *  perm[i] is the old position (relative to start) of element that shall be at position i.
+       *  Uses one swap per misplaced element minus one per cycle, then updates the parent once.
+       *  \return \b UINT, number of swaps made.
+       **/
+      inline UINT apply_permutation( HELEMENT parent, UINT start, const std::vector<UINT>& perm )
+      {
+        const UINT n = UINT(perm.size());
+        std::vector<HELEMENT> at(n);     // element at position
+        std::vector<UINT>     pos(n);    // current position of element that was at i
+        std::vector<UINT>     orig(n);   // original index of element at position
+        for( UINT i = 0; i < n; ++i )
+        {
+          HTMLayoutGetNthChild(parent, start + i, &at[i]);
+          pos[i] = orig[i] = i;
+        }
+        UINT swaps = 0;
+        for( UINT i = 0; i < n; ++i )
+        {
+          UINT want = perm[i];
+          if( orig[i] == want ) continue;
+          UINT p = pos[want];
+          HLDOM_RESULT r = HTMLayoutSwapElements(at[i], at[p]);
+          assert(r == HLDOM_OK); r;
+          ++swaps;
+          std::swap(at[i], at[p]);
+          pos[orig[i]] = p;
+          pos[want] = i;
+          std::swap(orig[i], orig[p]);
+        }
+        if( swaps )
+          HTMLayoutUpdateElement(parent, TRUE); // the swaps do not remeasure the parent
+        return swaps;
+      }
+
+      // comparators of indexes
+
+      struct text_less
+      {
+        const std::vector<std::wstring>* keys;
+        bool ascending;
+        text_less( const std::vector<std::wstring>& k, bool asc ): keys(&k), ascending(asc) {}
+        bool operator()( UINT a, UINT b ) const
+        {
+          int r = wcscmp((*keys)[a].c_str(), (*keys)[b].c_str());
+          return ascending? r < 0: r > 0;
+        }
+      };
+
+      template <typename KEY, typename LESS>
+        struct key_less
+        {
+          const std::vector<KEY>* keys;
+          LESS less;
+          key_less( const std::vector<KEY>& k, const LESS& l ): keys(&k), less(l) {}
+          bool operator()( UINT a, UINT b ) const { return less((*keys)[a], (*keys)[b]); }
+        };
+
+      /** element to extract key from: the child itself or its n-th child (cell of the row) **/
+      inline HELEMENT key_element( HELEMENT child, int column )
+      {
+        if( column < 0 ) return child;
+        HELEMENT hc = 0;
+        HTMLayoutGetNthChild(child, UINT(column), &hc);
+        return hc;
+      }
+
+      inline void range( HELEMENT parent, int& start, int& end )
+      {
+        UINT count = 0;
+        HTMLayoutGetChildrenCount(parent, &count);
+        if( end < 0 || end > int(count) ) end = int(count);
+        if( start < 0 ) start = 0;
+        if( start > end ) start = end;
+      }
+    }
+
+    /** Sorts children [start,end) of the parent.
+     *  \param extractor \b KEY \b operator()(HELEMENT child) - called once per child.
+     *  \param less \b bool \b operator()(const KEY&, const KEY&).
+     **/
+    template <typename KEY, typename EXTRACTOR, typename LESS>
+      inline sort_stats sort_children( HELEMENT parent, const EXTRACTOR& extractor, const LESS& less, int start = 0, int end = -1 )
+      {
+        sort_stats stats;
+        sorting::range(parent, start, end);
+        UINT n = UINT(end - start);
+        if( n < 2 ) return stats;
+
+        std::vector<KEY> keys(n);
+        for( UINT i = 0; i < n; ++i )
+        {
+          HELEMENT hc = 0;
+          HTMLayoutGetNthChild(parent, start + i, &hc);
+          keys[i] = extractor(hc);
+        }
+        std::vector<UINT> perm(n);
+        for( UINT i = 0; i < n; ++i ) perm[i] = i;
+
+        stats.elements = stats.extractions = n;
+        stats.threads = sorting::sort_permutation(perm, sorting::key_less<KEY,LESS>(keys, less));
+        stats.swaps = sorting::apply_permutation(parent, UINT(start), perm);
+        return stats;
+      }
+
+    /** Sorts children [start,end) of the parent by text, e.g. rows of the table by text of cells in the column.
+     *  \param column \b int, index of the cell, or -1 to use text of the child itself.
+     **/
+    inline sort_stats sort_children_by_text( HELEMENT parent, int column, int start = 0, int end = -1, bool ascending = true )
+    {
+      sort_stats stats;
+      sorting::range(parent, start, end);
+      UINT n = UINT(end - start);
+      if( n < 2 ) return stats;
+
+      std::vector<std::wstring> keys(n);
+      for( UINT i = 0; i < n; ++i )
+      {
+        HELEMENT hc = 0;
+        HTMLayoutGetNthChild(parent, start + i, &hc);
+        HELEMENT hk = sorting::key_element(hc, column);
+        LPWSTR text = 0;
+        if( hk && HTMLayoutGetElementInnerText16(hk, &text) == HLDOM_OK && text )
+          keys[i] = text;
+      }
+      std::vector<UINT> perm(n);
+      for( UINT i = 0; i < n; ++i ) perm[i] = i;
+
+      stats.elements = stats.extractions = n;
+      stats.threads = sorting::sort_permutation(perm, sorting::text_less(keys, ascending));
+      stats.swaps = sorting::apply_permutation(parent, UINT(start), perm);
+      return stats;
+    }
+
+    /** Sorts children [start,end) of the parent by integer value of their text (or text of their cells), radix sort.
+     *  \param column \b int, index of the cell, or -1 to use text of the child itself.
+     **/
+    inline sort_stats sort_children_by_int( HELEMENT parent, int column, int start = 0, int end = -1, bool ascending = true, int default_value = INT_MIN )
+    {
+      sort_stats stats;
+      sorting::range(parent, start, end);
+      UINT n = UINT(end - start);
+      if( n < 2 ) return stats;
+
+      std::vector<int> keys(n);
+      for( UINT i = 0; i < n; ++i )
+      {
+        HELEMENT hc = 0;
+        HTMLayoutGetNthChild(parent, start + i, &hc);
+        HELEMENT hk = sorting::key_element(hc, column);
+        LPWSTR text = 0;
+        keys[i] = ( hk && HTMLayoutGetElementInnerText16(hk, &text) == HLDOM_OK )? aux::wtoi(text, default_value): default_value;
+      }
+      std::vector<UINT> perm(n);
+      for( UINT i = 0; i < n; ++i ) perm[i] = i;
+
+      stats.elements = stats.extractions = n;
+      sorting::radix_sort(keys, perm, ascending);
+      stats.swaps = sorting::apply_permutation(parent, UINT(start), perm);
+      return stats;
+    }
+
+  } // dom namespace
+
+} // htmlayout namespace
+
+#endif
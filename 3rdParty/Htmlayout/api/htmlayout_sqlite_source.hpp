@@ -0,0 +1,628 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * SQLite table as data source of behavior:virtual-grid.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_sqlite_source_hpp__
+#define __htmlayout_sqlite_source_hpp__
+
+#pragma once
+
+/*!\file
+\brief sqlite_source - data_source over a table of SQLite database with keyset pagination,
+       sqlite_rows_source - paged_rows_source that orders the table by clicked column.
+
+Pages are read by "WHERE (order, key) > (last order, last key) ORDER BY order, key LIMIT n"
+from the last record of the page before, so the cost of a page does not depend on how
+deep it is. NULLs of the ordering column are read as a separate range. Positions of
+records seen are remembered (bookmarks), a jump to the unknown position skips records
+from the nearest bookmark by OFFSET on the index, only keys are read. If the nearest
+bookmark is after the page (scrolling up) the page is read backwards from it by
+"WHERE (order, key) <= (bookmark) ORDER BY order DESC, key DESC LIMIT n" and reversed.
+
+The number of records is estimated on open from sqlite_stat1 (ANALYZE) or max(key),
+it becomes exact once the end of the table is read or by count_exact() (COUNT(*), slow,
+call it from a worker). The scrollbar range follows the estimate on the next scroll.
+
+Statements are prepared once and cached. One connection serves all fetches of the source,
+they are serialized; order_by(), total_records() do not wait for them.
+
+Needs C++11 and sqlite3 (sqlite3.h, sqlite3.lib), its native builds are not in 3rdParty/SQLite.
+Names of the table, the key and columns are SQL identifiers or expressions, they are
+not quoted. The key shall be unique and not null: rowid or INTEGER PRIMARY KEY.
+Index on the ordering column makes ordered pages cheap, like on the key.
+
+\par Example:
+\code
+  sqlite3* db = 0;
+  sqlite3_open_v2("log.db", &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, 0);
+  const char* cols[] = { "time", "level", "message" };
+  std::shared_ptr<sqlite_source> src = std::make_shared<sqlite_source>(db, "log", std::vector<std::string>(cols, cols + 3));
+  attach_event_handler( grid, new sqlite_rows_source(src, pool), HANDLE_BEHAVIOR_EVENT );
+  grid.post_event(INIT_DATA_VIEW);
+\endcode
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <stdlib.h>
+#include <limits.h>
+
+#include <sqlite3.h>
+
+#include "htmlayout_data_source.hpp"
+#include "aux-cvt.h"
+
+namespace htmlayout
+{
+
+  struct sqlite_source_stats
+  {
+    UINT prepared; // statements compiled
+    UINT reused;   // statements taken from the cache
+    UINT pages;    // fetch() calls
+    UINT seeks;    // of them started without bookmark
+    UINT backward; // of them read backwards from a bookmark after the page
+    UINT skipped;  // records skipped by seeks
+    UINT rows;     // records read
+  };
+
+  /** sqlite_source - records of the table in order of a column and the key **/
+  class sqlite_source: public data_source
+  {
+  public:
+    // db shall be open in serialized mode (SQLITE_OPEN_FULLMUTEX) if it is used by others too
+    sqlite_source( sqlite3* db, const char* table, const std::vector<std::string>& columns, const char* key = "rowid" ):
+      _db(db), _table(table), _key(key), _columns(columns), _total(0), _exact(false)
+    {
+      memset(&_stats, 0, sizeof(_stats));
+      _order.column = -1;
+      _order.ascending = true;
+      _order.generation = 0;
+      _row_values = sqlite3_libversion_number() >= 3015000; // (a, b) > (?, ?)
+      detect_types();
+      estimate_count();
+    }
+    virtual ~sqlite_source()
+    {
+      for( statements_t::iterator it = _statements.begin(); it != _statements.end(); ++it )
+        sqlite3_finalize(it->second);
+    }
+
+    virtual UINT total_records() { critical_section cs(_state); return _total; }
+    virtual UINT columns() { return UINT(_columns.size()); }
+
+    const std::string& column_name( UINT n ) const { return _columns[n]; }
+    bool count_is_exact() { critical_section cs(_state); return _exact; }
+    const sqlite_source_stats& stats() const { return _stats; }
+
+    // records are ordered by the column then by the key, column < 0 - by the key only.
+    // Bookmarks are dropped, call data_pager::invalidate() after it.
+    void order_by( int column, bool ascending )
+    {
+      critical_section cs(_state);
+      _order.column = column < int(_columns.size())? column: -1;
+      _order.ascending = ascending;
+      ++_order.generation;
+      _bookmarks.clear();
+    }
+    int  order_column() { critical_section cs(_state); return _order.column; }
+    bool order_ascending() { critical_section cs(_state); return _order.ascending; }
+
+    // COUNT(*), reads the whole table or its smallest index
+    UINT count_exact()
+    {
+      critical_section cs(_lock);
+      sqlite3_stmt* st = statement("SELECT COUNT(*) FROM " + _table);
+      if( !st || sqlite3_step(st) != SQLITE_ROW ) { done(st); return total_records(); }
+      UINT n = record_count(sqlite3_column_int64(st, 0));
+      done(st);
+      critical_section cs2(_state);
+      _total = n;
+      _exact = true;
+      return n;
+    }
+
+    virtual bool fetch( UINT first, UINT count, record_batch& batch )
+    {
+      critical_section cs(_lock);
+      order ord;
+      bookmark bm, up;
+      UINT from = 0; // position bm is for, 0 - the beginning
+      UINT to = 0;   // position up is for, 0 - none after the page
+      {
+        critical_section cs2(_state);
+        ord = _order;
+        bookmarks_t::iterator it = _bookmarks.lower_bound(first + count);
+        if( it != _bookmarks.end() ) { to = it->first; up = it->second; }
+        it = _bookmarks.upper_bound(first);
+        if( it != _bookmarks.begin() ) { --it; from = it->first; bm = it->second; }
+      }
+      ++_stats.pages;
+
+      const UINT ncols = UINT(_columns.size());
+      batch.first = first;
+      batch.count = 0;
+      batch.columns.resize(ncols);
+      for( UINT c = 0; c < ncols; ++c )
+      {
+        column_batch& b = batch.columns[c];
+        b.type = _types[c];
+        b.ints.clear(); b.reals.clear(); b.texts.clear(); b.nulls.clear();
+      }
+
+      if( to && count && to - (first + count) < first - from )
+        return fetch_backward(ord, first, count, to, up, batch);
+
+      SEGMENT segs[2];
+      UINT nsegs = segments(ord, segs);
+      UINT si = 0;
+      bool after = from > 0;
+      if( after )
+        while( si < nsegs - 1 && segs[si] != segment_of(ord, bm) ) ++si;
+
+      // bookmark of the record before the first one: skip records by OFFSET, segment by segment
+      if( from < first )
+      {
+        ++_stats.seeks;
+        _stats.skipped += first - from;
+        UINT skip = first - from;
+        for( ;; )
+        {
+          sqlite3_stmt* st = statement( query(ord, segs[si], after, Q_SEEK) );
+          if( !st ) return false;
+          bind(st, bm, segs[si], after);
+          sqlite3_bind_int64(st, 3, skip - 1);
+          int rc = sqlite3_step(st);
+          if( rc == SQLITE_ROW ) { bm.key.load(st, 0); bm.value.load(st, 1); }
+          done(st);
+          if( rc == SQLITE_ROW ) break;
+          if( rc != SQLITE_DONE ) return false;
+          // fewer than skip records in the rest of the segment
+          st = statement( query(ord, segs[si], after, Q_COUNT) );
+          if( !st ) return false;
+          bind(st, bm, segs[si], after);
+          rc = sqlite3_step(st);
+          UINT n = rc == SQLITE_ROW? record_count(sqlite3_column_int64(st, 0)): 0;
+          done(st);
+          if( rc != SQLITE_ROW ) return false;
+          skip -= n;
+          after = false;
+          if( ++si == nsegs ) { exact(ord, first - skip); return true; } // fewer records than estimated
+        }
+        remember(ord, first, bm);
+        after = true;
+      }
+
+      for( ; si < nsegs && batch.count < count; ++si, after = false )
+      {
+        sqlite3_stmt* st = statement( query(ord, segs[si], after, Q_PAGE) );
+        if( !st ) return false;
+        bind(st, bm, segs[si], after);
+        sqlite3_bind_int64(st, 3, count - batch.count);
+        int rc;
+        while( (rc = sqlite3_step(st)) == SQLITE_ROW )
+        {
+          read_row(st, batch);
+          bm.key.load(st, 0);
+          bm.value.load(st, 1);
+        }
+        done(st);
+        if( rc != SQLITE_DONE ) return false;
+      }
+      _stats.rows += batch.count;
+
+      critical_section cs2(_state);
+      if( ord.generation != _order.generation ) return true; // order changed while it was read
+      if( batch.count ) _bookmarks[first + batch.count] = bm;
+      if( batch.count < count ) { _total = first + batch.count; _exact = true; }
+      else if( !_exact && first + batch.count >= _total ) _total = first + batch.count + count; // estimate was low
+      return true;
+    }
+
+  private:
+    // value of the column of the row, bound back as is
+    struct db_value
+    {
+      int         type;
+      LONGLONG    i;
+      double      d;
+      std::string s;
+      db_value(): type(SQLITE_NULL), i(0), d(0) {}
+      void load( sqlite3_stmt* st, int col )
+      {
+        type = sqlite3_column_type(st, col);
+        switch( type )
+        {
+          case SQLITE_INTEGER: i = sqlite3_column_int64(st, col); break;
+          case SQLITE_FLOAT:   d = sqlite3_column_double(st, col); break;
+          case SQLITE_TEXT:
+          case SQLITE_BLOB:
+            {
+              const void* p = sqlite3_column_blob(st, col);
+              s.assign( p? (const char*)p: "", sqlite3_column_bytes(st, col) );
+            }
+            break;
+        }
+      }
+      void bind( sqlite3_stmt* st, int n ) const
+      {
+        switch( type )
+        {
+          case SQLITE_INTEGER: sqlite3_bind_int64(st, n, i); break;
+          case SQLITE_FLOAT:   sqlite3_bind_double(st, n, d); break;
+          case SQLITE_TEXT:    sqlite3_bind_text(st, n, s.data(), int(s.length()), SQLITE_TRANSIENT); break;
+          case SQLITE_BLOB:    sqlite3_bind_blob(st, n, s.data(), int(s.length()), SQLITE_TRANSIENT); break;
+          default:             sqlite3_bind_null(st, n); break;
+        }
+      }
+    };
+    // order value and key of the record before the position
+    struct bookmark
+    {
+      db_value value;
+      db_value key;
+    };
+    struct order
+    {
+      int  column;
+      bool ascending;
+      UINT generation;
+    };
+    // the order is made of segments that are read by index ranges:
+    // NULLs of the column are first in ASC order of SQLite and last in DESC
+    enum SEGMENT { SEG_KEYS, SEG_NULLS, SEG_VALUES };
+    enum QUERY   { Q_PAGE, Q_SEEK, Q_COUNT };
+
+    typedef std::map<std::string, sqlite3_stmt*> statements_t;
+    typedef std::map<UINT, bookmark>             bookmarks_t;
+
+    sqlite3*                      _db;
+    std::string                   _table;
+    std::string                   _key;
+    std::vector<std::string>      _columns;
+    std::vector<DATA_COLUMN_TYPE> _types;
+    bool                          _row_values;
+    mutex                         _lock;       // the connection, statements, stats
+    statements_t                  _statements;
+    sqlite_source_stats           _stats;
+    mutex                         _state;      // members below
+    order                         _order;
+    bookmarks_t                   _bookmarks;
+    UINT                          _total;
+    bool                          _exact;
+
+    sqlite_source( const sqlite_source& );
+    sqlite_source& operator=( const sqlite_source& );
+
+    // records [first, first + count) from the bookmark of the position to, records before
+    // the bookmark (and it) are read in reverse order and the batch is reversed then
+    bool fetch_backward( const order& ord, UINT first, UINT count, UINT to, bookmark bm, record_batch& batch )
+    {
+      ++_stats.backward;
+      SEGMENT segs[2];
+      UINT nsegs = segments(ord, segs);
+      UINT si = nsegs - 1;
+      while( si > 0 && segs[si] != segment_of(ord, bm) ) --si;
+      bool at = true; // at or before bm, end of the segment otherwise
+
+      // the bookmark is the record to - 1: skip records to the last one of the page
+      UINT skip = to - (first + count);
+      if( skip )
+      {
+        ++_stats.seeks;
+        _stats.skipped += skip;
+        for( ;; )
+        {
+          sqlite3_stmt* st = statement( query(ord, segs[si], at, Q_SEEK, true) );
+          if( !st ) return false;
+          bind(st, bm, segs[si], at);
+          sqlite3_bind_int64(st, 3, skip);
+          int rc = sqlite3_step(st);
+          if( rc == SQLITE_ROW ) { bm.key.load(st, 0); bm.value.load(st, 1); }
+          done(st);
+          if( rc == SQLITE_ROW ) break;
+          if( rc != SQLITE_DONE ) return false;
+          // fewer than skip records in the segment before
+          st = statement( query(ord, segs[si], at, Q_COUNT, true) );
+          if( !st ) return false;
+          bind(st, bm, segs[si], at);
+          rc = sqlite3_step(st);
+          UINT n = rc == SQLITE_ROW? record_count(sqlite3_column_int64(st, 0)): 0;
+          done(st);
+          if( rc != SQLITE_ROW || si == 0 ) return false; // the table has changed
+          skip -= n;
+          at = false;
+          --si;
+        }
+        at = true;
+      }
+      bookmark last = bm; // of the position first + count
+
+      // one record more: the one before the first is the bookmark of the first
+      UINT want = first? count + 1: count;
+      UINT got = 0;
+      bookmark before;
+      for( ;; --si, at = false )
+      {
+        sqlite3_stmt* st = statement( query(ord, segs[si], at, Q_PAGE, true) );
+        if( !st ) return false;
+        bind(st, bm, segs[si], at);
+        sqlite3_bind_int64(st, 3, want - got);
+        int rc;
+        while( (rc = sqlite3_step(st)) == SQLITE_ROW )
+        {
+          if( got++ < count )
+            read_row(st, batch);
+          else
+          {
+            before.key.load(st, 0);
+            before.value.load(st, 1);
+          }
+        }
+        done(st);
+        if( rc != SQLITE_DONE ) return false;
+        if( got == want || si == 0 ) break;
+      }
+      reverse_rows(batch);
+      _stats.rows += batch.count;
+
+      critical_section cs(_state);
+      if( ord.generation != _order.generation ) return true; // order changed while it was read
+      if( batch.count ) _bookmarks[first + batch.count] = last;
+      if( first && got == want ) _bookmarks[first] = before;
+      return true;
+    }
+
+    static void reverse_rows( record_batch& batch )
+    {
+      for( UINT c = 0; c < batch.columns.size(); ++c )
+      {
+        column_batch& b = batch.columns[c];
+        std::reverse(b.ints.begin(), b.ints.end());
+        std::reverse(b.reals.begin(), b.reals.end());
+        std::reverse(b.texts.begin(), b.texts.end());
+        std::reverse(b.nulls.begin(), b.nulls.end());
+      }
+    }
+
+    // cached statement, reset by done()
+    sqlite3_stmt* statement( const std::string& sql )
+    {
+      statements_t::iterator it = _statements.find(sql);
+      if( it != _statements.end() ) { ++_stats.reused; return it->second; }
+      sqlite3_stmt* st = 0;
+      if( sqlite3_prepare_v2(_db, sql.c_str(), int(sql.length()), &st, 0) != SQLITE_OK )
+        return 0;
+      ++_stats.prepared;
+      _statements[sql] = st;
+      return st;
+    }
+    static void done( sqlite3_stmt* st )
+    {
+      if( !st ) return;
+      sqlite3_reset(st);
+      sqlite3_clear_bindings(st);
+    }
+
+    static UINT segments( const order& ord, SEGMENT* segs )
+    {
+      if( ord.column < 0 ) { segs[0] = SEG_KEYS; return 1; }
+      segs[0] = ord.ascending? SEG_NULLS: SEG_VALUES;
+      segs[1] = ord.ascending? SEG_VALUES: SEG_NULLS;
+      return 2;
+    }
+    static SEGMENT segment_of( const order& ord, const bookmark& bm )
+    {
+      if( ord.column < 0 ) return SEG_KEYS;
+      return bm.value.type == SQLITE_NULL? SEG_NULLS: SEG_VALUES;
+    }
+
+    // records of the segment, after the bookmark or from the beginning of the segment.
+    // backward - in reverse order, at or before the bookmark or from the end of the segment.
+    // ?1 - order value, ?2 - key of the bookmark, ?3 - LIMIT or OFFSET.
+    std::string query( const order& ord, SEGMENT seg, bool after, QUERY q, bool backward = false ) const
+    {
+      const std::string& by = ord.column < 0? _key: _columns[ord.column];
+      bool up = ord.ascending != backward;
+      const char* dir = up? " ASC": " DESC";
+      const char* cmp = up? " > ": " < ";                             // of order values
+      const char* kcmp = backward? (up? " >= ": " <= "): cmp;          // of keys and (value, key) pairs
+      std::string sql = "SELECT ";
+      if( q == Q_COUNT )
+        sql += "COUNT(*)";
+      else
+      {
+        sql += _key + ", " + by;
+        if( q == Q_PAGE )
+          for( size_t c = 0; c < _columns.size(); ++c )
+            sql += ", " + _columns[c];
+      }
+      sql += " FROM " + _table;
+      switch( seg )
+      {
+        case SEG_KEYS:
+          if( after ) sql += " WHERE " + _key + kcmp + "?2";
+          break;
+        case SEG_NULLS:
+          sql += " WHERE " + by + " IS NULL";
+          if( after ) sql += " AND " + _key + kcmp + "?2";
+          break;
+        case SEG_VALUES: // comparisons are false for NULLs
+          if( !after )
+            sql += " WHERE " + by + " IS NOT NULL";
+          else if( _row_values )
+            sql += " WHERE (" + by + ", " + _key + ")" + kcmp + "(?1, ?2)";
+          else
+            sql += " WHERE " + by + cmp + "?1 OR (" + by + " = ?1 AND " + _key + kcmp + "?2)";
+          break;
+      }
+      if( q == Q_COUNT ) return sql;
+      sql += " ORDER BY ";
+      if( seg == SEG_VALUES ) sql += by + dir + ", ";
+      sql += _key + dir;
+      sql += q == Q_SEEK? " LIMIT 1 OFFSET ?3": " LIMIT ?3";
+      return sql;
+    }
+    static void bind( sqlite3_stmt* st, const bookmark& bm, SEGMENT seg, bool after )
+    {
+      if( !after ) return;
+      if( seg == SEG_VALUES ) bm.value.bind(st, 1);
+      bm.key.bind(st, 2);
+    }
+
+    void read_row( sqlite3_stmt* st, record_batch& batch )
+    {
+      for( UINT c = 0; c < batch.columns.size(); ++c )
+      {
+        column_batch& b = batch.columns[c];
+        int i = int(c) + 2; // key, order value, columns
+        bool null = sqlite3_column_type(st, i) == SQLITE_NULL;
+        if( null && b.nulls.empty() ) b.nulls.resize(batch.count, 0);
+        if( !b.nulls.empty() ) b.nulls.push_back(null);
+        switch( b.type )
+        {
+          case DATA_INT:  b.ints.push_back(sqlite3_column_int64(st, i)); break;
+          case DATA_REAL: b.reals.push_back(sqlite3_column_double(st, i)); break;
+          case DATA_TEXT:
+            {
+              const char* t = (const char*)sqlite3_column_text(st, i);
+              int n = sqlite3_column_bytes(st, i);
+              if( t && n ) { aux::utf2w w(t, n); b.texts.push_back( std::wstring(w, w.length()) ); }
+              else b.texts.push_back( std::wstring() );
+            }
+            break;
+        }
+      }
+      ++batch.count;
+    }
+
+    void remember( const order& ord, UINT pos, const bookmark& bm )
+    {
+      critical_section cs(_state);
+      if( ord.generation == _order.generation )
+        _bookmarks[pos] = bm;
+    }
+    void exact( const order& ord, UINT total )
+    {
+      critical_section cs(_state);
+      if( ord.generation != _order.generation ) return;
+      _total = total;
+      _exact = true;
+    }
+
+    // by declared types of the columns, like SQLite affinity
+    void detect_types()
+    {
+      _types.assign(_columns.size(), DATA_TEXT);
+      std::string sql = "SELECT ";
+      for( size_t c = 0; c < _columns.size(); ++c )
+        sql += (c? ", ": "") + _columns[c];
+      sql += " FROM " + _table + " LIMIT 0";
+      sqlite3_stmt* st = 0;
+      if( sqlite3_prepare_v2(_db, sql.c_str(), -1, &st, 0) != SQLITE_OK )
+        return;
+      for( size_t c = 0; c < _columns.size(); ++c )
+      {
+        std::string t = sqlite3_column_decltype(st, int(c))? sqlite3_column_decltype(st, int(c)): "";
+        for( size_t i = 0; i < t.length(); ++i ) t[i] = char(toupper(t[i]));
+        if( t.find("INT") != std::string::npos )
+          _types[c] = DATA_INT;
+        else if( t.find("REAL") != std::string::npos || t.find("FLOA") != std::string::npos || t.find("DOUB") != std::string::npos )
+          _types[c] = DATA_REAL;
+      }
+      sqlite3_finalize(st);
+    }
+
+    // the grid addresses records by UINT, the rest of a bigger table is not reachable
+    static UINT record_count( sqlite3_int64 n ) { return n <= 0? 0: n >= sqlite3_int64(UINT_MAX)? UINT_MAX: UINT(n); }
+
+    // row count of the table or its index from ANALYZE, max(key) otherwise, COUNT(*) as the last resort
+    void estimate_count()
+    {
+      critical_section cs(_lock);
+      sqlite3_stmt* st = statement("SELECT stat FROM sqlite_stat1 WHERE tbl = ?1");
+      if( st )
+      {
+        sqlite3_bind_text(st, 1, _table.c_str(), -1, SQLITE_TRANSIENT);
+        while( sqlite3_step(st) == SQLITE_ROW )
+        {
+          const char* stat = (const char*)sqlite3_column_text(st, 0);
+          UINT n = stat? record_count(strtoll(stat, 0, 10)): 0;
+          if( n > _total ) _total = n;
+        }
+        done(st);
+        if( _total ) return;
+      }
+      // keys beyond UINT range are sparse or negative ones, they tell nothing about the count
+      st = statement("SELECT max(" + _key + ") FROM " + _table);
+      if( st && sqlite3_step(st) == SQLITE_ROW && sqlite3_column_type(st, 0) == SQLITE_INTEGER &&
+          sqlite3_column_int64(st, 0) > 0 && sqlite3_column_int64(st, 0) < sqlite3_int64(UINT_MAX) )
+      {
+        _total = UINT(sqlite3_column_int64(st, 0));
+        done(st);
+        return;
+      }
+      done(st);
+      st = statement("SELECT COUNT(*) FROM " + _table);
+      if( st && sqlite3_step(st) == SQLITE_ROW )
+      {
+        _total = record_count(sqlite3_column_int64(st, 0));
+        _exact = true;
+      }
+      done(st);
+    }
+  };
+
+  /** sqlite_rows_source - paged_rows_source of the sqlite_source.
+   *  Click on the header cell orders records by its column, next click - in reverse order.
+   *  The cell gets :checked state and order="asc" or "desc" attribute.
+   **/
+  class sqlite_rows_source: public paged_rows_source
+  {
+  public:
+    sqlite_rows_source( const std::shared_ptr<sqlite_source>& src, workers& pool, UINT page_size = 128, UINT max_pages = 64 ):
+      paged_rows_source(src, pool, page_size, max_pages), _sql(src) {}
+
+    virtual BOOL on_event( HELEMENT he, HELEMENT target, BEHAVIOR_EVENTS type, UINT_PTR reason )
+    {
+      if( type != TABLE_HEADER_CLICK )
+        return paged_rows_source::on_event(he, target, type, reason);
+      dom::element cell = target;
+      int column = int(reason);
+      bool ascending = _sql->order_column() != column || !_sql->order_ascending();
+      _sql->order_by(column, ascending);
+      _pager.invalidate();
+
+      dom::element row = cell.parent();
+      for( UINT i = 0; i < row.children_count(); ++i )
+      {
+        dom::element c = row.child(i);
+        if( c.get_state(STATE_CHECKED) && c != cell )
+        {
+          c.set_state(0, STATE_CHECKED);
+          c.remove_attribute("order");
+        }
+      }
+      cell.set_state(STATE_CHECKED);
+      cell.set_attribute("order", ascending? L"asc": L"desc");
+      cell.post_event(INIT_DATA_VIEW); // bubbles to the grid: from the first record
+      return TRUE;
+    }
+
+  protected:
+    std::shared_ptr<sqlite_source> _sql;
+  };
+
+}
+
+#endif
@@ -0,0 +1,902 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Columnar in-memory table: data source of behavior:virtual-grid for large sets.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_table_hpp__
+#define __htmlayout_table_hpp__
+
+#pragma once
+
+/*!\file
+\brief table::columnar_table - typed column vectors with validity bitmaps and dictionary encoded
+       text, table::view - filtered and sorted permutation of its rows, the data_source of the grid.
+
+The table is filled first and then shared read-only. The view never moves the data,
+it keeps the vector of row indexes:
+ - filter() evaluates predicates column by column into bitmaps, 4 ints or 2 doubles
+   per SSE2 compare, text is compared by dictionary codes;
+ - sort() sorts (key, row) pairs split between threads and merged in parallel, leading sort
+   keys are packed in the 64-bit key (text by dictionary rank), ties are sorted by the rest;
+ - group() aggregates the rows of the view into a new table: one row per key.
+
+The grid gets records through fetch() of the view (data_source of htmlayout_data_source.hpp),
+only pages of the visible window are materialized. After filter()/sort() call
+data_pager::invalidate() and post INIT_DATA_VIEW to the grid.
+
+Needs C++11.
+
+\par Example:
+\code
+  std::shared_ptr<table::columnar_table> t = std::make_shared<table::columnar_table>();
+  UINT name = t->add_column(L"name", DATA_TEXT), size = t->add_column(L"size", DATA_INT);
+  ... t->column_at(name).push_text(...); t->column_at(size).push_int(...); t->commit_row();
+  std::shared_ptr<table::view> v = std::make_shared<table::view>(t);
+  v->filter( table::predicate(size, table::OP_GT, 1024) );
+  v->sort( table::sort_key(name) );
+  attach_event_handler( grid, new paged_rows_source(v, pool), HANDLE_BEHAVIOR_EVENT );
+\endcode
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "htmlayout_data_source.hpp"
+#include "htmlayout_sort.hpp" // number_of_cpus()
+
+#if defined(_MSC_VER)
+  #include <intrin.h> // _BitScanForward
+#endif
+
+#if !defined(HTMLAYOUT_TABLE_NO_SIMD) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+  #include <emmintrin.h>
+  #define HTMLAYOUT_TABLE_SSE2
+#endif
+
+namespace htmlayout
+{
+
+  namespace table
+  {
+
+    inline UINT lowest_bit( UINT w ) // w != 0
+    {
+#if defined(_MSC_VER)
+      unsigned long idx; _BitScanForward(&idx, w); return UINT(idx);
+#else
+      return UINT(__builtin_ctz(w));
+#endif
+    }
+
+    /** bitmap - one bit per row **/
+    class bitmap
+    {
+      std::vector<UINT> _words;
+      size_t            _size;
+    public:
+      bitmap(): _size(0) {}
+      explicit bitmap( size_t n, bool value = false ) { resize(n, value); }
+
+      void resize( size_t n, bool value = false )
+      {
+        _size = n;
+        _words.assign((n + 31) / 32, value? ~0u: 0u);
+        trim();
+      }
+      void push_back( bool v )
+      {
+        if( (_size & 31) == 0 ) _words.push_back(0);
+        if( v ) _words[_size >> 5] |= 1u << (_size & 31);
+        ++_size;
+      }
+      bool get( size_t i ) const { return (_words[i >> 5] >> (i & 31)) & 1; }
+      void set( size_t i, bool v ) { if( v ) _words[i >> 5] |= 1u << (i & 31); else _words[i >> 5] &= ~(1u << (i & 31)); }
+
+      size_t size() const { return _size; }
+      bool   empty() const { return _size == 0; }
+      size_t words() const { return _words.size(); }
+      UINT*       data() { return _words.empty()? 0: &_words[0]; }
+      const UINT* data() const { return _words.empty()? 0: &_words[0]; }
+
+      void and_with( const bitmap& b ) { for( size_t i = 0; i < _words.size(); ++i ) _words[i] &= b._words[i]; }
+      size_t count() const
+      {
+        size_t n = 0;
+        for( size_t i = 0; i < _words.size(); ++i )
+          for( UINT w = _words[i]; w; w &= w - 1 ) ++n;
+        return n;
+      }
+    private:
+      void trim() { if( _size & 31 ) _words.back() &= (1u << (_size & 31)) - 1; }
+    };
+
+    /** column - typed vector of values.
+     *  DATA_INT is 32-bit here (SIMD friendly), DATA_TEXT keeps codes of the dictionary of distinct strings.
+     **/
+    class column
+    {
+    public:
+      std::wstring              name;
+      DATA_COLUMN_TYPE          type;
+      std::vector<int>          ints;
+      std::vector<double>       reals;
+      std::vector<UINT>         codes;
+      std::vector<std::wstring> dict;
+      bitmap                    valid; // empty - no nulls so far
+
+      column( const wchar_t* n, DATA_COLUMN_TYPE t ): name(n), type(t), _size(0) {}
+
+      size_t size() const { return _size; }
+      bool   is_null( size_t row ) const { return !valid.empty() && !valid.get(row); }
+
+      void push_int( int v )     { assert(type == DATA_INT); ints.push_back(v); pushed(true); }
+      void push_real( double v ) { assert(type == DATA_REAL); reals.push_back(v); pushed(true); }
+      void push_text( const wchar_t* s, size_t len )
+      {
+        assert(type == DATA_TEXT);
+        std::wstring str(s, len);
+        std::unordered_map<std::wstring, UINT>::iterator it = _dict_index.find(str);
+        if( it == _dict_index.end() )
+        {
+          it = _dict_index.insert( std::make_pair(str, UINT(dict.size())) ).first;
+          dict.push_back(str);
+          _ranks.clear();
+        }
+        codes.push_back(it->second);
+        pushed(true);
+      }
+      void push_text( const wchar_t* s ) { push_text(s, wcslen(s)); }
+      void push_null()
+      {
+        switch( type )
+        {
+          case DATA_INT:  ints.push_back(0); break;
+          case DATA_REAL: reals.push_back(0); break;
+          case DATA_TEXT: codes.push_back(0); break;
+        }
+        if( valid.empty() ) valid.resize(_size, true);
+        pushed(false);
+      }
+
+      // code of the string, UINT(-1) if there is no such string in the column
+      UINT code_of( const std::wstring& s ) const
+      {
+        std::unordered_map<std::wstring, UINT>::const_iterator it = _dict_index.find(s);
+        return it == _dict_index.end()? UINT(-1): it->second;
+      }
+
+      // order of dictionary strings: ranks()[code] - position of the string in sorted dictionary.
+      // Computed on first call, call it (or view::sort) from one thread.
+      const std::vector<UINT>& ranks() const
+      {
+        if( _ranks.size() != dict.size() )
+        {
+          std::vector<UINT> order(dict.size());
+          for( UINT i = 0; i < order.size(); ++i ) order[i] = i;
+          std::sort(order.begin(), order.end(), dict_less(dict));
+          _ranks.resize(dict.size());
+          for( UINT i = 0; i < order.size(); ++i ) _ranks[order[i]] = i;
+        }
+        return _ranks;
+      }
+
+      // width of sort_value() in bits
+      UINT sort_bits() const
+      {
+        if( type == DATA_REAL ) return 64;
+        if( type == DATA_INT ) return 33;
+        UINT w = 1;
+        while( w < 32 && (ULONGLONG(1) << w) <= dict.size() ) ++w;
+        return w;
+      }
+      // value that orders as the column values, nulls are the biggest in both orders.
+      // DATA_TEXT needs ranks().
+      ULONGLONG sort_value( size_t row, bool ascending ) const
+      {
+        ULONGLONG v, top;
+        switch( type )
+        {
+          case DATA_INT:
+            top = ULONGLONG(1) << 32;
+            if( is_null(row) ) return top;
+            v = UINT(ints[row]) ^ 0x80000000u;
+            break;
+          case DATA_TEXT:
+            top = dict.size();
+            if( is_null(row) ) return top;
+            v = _ranks[codes[row]];
+            break;
+          default:
+            top = ~ULONGLONG(0);
+            if( is_null(row) ) return top;
+            memcpy(&v, &reals[row], sizeof(v));
+            v = (v & 0x8000000000000000ull)? ~v: v ^ 0x8000000000000000ull;
+            if( v == top ) --v; // NaN
+            break;
+        }
+        return ascending? v: top - 1 - v;
+      }
+
+      void format( size_t row, std::wstring& out ) const
+      {
+        column_batch b(type);
+        b.nulls.push_back(is_null(row));
+        switch( type )
+        {
+          case DATA_INT:  b.ints.push_back(ints[row]); break;
+          case DATA_REAL: b.reals.push_back(reals[row]); break;
+          case DATA_TEXT: b.texts.push_back(dict[codes[row]]); break;
+        }
+        b.format(0, out);
+      }
+
+    private:
+      size_t                                 _size;
+      std::unordered_map<std::wstring, UINT> _dict_index;
+      mutable std::vector<UINT>              _ranks;
+
+      struct dict_less
+      {
+        const std::vector<std::wstring>& d;
+        dict_less( const std::vector<std::wstring>& dd ): d(dd) {}
+        bool operator()( UINT a, UINT b ) const { return d[a] < d[b]; }
+      };
+
+      void pushed( bool is_valid )
+      {
+        if( !valid.empty() || !is_valid ) valid.push_back(is_valid);
+        ++_size;
+      }
+    };
+
+    /** columnar_table - columns of the same length **/
+    class columnar_table
+    {
+    public:
+      columnar_table(): _rows(0) {}
+
+      UINT add_column( const wchar_t* name, DATA_COLUMN_TYPE type )
+      {
+        assert(_rows == 0);
+        _columns.push_back( column(name, type) );
+        return UINT(_columns.size() - 1);
+      }
+      // after values of all columns of the row are pushed
+      void commit_row()
+      {
+        ++_rows;
+#if defined(_DEBUG)
+        for( size_t c = 0; c < _columns.size(); ++c ) assert(_columns[c].size() == _rows);
+#endif
+      }
+
+      UINT          columns() const { return UINT(_columns.size()); }
+      size_t        rows() const { return _rows; }
+      column&       column_at( UINT n ) { return _columns[n]; }
+      const column& column_at( UINT n ) const { return _columns[n]; }
+      UINT find_column( const wchar_t* name ) const
+      {
+        for( size_t c = 0; c < _columns.size(); ++c )
+          if( _columns[c].name == name ) return UINT(c);
+        return UINT(-1);
+      }
+
+    private:
+      std::vector<column> _columns;
+      size_t              _rows;
+    };
+
+    // runs f(0) .. f(n - 1) in parallel, f(0) in the calling thread
+    template <typename F>
+      struct parallel_job
+      {
+        F*   f;
+        UINT index;
+        static DWORD WINAPI run( LPVOID prm )
+        {
+          parallel_job* self = static_cast<parallel_job*>(prm);
+          (*self->f)(self->index);
+          return 0;
+        }
+      };
+    template <typename F>
+      inline void parallel_for( UINT n, F& f )
+      {
+        if( n == 1 ) { f(0); return; }
+        std::vector< parallel_job<F> > jobs(n);
+        std::vector<HANDLE>            threads;
+        for( UINT t = 0; t < n; ++t )
+        {
+          jobs[t].f = &f;
+          jobs[t].index = t;
+          if( t == 0 ) continue;
+          HANDLE h = ::CreateThread(NULL, 0, &parallel_job<F>::run, &jobs[t], 0, NULL);
+          if( h ) threads.push_back(h); else f(t);
+        }
+        f(0);
+        if( threads.size() )
+        {
+          ::WaitForMultipleObjects(DWORD(threads.size()), &threads[0], TRUE, INFINITE);
+          for( size_t i = 0; i < threads.size(); ++i )
+            ::CloseHandle(threads[i]);
+        }
+      }
+
+    enum { PARALLEL_THRESHOLD = 64 * 1024, MAX_THREADS = 16 };
+
+    inline UINT threads_for( size_t n )
+    {
+      if( n < PARALLEL_THRESHOLD ) return 1;
+      UINT t = dom::sorting::number_of_cpus();
+      return t > MAX_THREADS? MAX_THREADS: t;
+    }
+
+    enum PREDICATE_OP
+    {
+      OP_LT, OP_LE, OP_EQ, OP_NE, OP_GE, OP_GT,
+      OP_BETWEEN, // value <= x <= value2
+      OP_NOT_NULL
+    };
+
+    /** predicate - "column op value", nulls never match **/
+    struct predicate
+    {
+      UINT         col;
+      PREDICATE_OP op;
+      double       value;
+      double       value2;
+      std::wstring text; // for DATA_TEXT columns, OP_EQ and OP_NE only
+      predicate( UINT c, PREDICATE_OP o, double v = 0, double v2 = 0 ): col(c), op(o), value(v), value2(v2) {}
+      predicate( UINT c, PREDICATE_OP o, const wchar_t* t ): col(c), op(o), value(0), value2(0), text(t) {}
+    };
+
+    namespace impl
+    {
+      template <typename T>
+        inline bool match( T x, PREDICATE_OP op, T a, T b )
+        {
+          switch( op )
+          {
+            case OP_LT: return x < a;
+            case OP_LE: return x <= a;
+            case OP_EQ: return x == a;
+            case OP_NE: return x != a;
+            case OP_GE: return x >= a;
+            case OP_GT: return x > a;
+            case OP_BETWEEN: return a <= x && x <= b;
+            default: return true;
+          }
+        }
+
+      // bits of words [w0, w1) of the selection for int values
+      inline void select_ints( const int* v, size_t n, PREDICATE_OP op, int a, int b, UINT* out, size_t w0, size_t w1 )
+      {
+        for( size_t w = w0; w < w1; ++w )
+        {
+          size_t i = w * 32, end = i + 32 < n? i + 32: n;
+          UINT bits = 0;
+#if defined(HTMLAYOUT_TABLE_SSE2)
+          if( end - i == 32 )
+          {
+            const __m128i va = _mm_set1_epi32(a), vb = _mm_set1_epi32(b), ones = _mm_set1_epi32(-1);
+            for( UINT k = 0; k < 32; k += 4 )
+            {
+              __m128i x = _mm_loadu_si128((const __m128i*)(v + i + k)), m;
+              switch( op )
+              {
+                case OP_LT: m = _mm_cmplt_epi32(x, va); break;
+                case OP_LE: m = _mm_xor_si128(_mm_cmpgt_epi32(x, va), ones); break;
+                case OP_EQ: m = _mm_cmpeq_epi32(x, va); break;
+                case OP_NE: m = _mm_xor_si128(_mm_cmpeq_epi32(x, va), ones); break;
+                case OP_GE: m = _mm_xor_si128(_mm_cmplt_epi32(x, va), ones); break;
+                case OP_GT: m = _mm_cmpgt_epi32(x, va); break;
+                case OP_BETWEEN: m = _mm_andnot_si128(_mm_or_si128(_mm_cmplt_epi32(x, va), _mm_cmpgt_epi32(x, vb)), ones); break;
+                default: m = ones; break;
+              }
+              bits |= UINT(_mm_movemask_ps(_mm_castsi128_ps(m))) << k;
+            }
+            out[w] = bits;
+            continue;
+          }
+#endif
+          for( size_t k = i; k < end; ++k )
+            if( match(v[k], op, a, b) ) bits |= 1u << (k - i);
+          out[w] = bits;
+        }
+      }
+
+      inline void select_reals( const double* v, size_t n, PREDICATE_OP op, double a, double b, UINT* out, size_t w0, size_t w1 )
+      {
+        for( size_t w = w0; w < w1; ++w )
+        {
+          size_t i = w * 32, end = i + 32 < n? i + 32: n;
+          UINT bits = 0;
+#if defined(HTMLAYOUT_TABLE_SSE2)
+          if( end - i == 32 )
+          {
+            const __m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b);
+            for( UINT k = 0; k < 32; k += 2 )
+            {
+              __m128d x = _mm_loadu_pd(v + i + k), m;
+              switch( op )
+              {
+                case OP_LT: m = _mm_cmplt_pd(x, va); break;
+                case OP_LE: m = _mm_cmple_pd(x, va); break;
+                case OP_EQ: m = _mm_cmpeq_pd(x, va); break;
+                case OP_NE: m = _mm_cmpneq_pd(x, va); break;
+                case OP_GE: m = _mm_cmpge_pd(x, va); break;
+                case OP_GT: m = _mm_cmpgt_pd(x, va); break;
+                case OP_BETWEEN: m = _mm_and_pd(_mm_cmpge_pd(x, va), _mm_cmple_pd(x, vb)); break;
+                default: m = _mm_cmpeq_pd(x, x); break;
+              }
+              bits |= UINT(_mm_movemask_pd(m)) << k;
+            }
+            out[w] = bits;
+            continue;
+          }
+#endif
+          for( size_t k = i; k < end; ++k )
+            if( match(v[k], op, a, b) ) bits |= 1u << (k - i);
+          out[w] = bits;
+        }
+      }
+
+      // pair of the sort: normalized key of the first column and the row
+      struct sort_entry
+      {
+        ULONGLONG key;
+        UINT      row;
+        bool operator < ( const sort_entry& r ) const { return key < r.key || (key == r.key && row < r.row); }
+      };
+    }
+
+    struct sort_key
+    {
+      UINT col;
+      bool ascending;
+      sort_key( UINT c, bool asc = true ): col(c), ascending(asc) {}
+    };
+
+    enum AGGREGATE_OP { AGG_COUNT, AGG_SUM, AGG_MIN, AGG_MAX, AGG_AVG };
+
+    /** aggregate - column of the group() result. col == UINT(-1) with AGG_COUNT - number of rows. **/
+    struct aggregate
+    {
+      UINT         col;
+      AGGREGATE_OP op;
+      std::wstring name;
+      aggregate( UINT c, AGGREGATE_OP o, const wchar_t* n ): col(c), op(o), name(n) {}
+    };
+
+    /** view - rows of the table selected by filter() in order of sort(). data_source of the grid.
+     *  filter(), sort() and group() are called from one (GUI) thread, fetch() - from any:
+     *  it works on a snapshot of rows.
+     **/
+    class view: public data_source
+    {
+    public:
+      typedef std::vector<UINT> rows_t;
+
+      explicit view( const std::shared_ptr<const columnar_table>& t ): _table(t) { clear_filter(); }
+
+      const columnar_table& source_table() const { return *_table; }
+      std::shared_ptr<const rows_t> rows() const { critical_section cs(_guard); return _rows; }
+
+      // all rows of the table, in current sort order
+      void clear_filter()
+      {
+        _filters.clear();
+        std::shared_ptr<rows_t> r = std::make_shared<rows_t>(_table->rows());
+        for( UINT i = 0; i < r->size(); ++i ) (*r)[i] = i;
+        order(*r);
+        set_rows(r);
+      }
+
+      // rows that match all predicates
+      void filter( const std::vector<predicate>& preds )
+      {
+        _filters = preds;
+        const columnar_table& t = *_table;
+        bitmap sel(t.rows(), true);
+        for( size_t p = 0; p < preds.size(); ++p )
+          sel.and_with( select(preds[p]) );
+        std::shared_ptr<rows_t> r = std::make_shared<rows_t>();
+        r->reserve(sel.count());
+        const UINT* w = sel.data();
+        for( size_t i = 0; i < sel.words(); ++i )
+          for( UINT bits = w[i]; bits; bits &= bits - 1 )
+            r->push_back( UINT(i * 32 + lowest_bit(bits)) );
+        order(*r);
+        set_rows(r);
+      }
+      void filter( const predicate& p ) { filter( std::vector<predicate>(1, p) ); }
+
+      // bitmap of rows of the table that match the predicate
+      bitmap select( const predicate& p ) const
+      {
+        const column& c = _table->column_at(p.col);
+        const size_t n = _table->rows();
+        bitmap sel(n);
+        if( p.op == OP_NOT_NULL )
+          sel.resize(n, true);
+        else if( c.type == DATA_INT )
+        {
+          int a = 0, b = 0;
+          PREDICATE_OP op = int_bounds(p, a, b);
+          select_words(sel, [&](size_t w0, size_t w1) { impl::select_ints(n? &c.ints[0]: 0, n, op, a, b, sel.data(), w0, w1); });
+        }
+        else if( c.type == DATA_REAL )
+          select_words(sel, [&](size_t w0, size_t w1) { impl::select_reals(n? &c.reals[0]: 0, n, p.op, p.value, p.value2, sel.data(), w0, w1); });
+        else
+        {
+          assert(p.op == OP_EQ || p.op == OP_NE);
+          UINT code = c.code_of(p.text);
+          if( code == UINT(-1) )
+            sel.resize(n, p.op == OP_NE);
+          else
+            select_words(sel, [&](size_t w0, size_t w1) { impl::select_ints(n? (const int*)&c.codes[0]: 0, n, p.op == OP_NE? OP_NE: OP_EQ, int(code), 0, sel.data(), w0, w1); });
+        }
+        if( !c.valid.empty() )
+          sel.and_with(c.valid);
+        return sel;
+      }
+
+      // stable multi-key order, nulls last
+      void sort( const std::vector<sort_key>& keys )
+      {
+        _keys = keys;
+        std::shared_ptr<rows_t> r = std::make_shared<rows_t>( *rows() );
+        order(*r);
+        set_rows(r);
+      }
+      void sort( const sort_key& k ) { sort( std::vector<sort_key>(1, k) ); }
+
+      // table with a row per distinct value of the key column among rows of the view (nulls are one group),
+      // in order of first appearance, columns: key, aggregates
+      std::shared_ptr<columnar_table> group( UINT key_col, const std::vector<aggregate>& aggs ) const
+      {
+        const columnar_table& t = *_table;
+        const column& kc = t.column_at(key_col);
+        std::shared_ptr<const rows_t> rs = rows();
+        const rows_t& r = *rs;
+        const size_t na = aggs.size();
+
+        // partial aggregates of row chunks, merged in order of chunks
+        UINT nt = threads_for(r.size());
+        std::vector<group_part> parts(nt);
+        auto work = [&]( UINT th )
+        {
+          group_part& gp = parts[th];
+          size_t from = r.size() * th / nt, to = r.size() * (th + 1) / nt;
+          for( size_t i = from; i < to; ++i )
+          {
+            UINT row = r[i];
+            ULONGLONG k = group_key(kc, row);
+            std::unordered_map<ULONGLONG, UINT>::iterator it = gp.index.find(k);
+            if( it == gp.index.end() )
+            {
+              it = gp.index.insert( std::make_pair(k, UINT(gp.keys.size())) ).first;
+              gp.keys.push_back(k);
+              gp.first_rows.push_back(row);
+              gp.accs.resize(gp.accs.size() + na);
+            }
+            accumulator* acc = &gp.accs[it->second * na];
+            for( size_t a = 0; a < na; ++a )
+              acc[a].add(aggs[a].col == UINT(-1)? 0: &t.column_at(aggs[a].col), row);
+          }
+        };
+        parallel_for(nt, work);
+
+        group_part& all = parts[0];
+        for( UINT p = 1; p < nt; ++p )
+          for( size_t g = 0; g < parts[p].keys.size(); ++g )
+          {
+            ULONGLONG k = parts[p].keys[g];
+            std::unordered_map<ULONGLONG, UINT>::iterator it = all.index.find(k);
+            if( it == all.index.end() )
+            {
+              it = all.index.insert( std::make_pair(k, UINT(all.keys.size())) ).first;
+              all.keys.push_back(k);
+              all.first_rows.push_back(parts[p].first_rows[g]);
+              all.accs.resize(all.accs.size() + na);
+            }
+            for( size_t a = 0; a < na; ++a )
+              all.accs[it->second * na + a].merge(parts[p].accs[g * na + a]);
+          }
+
+        std::shared_ptr<columnar_table> res = std::make_shared<columnar_table>();
+        res->add_column(kc.name.c_str(), kc.type);
+        for( size_t a = 0; a < na; ++a )
+          res->add_column(aggs[a].name.c_str(), aggs[a].op == AGG_COUNT? DATA_INT: DATA_REAL);
+        for( size_t g = 0; g < all.keys.size(); ++g )
+        {
+          UINT row = all.first_rows[g];
+          column& out = res->column_at(0);
+          if( kc.is_null(row) ) out.push_null();
+          else if( kc.type == DATA_INT ) out.push_int(kc.ints[row]);
+          else if( kc.type == DATA_REAL ) out.push_real(kc.reals[row]);
+          else out.push_text(kc.dict[kc.codes[row]].c_str(), kc.dict[kc.codes[row]].length());
+          for( size_t a = 0; a < na; ++a )
+          {
+            const accumulator& acc = all.accs[g * na + a];
+            column& ac = res->column_at(UINT(a + 1));
+            if( aggs[a].op == AGG_COUNT ) ac.push_int(int(acc.count));
+            else if( !acc.count ) ac.push_null();
+            else if( aggs[a].op == AGG_SUM ) ac.push_real(acc.sum);
+            else if( aggs[a].op == AGG_MIN ) ac.push_real(acc.lo);
+            else if( aggs[a].op == AGG_MAX ) ac.push_real(acc.hi);
+            else ac.push_real(acc.sum / acc.count);
+          }
+          res->commit_row();
+        }
+        return res;
+      }
+
+      // data_source
+      virtual UINT total_records() { return UINT(rows()->size()); }
+      virtual UINT columns() { return _table->columns(); }
+      virtual bool fetch( UINT first, UINT count, record_batch& batch )
+      {
+        std::shared_ptr<const rows_t> rs = rows();
+        const rows_t& r = *rs;
+        if( first > r.size() ) return false;
+        if( count > r.size() - first ) count = UINT(r.size() - first);
+        const columnar_table& t = *_table;
+        batch.first = first;
+        batch.count = count;
+        batch.columns.resize(t.columns());
+        for( UINT c = 0; c < t.columns(); ++c )
+        {
+          const column& col = t.column_at(c);
+          column_batch& b = batch.columns[c];
+          b.type = col.type;
+          if( !col.valid.empty() )
+          {
+            b.nulls.resize(count);
+            for( UINT i = 0; i < count; ++i ) b.nulls[i] = col.is_null(r[first + i]);
+          }
+          switch( col.type )
+          {
+            case DATA_INT:
+              b.ints.resize(count);
+              for( UINT i = 0; i < count; ++i ) b.ints[i] = col.ints[r[first + i]];
+              break;
+            case DATA_REAL:
+              b.reals.resize(count);
+              for( UINT i = 0; i < count; ++i ) b.reals[i] = col.reals[r[first + i]];
+              break;
+            case DATA_TEXT:
+              b.texts.resize(count);
+              for( UINT i = 0; i < count; ++i ) b.texts[i] = col.dict[col.codes[r[first + i]]];
+              break;
+          }
+        }
+        return true;
+      }
+
+    private:
+      std::shared_ptr<const columnar_table> _table;
+      std::shared_ptr<const rows_t>         _rows;   // snapshot, replaced under the _guard
+      mutable mutex                         _guard;
+      std::vector<predicate>                _filters;
+      std::vector<sort_key>                 _keys;
+
+      struct accumulator
+      {
+        size_t count;
+        double sum, lo, hi; // not min/max: macros of windows.h
+        accumulator(): count(0), sum(0), lo(0), hi(0) {}
+        void add( const column* c, UINT row )
+        {
+          if( !c ) { ++count; return; }
+          if( c->is_null(row) ) return;
+          double v = c->type == DATA_INT? double(c->ints[row]): c->type == DATA_REAL? c->reals[row]: 0;
+          if( !count++ ) { lo = hi = v; } else { if( v < lo ) lo = v; if( v > hi ) hi = v; }
+          sum += v;
+        }
+        void merge( const accumulator& a )
+        {
+          if( !a.count ) return;
+          if( !count ) { *this = a; return; }
+          count += a.count; sum += a.sum;
+          if( a.lo < lo ) lo = a.lo;
+          if( a.hi > hi ) hi = a.hi;
+        }
+      };
+      struct group_part
+      {
+        std::unordered_map<ULONGLONG, UINT> index;
+        std::vector<ULONGLONG>              keys;
+        std::vector<UINT>                   first_rows;
+        std::vector<accumulator>            accs; // keys.size() * number of aggregates
+      };
+
+      void set_rows( const std::shared_ptr<rows_t>& r )
+      {
+        std::shared_ptr<const rows_t> prev(r);
+        {
+          critical_section cs(_guard);
+          _rows.swap(prev);
+        }
+      } // the previous snapshot is released outside of the lock, fetch() may still hold it
+
+      static ULONGLONG group_key( const column& c, UINT row )
+      {
+        if( c.is_null(row) ) return ~ULONGLONG(0);
+        if( c.type == DATA_TEXT ) return c.codes[row];
+        if( c.type == DATA_INT ) return ULONGLONG(UINT(c.ints[row]));
+        ULONGLONG bits; memcpy(&bits, &c.reals[row], sizeof(bits));
+        return bits;
+      }
+
+      // int compare with double bounds of the predicate: the bounds become the range [lo, hi] of ints.
+      // Bounds beyond the int range select all or nothing, they are not clamped to INT_MIN/INT_MAX
+      static PREDICATE_OP int_bounds( const predicate& p, int& a, int& b )
+      {
+        const double imin = double(INT_MIN), imax = double(INT_MAX);
+        double lo = imin, hi = imax;
+        switch( p.op )
+        {
+          case OP_LT: hi = ceil(p.value) - 1; break;
+          case OP_LE: hi = floor(p.value); break;
+          case OP_GT: lo = floor(p.value) + 1; break;
+          case OP_GE: lo = ceil(p.value); break;
+          case OP_BETWEEN: lo = ceil(p.value); hi = floor(p.value2); break;
+          case OP_EQ:
+          case OP_NE:
+            if( p.value == floor(p.value) && p.value >= imin && p.value <= imax ) { a = int(p.value); return p.op; }
+            if( p.op == OP_NE ) return OP_NOT_NULL; // no int is equal to it
+            lo = 1; hi = 0;
+            break;
+          default:
+            return p.op;
+        }
+        if( !(lo <= hi) || lo > imax || hi < imin ) { a = 0; b = -1; return OP_BETWEEN; } // empty, NaN too
+        if( lo < imin ) lo = imin;
+        if( hi > imax ) hi = imax;
+        a = int(lo); b = int(hi);
+        if( lo == imin && hi == imax ) return OP_NOT_NULL;
+        if( lo == imin ) { a = b; return OP_LE; }
+        if( hi == imax ) return OP_GE;
+        return OP_BETWEEN;
+      }
+
+      template <typename F>
+        static void select_words( bitmap& sel, const F& f )
+        {
+          const size_t words = sel.words();
+          UINT nt = threads_for(sel.size());
+          auto work = [&]( UINT t ) { f(words * t / nt, words * (t + 1) / nt); };
+          parallel_for(nt, work);
+        }
+
+      void order( rows_t& r ) const
+      {
+        if( _keys.empty() || r.size() < 2 ) return;
+        const columnar_table& t = *_table;
+        for( size_t k = 0; k < _keys.size(); ++k )
+          t.column_at(_keys[k].col).ranks(); // before threads
+
+        // leading keys that fit in 64 bits are packed in the key of the entry
+        size_t packed = 0;
+        for( UINT bits = 0; packed < _keys.size(); ++packed )
+        {
+          bits += t.column_at(_keys[packed].col).sort_bits();
+          if( bits > 64 ) break;
+        }
+        if( !packed ) packed = 1;
+
+        const size_t n = r.size();
+        std::vector<impl::sort_entry> e(n);
+        UINT nt = threads_for(n);
+        auto extract = [&]( UINT th )
+        {
+          for( size_t i = n * th / nt, end = n * (th + 1) / nt; i < end; ++i )
+          {
+            ULONGLONG k = 0;
+            for( size_t q = 0; q < packed; ++q )
+            {
+              const column& c = t.column_at(_keys[q].col);
+              k = (q? k << c.sort_bits(): 0) | c.sort_value(r[i], _keys[q].ascending);
+            }
+            e[i].key = k;
+            e[i].row = UINT(i);
+          }
+        };
+        parallel_for(nt, extract);
+        parallel_sort(e, nt);
+
+        // ties of packed keys by other keys, run by run
+        if( _keys.size() > packed )
+        {
+          std::vector<size_t> runs; // [begin, end) pairs of equal first keys
+          for( size_t i = 0; i < n; )
+          {
+            size_t j = i + 1;
+            while( j < n && e[j].key == e[i].key ) ++j;
+            if( j - i > 1 ) { runs.push_back(i); runs.push_back(j); }
+            i = j;
+          }
+          const size_t nruns = runs.size() / 2;
+          UINT rt = nruns > 1? threads_for(n): 1;
+          auto tie_sort = [&]( UINT th )
+          {
+            for( size_t q = th; q < nruns; q += rt )
+              std::sort(e.begin() + runs[q * 2], e.begin() + runs[q * 2 + 1], tie_less(*this, r, packed));
+          };
+          parallel_for(rt, tie_sort);
+        }
+        rows_t sorted(n);
+        for( size_t i = 0; i < n; ++i ) sorted[i] = r[e[i].row];
+        r.swap(sorted);
+      }
+
+      // compares entries by keys that are not packed, then by position
+      struct tie_less
+      {
+        const view&   v;
+        const rows_t& r;
+        size_t        from;
+        tie_less( const view& vv, const rows_t& rr, size_t f ): v(vv), r(rr), from(f) {}
+        bool operator()( const impl::sort_entry& a, const impl::sort_entry& b ) const
+        {
+          const columnar_table& t = *v._table;
+          for( size_t k = from; k < v._keys.size(); ++k )
+          {
+            const column& c = t.column_at(v._keys[k].col);
+            ULONGLONG ka = c.sort_value(r[a.row], v._keys[k].ascending), kb = c.sort_value(r[b.row], v._keys[k].ascending);
+            if( ka != kb ) return ka < kb;
+          }
+          return a.row < b.row;
+        }
+      };
+
+      // chunks sorted by threads, then merged pairwise, merges of a level run in parallel
+      static void parallel_sort( std::vector<impl::sort_entry>& e, UINT nt )
+      {
+        const size_t n = e.size();
+        if( nt < 2 ) { std::sort(e.begin(), e.end()); return; }
+        std::vector<size_t> bounds(nt + 1);
+        for( UINT t = 0; t <= nt; ++t ) bounds[t] = n * t / nt;
+        auto chunk = [&]( UINT t ) { std::sort(e.begin() + bounds[t], e.begin() + bounds[t + 1]); };
+        parallel_for(nt, chunk);
+
+        std::vector<impl::sort_entry> tmp(n);
+        std::vector<impl::sort_entry>* src = &e;
+        std::vector<impl::sort_entry>* dst = &tmp;
+        for( UINT step = 1; step < nt; step *= 2 )
+        {
+          UINT pairs = (nt + step * 2 - 1) / (step * 2);
+          auto merge = [&]( UINT p )
+          {
+            UINT t = p * step * 2;
+            UINT mid = t + step < nt? t + step: nt;
+            UINT last = t + step * 2 < nt? t + step * 2: nt;
+            std::merge(src->begin() + bounds[t], src->begin() + bounds[mid],
+                       src->begin() + bounds[mid], src->begin() + bounds[last], dst->begin() + bounds[t]);
+          };
+          parallel_for(pairs, merge);
+          std::swap(src, dst);
+        }
+        if( src != &e ) e.swap(tmp);
+      }
+    };
+
+  }
+
+}
+
+#endif
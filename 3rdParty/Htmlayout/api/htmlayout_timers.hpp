@@ -0,0 +1,532 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Element timers multiplexed on one timer per window.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_timers_hpp__
+#define __htmlayout_timers_hpp__
+
+#pragma once
+
+/*!\file
+\brief timers::set/kill - replacement of HTMLayoutSetTimer/HTMLayoutSetTimerEx for behaviors.
+
+All element timers of the window are kept in hierarchical timing wheel
+driven by one Win32 timer of the window (tick is TICK_MS).
+On the tick all expired timers are fired in one batch, in order of their deadlines,
+so the window gets one redraw pass for all of them.
+
+Handlers receive timers as usual: on_timer(he) for id == 0 or on_timer(he, id),
+returning TRUE to keep the timer going.
+
+Timers of invisible elements are suspended and resumed when elements become visible
+(checked each SUSPEND_POLL_MS or by timers::resume()). While all timers of the window
+are suspended the window timer runs at SUSPEND_POLL_MS rather than TICK_MS.
+Timers are cancelled when handler gets detached from the element, the wheel of the window
+is freed with its last timer.
+
+A handler that sets its timer again from on_timer() keeps it going, whatever it returns.
+
+\par Example:
+\code
+  virtual void attached(HELEMENT he) { timers::set(he, this, 1000); }
+  virtual BOOL on_timer(HELEMENT he) { ...; return TRUE; }
+\endcode
+*/
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "htmlayout_behavior.hpp"
+#include "htmlayout_dom.hpp"
+#include "htmlayout_pool.hpp"
+
+namespace htmlayout
+{
+
+  namespace timers
+  {
+    enum
+    {
+      TICK_MS = 10,
+      SUSPEND_POLL_MS = 250,
+
+      L0_BITS = 8, L0_SIZE = 1 << L0_BITS, // 256 ticks
+      LN_BITS = 6, LN_SIZE = 1 << LN_BITS, // x64 per level
+      LEVELS = 4                           // L0 + 3 upper levels, up to 2^26 ticks (~186 hours)
+    };
+
+    class wheel;
+
+    struct timer_node: public pooled<timer_node>
+    {
+      enum state_t { LINKED, FIRING, SUSPENDED, DEAD };
+
+      timer_node*    next;
+      timer_node*    prev;
+      wheel*         owner;
+      HELEMENT       he;
+      event_handler* handler;
+      UINT_PTR       id;
+      UINT           period;   // ticks
+      ULONGLONG      expires;  // tick
+      ULONGLONG      seq;      // order of setting, for equal deadlines
+      state_t        state;
+    };
+
+    struct timer_stats
+    {
+      UINT timers;      // live timers
+      UINT suspended;   // of them suspended
+      UINT fired;       // on_timer calls made
+      UINT batches;     // ticks that fired at least one timer
+      UINT windows;     // windows with running tick timer
+    };
+    inline timer_stats& stats() { static timer_stats _stats = { 0 }; return _stats; }
+
+    // list with sentinel
+    struct timer_list
+    {
+      timer_node head;
+      timer_list() { head.next = head.prev = &head; }
+      bool empty() const { return head.next == &head; }
+      void push( timer_node* n ) { n->prev = head.prev; n->next = &head; head.prev->next = n; head.prev = n; }
+      static void unlink( timer_node* n ) { n->prev->next = n->next; n->next->prev = n->prev; n->next = n->prev = n; }
+      // moves all nodes to the vector
+      void take( std::vector<timer_node*>& out )
+      {
+        for( timer_node* n = head.next; n != &head; )
+        {
+          timer_node* t = n->next;
+          n->next = n->prev = n;
+          out.push_back(n);
+          n = t;
+        }
+        head.next = head.prev = &head;
+      }
+    };
+
+    /** wheel - timers of one window **/
+    class wheel
+    {
+      HWND        _hwnd;
+      ULONGLONG   _now;       // current tick
+      DWORD       _last_ms;   // GetTickCount() of _now
+      UINT        _count;     // timers in the wheel and suspended
+      UINT        _suspended_count;
+      UINT        _interval;  // of the window timer, ms, 0 - not running
+      bool        _ticking;   // in on_tick(), the wheel is freed at its end if empty
+      timer_list  _l0[L0_SIZE];
+      timer_list  _ln[LEVELS - 1][LN_SIZE];
+      timer_list  _suspended;
+      UINT        _poll;      // ticks till next check of suspended
+
+      wheel(const wheel&);
+      wheel& operator=(const wheel&);
+
+      void place( timer_node* n )
+      {
+        // delta is 0 only for timers cascaded to the slot being processed
+        ULONGLONG delta = n->expires > _now? n->expires - _now: 0;
+        if( delta == 0 ) n->expires = _now;
+        const ULONGLONG max_delta = (ULONGLONG(1) << (L0_BITS + LN_BITS * (LEVELS - 1))) - 1;
+        if( delta > max_delta ) { n->expires = _now + max_delta; delta = max_delta; }
+
+        n->state = timer_node::LINKED;
+        if( delta < L0_SIZE )
+        {
+          _l0[ UINT(n->expires) & (L0_SIZE - 1) ].push(n);
+          return;
+        }
+        for( UINT level = 0; level < LEVELS - 1; ++level )
+        {
+          UINT shift = L0_BITS + LN_BITS * (level + 1);
+          if( delta < (ULONGLONG(1) << shift) || level == LEVELS - 2 )
+          {
+            _ln[level][ UINT(n->expires >> (shift - LN_BITS)) & (LN_SIZE - 1) ].push(n);
+            return;
+          }
+        }
+      }
+
+      // moves timers of the current slot of upper level down
+      void cascade( UINT level, std::vector<timer_node*>& buf )
+      {
+        UINT shift = L0_BITS + LN_BITS * level;
+        UINT idx = UINT(_now >> shift) & (LN_SIZE - 1);
+        buf.clear();
+        _ln[level][idx].take(buf);
+        for( size_t n = 0; n < buf.size(); ++n ) place(buf[n]);
+        if( idx == 0 && level + 1 < LEVELS - 1 )
+          cascade(level + 1, buf);
+      }
+
+      struct deadline_less
+      {
+        bool operator()( const timer_node* a, const timer_node* b ) const
+        {
+          return a->expires != b->expires? a->expires < b->expires: a->seq < b->seq;
+        }
+      };
+
+      void unsuspended() { --_suspended_count; --stats().suspended; }
+
+      // window timer: TICK_MS while there are running timers, SUSPEND_POLL_MS if all are suspended
+      void retime()
+      {
+        UINT interval = _count == 0? 0: _count > _suspended_count? UINT(TICK_MS): UINT(SUSPEND_POLL_MS);
+        if( interval == _interval ) return;
+        if( !_interval ) { _last_ms = ::GetTickCount(); ++stats().windows; }
+        if( interval ) ::SetTimer(_hwnd, UINT_PTR(this), interval, &tick_proc); // replaces the running one
+        else { ::KillTimer(_hwnd, UINT_PTR(this)); --stats().windows; }
+        _interval = interval;
+      }
+
+    public:
+      wheel( HWND hwnd ): _hwnd(hwnd), _now(0), _last_ms(::GetTickCount()), _count(0), _suspended_count(0), _interval(0), _ticking(false), _poll(SUSPEND_POLL_MS / TICK_MS) {}
+
+      HWND  hwnd() const  { return _hwnd; }
+      bool  empty() const { return _count == 0; }
+      bool  ticking() const { return _ticking; }
+      UINT  interval() const { return _interval; }
+      ULONGLONG now() const { return _now; }
+
+      void add( timer_node* n )
+      {
+        ++_count;
+        place(n);
+        retime();
+      }
+      // unlinks the node, it is freed by caller
+      void remove( timer_node* n )
+      {
+        if( n->state == timer_node::LINKED || n->state == timer_node::SUSPENDED )
+          timer_list::unlink(n);
+        if( n->state == timer_node::SUSPENDED ) unsuspended();
+        --_count;
+        if( !_ticking ) retime(); // on_tick() does it at its end
+      }
+      void reschedule( timer_node* n, UINT ticks )
+      {
+        if( n->state == timer_node::LINKED || n->state == timer_node::SUSPENDED )
+          timer_list::unlink(n);
+        if( n->state == timer_node::SUSPENDED ) unsuspended();
+        n->expires = _now + ticks;
+        place(n);
+        if( !_ticking ) retime();
+      }
+      void suspend( timer_node* n )
+      {
+        n->state = timer_node::SUSPENDED;
+        _suspended.push(n);
+        ++_suspended_count; ++stats().suspended;
+      }
+      void resume( HELEMENT he )
+      {
+        std::vector<timer_node*> all;
+        _suspended.take(all);
+        for( size_t i = 0; i < all.size(); ++i )
+        {
+          timer_node* n = all[i];
+          if( !he || n->he == he )
+          {
+            unsuspended();
+            n->expires = _now + n->period;
+            place(n);
+          }
+          else
+            _suspended.push(n);
+        }
+        if( !_ticking ) retime();
+      }
+
+      // advances the wheel to the current time and fires expired timers
+      void on_tick();
+
+      static VOID CALLBACK tick_proc( HWND, UINT, UINT_PTR id, DWORD )
+      {
+        reinterpret_cast<wheel*>(id)->on_tick();
+      }
+
+    };
+
+    struct node_key
+    {
+      HELEMENT       he;
+      event_handler* handler;
+      UINT_PTR       id;
+      bool operator<( const node_key& rs ) const
+      {
+        if( he != rs.he ) return he < rs.he;
+        if( handler != rs.handler ) return handler < rs.handler;
+        return id < rs.id;
+      }
+    };
+
+    /** service - wheels of windows and index of timers, GUI thread only **/
+    class service
+    {
+      typedef std::map<node_key, timer_node*> index_t;
+      index_t             _index;
+      std::vector<wheel*> _wheels;
+      ULONGLONG           _seq;
+
+      std::vector<node_key> _fallbacks; // timers set by HTMLayoutSetTimerEx, element is not in a window
+
+      static event_handler::detach_hook_t*& previous_hook() { static event_handler::detach_hook_t* _prev = 0; return _prev; }
+      static bool hook()
+      {
+        previous_hook() = event_handler::detach_hook();
+        event_handler::detach_hook() = &on_detach;
+        return true;
+      }
+      static void on_detach( event_handler* h, HELEMENT he )
+      {
+        instance().kill_all(he, h);
+        if( previous_hook() ) previous_hook()(h, he); // e.g. element_tokens of htmlayout_workers.hpp
+      }
+
+    public:
+      service(): _seq(0) {}
+
+      static service& instance()
+      {
+        static service _instance;
+        static bool _hooked = hook(); _hooked;
+        return _instance;
+      }
+
+      wheel* wheel_of( HELEMENT he )
+      {
+        HWND hwnd = 0;
+        HTMLayoutGetElementHwnd(he, &hwnd, TRUE);
+        if( !hwnd ) return 0;
+        for( size_t n = 0; n < _wheels.size(); ++n )
+          if( _wheels[n]->hwnd() == hwnd ) return _wheels[n];
+        _wheels.push_back( new wheel(hwnd) );
+        return _wheels.back();
+      }
+
+      bool set( HELEMENT he, event_handler* handler, UINT ms, UINT_PTR id )
+      {
+        if( !ms ) { kill(he, handler, id); return true; }
+        UINT ticks = (ms + TICK_MS - 1) / TICK_MS;
+        node_key key = { he, handler, id };
+        if( forget_fallback(key) ) // the element got its window
+          HTMLayoutSetTimerEx(he, 0, id);
+        index_t::iterator it = _index.find(key);
+        if( it != _index.end() )
+        {
+          timer_node* n = it->second;
+          n->period = ticks;
+          n->seq = ++_seq;
+          if( n->state != timer_node::FIRING ) // firing one is rescheduled by on_tick
+            n->owner->reschedule(n, ticks);
+          else
+            n->expires = n->owner->now() + ticks;
+          return true;
+        }
+        wheel* w = wheel_of(he);
+        if( !w )
+        {
+          _fallbacks.push_back(key);
+          HTMLayoutSetTimerEx(he, ms, id);
+          return false;
+        }
+        timer_node* n = new timer_node();
+        n->next = n->prev = n;
+        n->owner = w; n->he = he; n->handler = handler; n->id = id;
+        n->period = ticks; n->seq = ++_seq;
+        n->expires = w->now() + ticks;
+        HTMLayout_UseElement(he);
+        _index[key] = n;
+        ++stats().timers;
+        w->add(n);
+        return true;
+      }
+
+      bool forget_fallback( const node_key& key )
+      {
+        for( size_t n = 0; n < _fallbacks.size(); ++n )
+          if( !(_fallbacks[n] < key) && !(key < _fallbacks[n]) )
+          {
+            _fallbacks.erase(_fallbacks.begin() + n);
+            return true;
+          }
+        return false;
+      }
+
+      void release( timer_node* n )
+      {
+        node_key key = { n->he, n->handler, n->id };
+        _index.erase(key);
+        wheel* w = n->owner;
+        w->remove(n);
+        --stats().timers;
+        if( w->empty() && !w->ticking() ) free_wheel(w);
+        if( n->state == timer_node::FIRING )
+        {
+          n->state = timer_node::DEAD; // freed by on_tick
+          return;
+        }
+        HTMLayout_UnuseElement(n->he);
+        delete n;
+      }
+
+      // the window timer of the wheel is stopped already
+      void free_wheel( wheel* w )
+      {
+        _wheels.erase( std::find(_wheels.begin(), _wheels.end(), w) );
+        delete w;
+      }
+
+      void kill( HELEMENT he, event_handler* handler, UINT_PTR id )
+      {
+        node_key key = { he, handler, id };
+        index_t::iterator it = _index.find(key);
+        if( it != _index.end() )
+          release(it->second);
+        else if( forget_fallback(key) )
+          HTMLayoutSetTimerEx(he, 0, id);
+      }
+
+      void kill_all( HELEMENT he, event_handler* handler )
+      {
+        node_key key = { he, handler, 0 };
+        std::vector<timer_node*> found;
+        for( index_t::iterator it = _index.lower_bound(key); it != _index.end() && it->first.he == he && it->first.handler == handler; ++it )
+          found.push_back(it->second);
+        for( size_t n = 0; n < found.size(); ++n )
+          release(found[n]);
+        for( size_t n = _fallbacks.size(); n > 0; --n )
+          if( _fallbacks[n - 1].he == he && _fallbacks[n - 1].handler == handler )
+          {
+            HTMLayoutSetTimerEx(he, 0, _fallbacks[n - 1].id);
+            _fallbacks.erase(_fallbacks.begin() + (n - 1));
+          }
+      }
+
+      void resume( HELEMENT he )
+      {
+        for( size_t n = 0; n < _wheels.size(); ++n )
+          _wheels[n]->resume(he);
+      }
+
+      size_t wheels() const { return _wheels.size(); }
+    };
+
+    inline void wheel::on_tick()
+    {
+      DWORD now_ms = ::GetTickCount();
+      UINT elapsed = (now_ms - _last_ms) / TICK_MS;
+      if( !elapsed ) return;
+      _last_ms += elapsed * TICK_MS;
+
+      std::vector<timer_node*> expired, buf;
+      for( UINT t = 0; t < elapsed; ++t )
+      {
+        ++_now;
+        UINT idx = UINT(_now) & (L0_SIZE - 1);
+        if( idx == 0 )
+          cascade(0, buf);
+        _l0[idx].take(expired);
+      }
+      if( (_poll -= min(_poll, elapsed)) == 0 )
+      {
+        _poll = SUSPEND_POLL_MS / TICK_MS;
+        std::vector<timer_node*> all;
+        _suspended.take(all);
+        for( size_t i = 0; i < all.size(); ++i )
+        {
+          unsuspended();
+          all[i]->state = timer_node::FIRING; // goes through visibility check below
+          expired.push_back(all[i]);
+        }
+      }
+      if( expired.empty() ) { retime(); return; }
+
+      std::sort(expired.begin(), expired.end(), deadline_less());
+      ++stats().batches;
+      _ticking = true;
+
+      // the whole batch is FIRING: handlers that kill or set timers of it leave them to this loop
+      for( size_t i = 0; i < expired.size(); ++i )
+        expired[i]->state = timer_node::FIRING;
+
+      service& svc = service::instance();
+      for( size_t i = 0; i < expired.size(); ++i )
+      {
+        timer_node* n = expired[i];
+        if( n->state == timer_node::DEAD ) // killed by a handler fired before
+        {
+          HTMLayout_UnuseElement(n->he);
+          delete n;
+          continue;
+        }
+        if( n->expires > _now ) // set again by a handler fired before
+        {
+          place(n);
+          continue;
+        }
+        if( !dom::element(n->he).visible() )
+        {
+          suspend(n);
+          continue;
+        }
+        TIMER_PARAMS tp; tp.timerId = n->id;
+        BOOL keep = n->handler->event_proc()(n->handler, n->he, HANDLE_TIMER, &tp);
+        ++stats().fired;
+        bool rearmed = n->expires > _now; // set() by the handler
+        if( n->state == timer_node::DEAD ) // killed by the handler
+        {
+          HTMLayout_UnuseElement(n->he);
+          delete n;
+        }
+        else if( keep || rearmed )
+        {
+          if( !rearmed ) n->expires = _now + n->period;
+          place(n);
+        }
+        else
+        {
+          n->state = timer_node::DEAD; // not FIRING: release() frees it
+          svc.release(n);
+        }
+      }
+      _ticking = false;
+      retime();
+      if( empty() ) svc.free_wheel(this); // the last statement, frees this
+    }
+
+    /** starts (or restarts) timer of the handler on the element.
+     *  \param ms \b UINT, period, 0 - stop the timer.
+     *  \param id \b UINT_PTR, 0 - handler gets on_timer(he), otherwise on_timer(he, id).
+     *  Falls back to HTMLayoutSetTimerEx if element is not in a window yet.
+     **/
+    inline void set( HELEMENT he, event_handler* handler, UINT ms, UINT_PTR id = 0 )
+    {
+      service::instance().set(he, handler, ms, id);
+    }
+    /** stops timer of the handler on the element, the engine timer only if set() fell back to it **/
+    inline void kill( HELEMENT he, event_handler* handler, UINT_PTR id = 0 )
+    {
+      service::instance().kill(he, handler, id);
+    }
+    /** resumes suspended timers of the element (or of all elements if he == 0), e.g. on VISIUAL_STATUS_CHANGED **/
+    inline void resume( HELEMENT he = 0 )
+    {
+      service::instance().resume(he);
+    }
+
+  } // timers namespace
+
+}
+
+#endif
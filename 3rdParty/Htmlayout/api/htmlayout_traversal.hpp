@@ -0,0 +1,273 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Non-recursive DOM traversal.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_traversal_hpp__
+#define __htmlayout_traversal_hpp__
+
+#pragma once
+
+/*!\file
+\brief Lazy DOM traversal: ancestors, descendants and siblings of the element.
+
+Iterators yield borrowed handles - HELEMENTs that are not add-refed.
+They are valid while the DOM is not modified, e.g. inside event handler.
+Wrap handle into dom::element if it needs to be kept longer.
+
+\par Example:
+\code
+  HELEMENT he;
+  for( dom::ancestors it(target); it.next(he); )
+    if( ... ) break;
+
+  dom::element row = dom::closest(target, dom::child_of(table));
+\endcode
+*/
+
+#include <limits.h>
+
+#include "htmlayout_dom.hpp"
+
+namespace htmlayout
+{
+  namespace dom
+  {
+
+    namespace traversal
+    {
+      inline HELEMENT parent_of( HELEMENT he )
+      {
+        HELEMENT hp = 0;
+        HTMLayoutGetParentElement(he, &hp);
+        return hp;
+      }
+      inline UINT children_count_of( HELEMENT he )
+      {
+        UINT n = 0;
+        HTMLayoutGetChildrenCount(he, &n);
+        return n;
+      }
+      inline HELEMENT child_of( HELEMENT he, UINT n )
+      {
+        HELEMENT hc = 0;
+        HTMLayoutGetNthChild(he, n, &hc);
+        return hc;
+      }
+      inline UINT index_of( HELEMENT he )
+      {
+        UINT idx = 0;
+        HTMLayoutGetElementIndex(he, &idx);
+        return idx;
+      }
+    }
+
+    /** ancestors - parent, grand parent, ... up to the root.
+     **/
+    class ancestors
+    {
+      HELEMENT _he;
+      UINT     _depth;
+    public:
+      ancestors( HELEMENT start, bool include_self = false, UINT max_depth = UINT_MAX ):
+        _he( include_self? start: (start? traversal::parent_of(start): 0) ), _depth(max_depth) {}
+
+      bool next( HELEMENT& he )
+      {
+        if( !_he || !_depth ) return false;
+        he = _he;
+        _he = traversal::parent_of(_he);
+        --_depth;
+        return true;
+      }
+    };
+
+    /** descendants - pre-order (document order) walk of the subtree, root is not included.
+     *  \param max_depth \b UINT, 1 - children only, 2 - children and grand children, etc.
+     **/
+    class descendants
+    {
+      HELEMENT _root;
+      HELEMENT _he;   // last yielded
+      UINT     _depth;
+      UINT     _max_depth;
+      bool     _started;
+    public:
+      descendants( HELEMENT root, UINT max_depth = UINT_MAX ):
+        _root(root), _he(0), _depth(0), _max_depth(max_depth), _started(false) {}
+
+      bool next( HELEMENT& he )
+      {
+        if( !_root ) return false;
+        if( !_started )
+        {
+          _started = true;
+          if( !_max_depth || !traversal::children_count_of(_root) ) return false;
+          _he = traversal::child_of(_root, 0); _depth = 1;
+          he = _he; return true;
+        }
+        if( !_he ) return false;
+
+        // down
+        if( _depth < _max_depth && traversal::children_count_of(_he) )
+        {
+          _he = traversal::child_of(_he, 0); ++_depth;
+          he = _he; return true;
+        }
+        // next sibling, climbing up as needed
+        while( _he != _root )
+        {
+          HELEMENT hp = traversal::parent_of(_he);
+          if( !hp ) break;
+          UINT idx = traversal::index_of(_he) + 1;
+          if( idx < traversal::children_count_of(hp) )
+          {
+            _he = traversal::child_of(hp, idx);
+            he = _he; return true;
+          }
+          _he = hp; --_depth;
+        }
+        _he = 0;
+        return false;
+      }
+    };
+
+    /** following_siblings - next sibling, the one after it, etc.
+     **/
+    class following_siblings
+    {
+      HELEMENT _parent;
+      UINT     _idx;
+      UINT     _count;
+    public:
+      following_siblings( HELEMENT start ): _parent( start? traversal::parent_of(start): 0 ), _idx(0), _count(0)
+      {
+        if( _parent )
+        {
+          _idx = traversal::index_of(start) + 1;
+          _count = traversal::children_count_of(_parent);
+        }
+      }
+      bool next( HELEMENT& he )
+      {
+        if( !_parent || _idx >= _count ) return false;
+        he = traversal::child_of(_parent, _idx++);
+        return true;
+      }
+    };
+
+    /** preceding_siblings - previous sibling, the one before it, etc. (in reverse document order)
+     **/
+    class preceding_siblings
+    {
+      HELEMENT _parent;
+      UINT     _idx;
+    public:
+      preceding_siblings( HELEMENT start ): _parent( start? traversal::parent_of(start): 0 ), _idx(0)
+      {
+        if( _parent )
+          _idx = traversal::index_of(start);
+      }
+      bool next( HELEMENT& he )
+      {
+        if( !_parent || _idx == 0 ) return false;
+        he = traversal::child_of(_parent, --_idx);
+        return true;
+      }
+    };
+
+    // predicates
+
+    /** element which parent is the given one **/
+    struct child_of
+    {
+      HELEMENT parent;
+      child_of( HELEMENT p ): parent(p) {}
+      bool operator()( HELEMENT he ) const { return traversal::parent_of(he) == parent; }
+    };
+
+    /** the element itself **/
+    struct same_as
+    {
+      HELEMENT that;
+      same_as( HELEMENT h ): that(h) {}
+      bool operator()( HELEMENT he ) const { return he == that; }
+    };
+
+    /** element of the given tag, e.g. "tr" **/
+    struct tag_is
+    {
+      const char* tag;
+      tag_is( const char* t ): tag(t) {}
+      bool operator()( HELEMENT he ) const
+      {
+        LPCSTR type = 0;
+        HTMLayoutGetElementType(he, &type);
+        return aux::streq(type, tag);
+      }
+    };
+
+    /** element matching CSS selector(s) **/
+    struct matches
+    {
+      const char* selector;
+      matches( const char* s ): selector(s) {}
+      bool operator()( HELEMENT he ) const
+      {
+        HELEMENT found = 0;
+        HTMLayoutSelectParent(he, selector, 1, &found);
+        return found != 0;
+      }
+    };
+
+    /** closest - the element itself or its nearest ancestor satisfying the predicate.
+     *  \param max_depth \b UINT, number of elements to test, starting from the element itself.
+     *  \return \b HELEMENT, borrowed handle or 0.
+     **/
+    template <typename PREDICATE>
+      inline HELEMENT closest( HELEMENT start, const PREDICATE& pred, UINT max_depth = UINT_MAX )
+      {
+        HELEMENT he;
+        for( ancestors it(start, true, max_depth); it.next(he); )
+          if( pred(he) ) return he;
+        return 0;
+      }
+
+    /** closest by CSS selector, done by the engine in one call **/
+    inline HELEMENT closest( HELEMENT start, const char* selector, UINT max_depth = 0 )
+    {
+      HELEMENT found = 0;
+      if( start )
+        HTMLayoutSelectParent(start, selector, max_depth, &found);
+      return found;
+    }
+
+    /** first descendant satisfying the predicate, in document order.
+     **/
+    template <typename PREDICATE>
+      inline HELEMENT find_descendant( HELEMENT root, const PREDICATE& pred, UINT max_depth = UINT_MAX )
+      {
+        HELEMENT he;
+        for( descendants it(root, max_depth); it.next(he); )
+          if( pred(he) ) return he;
+        return 0;
+      }
+
+    /** true if child is the element itself or one of its descendants.
+     **/
+    inline bool is_inside( HELEMENT child, HELEMENT parent )
+    {
+      return parent && closest(child, same_as(parent)) != 0;
+    }
+
+  } // dom namespace
+
+} // htmlayout namespace
+
+#endif
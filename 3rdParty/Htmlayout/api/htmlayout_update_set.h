@@ -0,0 +1,170 @@
+#ifndef __htmlayout_update_set_h__
+#define __htmlayout_update_set_h__
+
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Coalescing of HTMLayoutUpdateElementEx calls.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+/*!\file
+\brief Set of "dirty" elements updated by one call per top-most subtree.
+*/
+
+#include <windows.h>
+#include <assert.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "htmlayout_dom.h"
+
+#if defined(__cplusplus) && !defined( PLAIN_API_ONLY )
+
+namespace htmlayout
+{
+  namespace dom
+  {
+
+    /** update_set - collects elements that need HTMLayoutUpdateElementEx.
+     *
+     *  flush() folds every element into its top-most dirty ancestor
+     *  and issues exactly one update call per remaining subtree.
+     *
+     *  It uses only plain DOM API so it can be used by htmlayout::queue
+     *  (that is included before dom::element is defined).
+     **/
+    class update_set
+    {
+      struct entry
+      {
+        HELEMENT he;
+        UINT     flags;
+        bool operator < ( const entry& r ) const { return he < r.he; }
+      };
+
+      std::vector<entry> _entries;
+      UINT               _requested; // number of add() calls
+      UINT               _issued;    // number of HTMLayoutUpdateElementEx calls made
+
+      update_set(const update_set&);
+      update_set& operator=(const update_set&);
+
+    public:
+      update_set(): _requested(0), _issued(0) {}
+      ~update_set() { clear(); }
+
+      /** Mark element as dirty. Flags are UPDATE_ELEMENT_FLAGS.
+       *  Default is equivalent of element::update(true).
+       **/
+      void add( HELEMENT he, UINT flags = RESET_STYLE_DEEP | MEASURE_DEEP )
+      {
+        if( !he ) return;
+        ++_requested;
+        if( !_entries.empty() && _entries.back().he == he )
+        {
+          _entries.back().flags |= flags; // most common case - the same element again
+          return;
+        }
+        if( HTMLayout_UseElement(he) != HLDOM_OK )
+          return;
+        entry e; e.he = he; e.flags = flags;
+        _entries.push_back(e); // duplicates are merged by flush()
+      }
+
+      bool is_empty() const { return _entries.empty(); }
+
+      /** Issue updates. Returns number of engine calls made. **/
+      UINT flush()
+      {
+        if( _entries.empty() )
+          return 0;
+
+        std::vector<entry> sorted = _entries;
+        std::sort(sorted.begin(),sorted.end());
+
+        // merge duplicates
+        size_t last = 0;
+        for( size_t n = 1; n < sorted.size(); ++n )
+        {
+          if( sorted[n].he == sorted[last].he )
+            sorted[last].flags |= sorted[n].flags;
+          else
+            sorted[++last] = sorted[n];
+        }
+        sorted.resize(last + 1);
+
+        // find top-most dirty ancestor of each entry
+        std::vector<int> owner(sorted.size(), -1);
+        for( size_t n = 0; n < sorted.size(); ++n )
+        {
+          HELEMENT hp = 0;
+          HTMLayoutGetParentElement(sorted[n].he, &hp);
+          while( hp )
+          {
+            int idx = find(sorted, hp);
+            if( idx >= 0 ) owner[n] = idx;
+            HELEMENT hpp = 0;
+            HTMLayoutGetParentElement(hp, &hpp);
+            hp = hpp;
+          }
+        }
+        // fold flags of nested elements into their owners
+        for( size_t n = 0; n < sorted.size(); ++n )
+        {
+          if( owner[n] < 0 ) continue;
+          UINT f = sorted[n].flags;
+          UINT& of = sorted[owner[n]].flags;
+          if( f & (RESET_STYLE_THIS | RESET_STYLE_DEEP) ) of |= RESET_STYLE_DEEP;
+          if( f & (MEASURE_INPLACE | MEASURE_DEEP) )     of |= MEASURE_DEEP;
+          if( f & REDRAW_NOW )                           of |= REDRAW_NOW;
+        }
+        UINT calls = 0;
+        for( size_t n = 0; n < sorted.size(); ++n )
+        {
+          if( owner[n] >= 0 ) continue;
+          HTMLayoutUpdateElementEx(sorted[n].he, sorted[n].flags);
+          ++calls;
+        }
+        _issued += calls;
+        clear();
+        return calls;
+      }
+
+      /** Drop all pending updates without issuing them. **/
+      void clear()
+      {
+        for( size_t n = 0; n < _entries.size(); ++n )
+          HTMLayout_UnuseElement(_entries[n].he);
+        _entries.clear();
+      }
+
+      // instrumentation
+      UINT requested() const { return _requested; }
+      UINT issued() const    { return _issued; }
+      UINT saved() const     { return _requested > _issued? _requested - _issued: 0; }
+      void reset_counters()  { _requested = _issued = 0; }
+
+    private:
+      static int find( const std::vector<entry>& sorted, HELEMENT he )
+      {
+        entry e; e.he = he; e.flags = 0;
+        std::vector<entry>::const_iterator it = std::lower_bound(sorted.begin(),sorted.end(),e);
+        if( it != sorted.end() && it->he == he )
+          return int(it - sorted.begin());
+        return -1;
+      }
+    };
+
+  } // dom namespace
+
+} // htmlayout namespace
+
+#endif // __cplusplus
+
+#endif
@@ -0,0 +1,471 @@
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Background workers with continuations in GUI thread.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __htmlayout_workers_hpp__
+#define __htmlayout_workers_hpp__
+
+#pragma once
+
+/*!\file
+\brief workers - work stealing thread pool, results are delivered to the GUI thread through gui_queue.
+
+Each worker thread has its own deque of tasks. Tasks spawned by a worker go to its own deque
+and are taken LIFO (hot in cache), tasks from other threads are spread round robin.
+Idle worker steals the oldest task from the deque of other worker before going to sleep.
+Task nodes are the pooled nodes of queue::post() - small closures need no heap allocations.
+
+run(work).then_on_gui(cont) calls cont(result) in GUI thread by queue::post().
+Work that belongs to an element is bound to it by on(he): the element token is cancelled
+when a handler of the element gets detached (event_handler::detached), so the work that has not
+started yet is not run and the result that has not been delivered yet is dropped - the continuation
+never sees dead HELEMENT. Note that on(he) is cancelled by detach of any handler of the element,
+e.g. when one of its two behaviors is removed. on(he, handler) is cancelled only when that handler
+gets detached - it is detached when the element dies too. The token is checked in GUI thread right before the continuation,
+so there is no window between the check and the call.
+
+Needs C++11 (HTMLAYOUT_QUEUE_POST).
+
+\par Example:
+\code
+  virtual BOOL on_event( HELEMENT he, HELEMENT, BEHAVIOR_EVENTS type, UINT_PTR )
+  {
+    if( type != BUTTON_CLICK ) return FALSE;
+    std::wstring path = ...;
+    background().run( [path]() { return load_rows(path); } )
+                .on(he, this)
+                .then_on_gui( [he](rows r) { show_rows(he, r); } );
+    return TRUE;
+  }
+\endcode
+*/
+
+#include <deque>
+#include <vector>
+#include <map>
+
+#include "htmlayout_queue.h"
+#include "htmlayout_behavior.hpp"
+
+#if !defined(HTMLAYOUT_QUEUE_POST)
+  #error htmlayout_workers.hpp needs C++11 compiler
+#endif
+
+namespace htmlayout
+{
+
+  /** cancel_token - shared cancellation flag. Default constructed one is never cancelled. **/
+  class cancel_token
+  {
+    struct state
+    {
+      volatile LONG refs;
+      volatile LONG cancelled;
+    };
+    state* ps;
+
+  public:
+    cancel_token(): ps(0) {}
+    cancel_token( const cancel_token& t ): ps(t.ps) { if( ps ) ::InterlockedIncrement(&ps->refs); }
+    cancel_token( cancel_token&& t ): ps(t.ps) { t.ps = 0; }
+    ~cancel_token() { release(); }
+    cancel_token& operator=( cancel_token t ) { std::swap(ps, t.ps); return *this; }
+
+    // new token that can be cancelled
+    static cancel_token make()
+    {
+      cancel_token t;
+      t.ps = new state;
+      t.ps->refs = 1;
+      t.ps->cancelled = 0;
+      return t;
+    }
+
+    void cancel() { if( ps ) ::InterlockedExchange(&ps->cancelled, 1); }
+    bool cancelled() const { return ps && ps->cancelled; }
+    bool cancellable() const { return ps != 0; }
+
+  private:
+    void release()
+    {
+      if( ps && ::InterlockedDecrement(&ps->refs) == 0 )
+        delete ps;
+      ps = 0;
+    }
+  };
+
+  /** element_tokens - tokens of elements, cancelled when a handler of the element gets detached.
+   *  Token of the element and the handler is cancelled when that handler gets detached,
+   *  token of the element alone (handler 0) - when any handler of the element gets detached.
+   *  GUI thread only. The element shall have a behavior attached, otherwise nothing tells
+   *  that it is gone and its token stays till cancel(he).
+   **/
+  class element_tokens
+  {
+  public:
+    static element_tokens& instance()
+    {
+      static element_tokens _instance;
+      static bool _hooked = hook(); _hooked;
+      return _instance;
+    }
+
+    // token of the element and the handler, created on first request
+    cancel_token of( HELEMENT he, event_handler* h = 0 )
+    {
+      key k(he, h);
+      std::map<key, cancel_token>::iterator it = _tokens.find(k);
+      if( it == _tokens.end() )
+        it = _tokens.insert( std::make_pair(k, cancel_token::make()) ).first;
+      return it->second;
+    }
+
+    // cancels work of the element bound to the handler and to the element alone,
+    // next of() gives new token
+    void cancel( HELEMENT he, event_handler* h )
+    {
+      cancel(key(he, h));
+      if( h ) cancel(key(he, 0));
+    }
+
+    // cancels all work of the element
+    void cancel( HELEMENT he )
+    {
+      std::map<key, cancel_token>::iterator it = _tokens.lower_bound(key(he, 0));
+      while( it != _tokens.end() && it->first.first == he )
+      {
+        it->second.cancel();
+        _tokens.erase(it++);
+      }
+    }
+
+    size_t size() const { return _tokens.size(); }
+
+  private:
+    typedef std::pair<HELEMENT, event_handler*> key;
+    std::map<key, cancel_token> _tokens;
+
+    void cancel( const key& k )
+    {
+      std::map<key, cancel_token>::iterator it = _tokens.find(k);
+      if( it == _tokens.end() ) return;
+      it->second.cancel();
+      _tokens.erase(it);
+    }
+
+    element_tokens() {}
+
+    static event_handler::detach_hook_t*& previous_hook() { static event_handler::detach_hook_t* _prev = 0; return _prev; }
+    static bool hook() // once, other services chain to it the same way
+    {
+      previous_hook() = event_handler::detach_hook();
+      event_handler::detach_hook() = &on_detach;
+      return true;
+    }
+    static void on_detach( event_handler* h, HELEMENT he )
+    {
+      instance().cancel(he, h);
+      if( previous_hook() ) previous_hook()(h, he);
+    }
+  };
+
+  inline cancel_token element_token( HELEMENT he, event_handler* h = 0 ) { return element_tokens::instance().of(he, h); }
+
+  // instrumentation of the pool
+  struct workers_stats
+  {
+    LONG executed;  // tasks run
+    LONG stolen;    // of them taken from deques of other workers
+    LONG cancelled; // tasks dropped by cancelled tokens before or right after the work
+    LONG pending;   // tasks in deques
+  };
+
+  class workers
+  {
+    struct worker
+    {
+      workers*               pool;
+      UINT                   index;
+      HANDLE                 thread;
+      mutex                  guard;
+      std::deque<gui_task*>  tasks;    // owner takes from back, thieves from front
+      volatile LONG          size;     // of tasks, written under the guard, read by thieves without it
+      LONG                   executed; // written by the owner only
+      LONG                   stolen;
+    };
+
+  public:
+    // threads == 0 - one less than number of processors (GUI thread has its own), at least one
+    explicit workers( UINT threads = 0, queue& gui = gui_queue ):
+      _gui(gui), _wake(0), _tls(::TlsAlloc()), _pending(0), _sleeping(0), _stop(0), _next(0), _cancelled(0)
+    {
+      if( !threads )
+      {
+        SYSTEM_INFO si;
+        ::GetSystemInfo(&si);
+        threads = si.dwNumberOfProcessors > 1? si.dwNumberOfProcessors - 1: 1;
+      }
+      _wake = ::CreateSemaphore(0, 0, LONG(threads) * 16 + 16, 0);
+      for( UINT n = 0; n < threads; ++n )
+      {
+        worker* w = new worker;
+        w->pool = this;
+        w->index = n;
+        w->thread = 0;
+        w->size = 0;
+        w->executed = 0;
+        w->stolen = 0;
+        _workers.push_back(w);
+      }
+      for( UINT n = 0; n < threads; ++n )
+        _workers[n]->thread = ::CreateThread(0, 0, &thread_proc, _workers[n], 0, 0);
+    }
+
+    // waits for running tasks, tasks that have not started are dropped
+    ~workers()
+    {
+      ::InterlockedExchange(&_stop, 1);
+      ::ReleaseSemaphore(_wake, LONG(_workers.size()), 0);
+      for( size_t n = 0; n < _workers.size(); ++n )
+      {
+        worker* w = _workers[n];
+        ::WaitForSingleObject(w->thread, INFINITE);
+        ::CloseHandle(w->thread);
+        for( size_t i = 0; i < w->tasks.size(); ++i )
+          delete w->tasks[i];
+        delete w;
+      }
+      ::CloseHandle(_wake);
+      ::TlsFree(_tls);
+    }
+
+    /** job - what run() returns. The work is queued by then_on_gui() or, if it was not called,
+     *  at the end of the full expression: pool.run(work); is "fire and forget".
+     **/
+    template <class F>
+      class job
+      {
+        friend class workers;
+        workers*     pool;
+        F            work;
+        cancel_token token;
+        job( workers* p, F&& f ): pool(p), work(std::move(f)) {}
+        job( const job& );
+        job& operator=( const job& );
+      public:
+        job( job&& j ): pool(j.pool), work(std::move(j.work)), token(std::move(j.token)) { j.pool = 0; }
+        ~job() { if( pool ) pool->spawn( guarded<F>(std::move(work), token, pool) ); }
+
+        // work is cancelled with the token
+        job& cancel_with( const cancel_token& t ) { token = t; return *this; }
+        // work is cancelled when a handler of the element gets detached or, if h is given,
+        // when h gets detached from the element. GUI thread only
+        job& on( HELEMENT he, event_handler* h = 0 ) { token = element_token(he, h); return *this; }
+
+        // queues the work, cont(result) or cont() for void work is posted to the GUI queue
+        template <class G>
+          void then_on_gui( G&& cont, UINT priority = TASK_NORMAL )
+          {
+            typedef typename std::decay<G>::type continuation;
+            workers* p = pool;
+            pool = 0;
+            p->spawn( with_continuation<F, continuation>(std::move(work), continuation(std::forward<G>(cont)), token, p, priority) );
+          }
+      };
+
+    // work is a callable with no arguments, its result goes to the continuation
+    template <class F>
+      job<typename std::decay<F>::type> run( F&& work )
+      {
+        typedef typename std::decay<F>::type callable;
+        return job<callable>( this, callable(std::forward<F>(work)) );
+      }
+
+    queue& gui() const { return _gui; }
+    UINT   threads() const { return UINT(_workers.size()); }
+
+    workers_stats stats() const
+    {
+      workers_stats st = { 0, 0, _cancelled, _pending };
+      for( size_t n = 0; n < _workers.size(); ++n )
+      {
+        st.executed += _workers[n]->executed;
+        st.stolen += _workers[n]->stolen;
+      }
+      return st;
+    }
+
+  private:
+    std::vector<worker*> _workers;
+    queue&               _gui;
+    HANDLE               _wake;      // semaphore, released when tasks come and somebody sleeps
+    DWORD                _tls;       // worker* of the current thread
+    volatile LONG        _pending;   // tasks in deques
+    volatile LONG        _sleeping;  // workers that are about to wait or waiting
+    volatile LONG        _stop;
+    volatile LONG        _next;      // round robin of tasks from outside
+    volatile LONG        _cancelled;
+
+    workers( const workers& );
+    workers& operator=( const workers& );
+
+    // work that is skipped if the token was cancelled before it started
+    template <class F>
+      struct guarded
+      {
+        F            work;
+        cancel_token token;
+        workers*     pool;
+        guarded( F&& f, const cancel_token& t, workers* p ): work(std::move(f)), token(t), pool(p) {}
+        void operator()()
+        {
+          if( token.cancelled() ) { pool->count_cancelled(); return; }
+          work();
+        }
+      };
+
+    // continuation with the result, runs in GUI thread, may outlive the pool
+    template <class G, class R>
+      struct deliver
+      {
+        G            cont;
+        R            result;
+        cancel_token token;
+        deliver( G&& g, R&& r, cancel_token&& t ): cont(std::move(g)), result(std::move(r)), token(std::move(t)) {}
+        void operator()() { if( !token.cancelled() ) cont(std::move(result)); }
+      };
+    template <class G>
+      struct deliver<G, void>
+      {
+        G            cont;
+        cancel_token token;
+        deliver( G&& g, cancel_token&& t ): cont(std::move(g)), token(std::move(t)) {}
+        void operator()() { if( !token.cancelled() ) cont(); }
+      };
+
+    template <class F, class G>
+      struct with_continuation
+      {
+        typedef decltype(std::declval<F&>()()) result_type;
+        F            work;
+        G            cont;
+        cancel_token token;
+        workers*     pool;
+        UINT         priority;
+        with_continuation( F&& f, G&& g, const cancel_token& t, workers* p, UINT prio ):
+          work(std::move(f)), cont(std::move(g)), token(t), pool(p), priority(prio) {}
+        void operator()()
+        {
+          if( token.cancelled() ) { pool->count_cancelled(); return; }
+          run( std::is_void<result_type>() );
+        }
+        void run( std::false_type )
+        {
+          result_type r = work();
+          if( token.cancelled() ) { pool->count_cancelled(); return; } // no need to bother GUI thread
+          pool->_gui.post( deliver<G, result_type>(std::move(cont), std::move(r), std::move(token)), priority );
+        }
+        void run( std::true_type )
+        {
+          work();
+          if( token.cancelled() ) { pool->count_cancelled(); return; }
+          pool->_gui.post( deliver<G, void>(std::move(cont), std::move(token)), priority );
+        }
+      };
+
+    void count_cancelled() { ::InterlockedIncrement(&_cancelled); }
+
+    template <class F>
+      void spawn( F&& f )
+      {
+        typedef typename posted_task_of<F>::type task;
+        gui_task* t = new task( std::move(f) );
+        worker* w = static_cast<worker*>(::TlsGetValue(_tls));
+        if( !w ) // not a worker thread
+          w = _workers[ UINT(::InterlockedIncrement(&_next)) % _workers.size() ];
+        w->guard.lock();
+        w->tasks.push_back(t);
+        ::InterlockedExchange(&w->size, LONG(w->tasks.size()));
+        w->guard.unlock();
+        ::InterlockedIncrement(&_pending);
+        // pairs with _sleeping increment in idle(): either the worker sees the task or we see the sleeper
+        if( _sleeping )
+          ::ReleaseSemaphore(_wake, 1, 0);
+      }
+
+    gui_task* pop( worker* w )
+    {
+      gui_task* t = 0;
+      w->guard.lock();
+      if( !w->tasks.empty() )
+      {
+        t = w->tasks.back();
+        w->tasks.pop_back();
+        ::InterlockedExchange(&w->size, LONG(w->tasks.size()));
+      }
+      w->guard.unlock();
+      return t;
+    }
+
+    gui_task* steal( worker* thief )
+    {
+      size_t n = _workers.size();
+      for( size_t i = 1; i < n; ++i )
+      {
+        worker* w = _workers[(thief->index + i) % n];
+        if( !w->size ) continue; // peek, rechecked under the lock
+        gui_task* t = 0;
+        w->guard.lock();
+        if( !w->tasks.empty() )
+        {
+          t = w->tasks.front();
+          w->tasks.pop_front();
+          ::InterlockedExchange(&w->size, LONG(w->tasks.size()));
+        }
+        w->guard.unlock();
+        if( t ) { ++thief->stolen; return t; }
+      }
+      return 0;
+    }
+
+    void idle()
+    {
+      ::InterlockedIncrement(&_sleeping);
+      if( !_pending && !_stop )
+        ::WaitForSingleObject(_wake, INFINITE);
+      ::InterlockedDecrement(&_sleeping);
+    }
+
+    void work_loop( worker* w )
+    {
+      ::TlsSetValue(_tls, w);
+      while( !_stop )
+      {
+        gui_task* t = pop(w);
+        if( !t ) t = steal(w);
+        if( !t ) { idle(); continue; }
+        ::InterlockedDecrement(&_pending);
+        t->exec();
+        delete t;
+        ++w->executed;
+      }
+    }
+
+    static DWORD WINAPI thread_proc( LPVOID p )
+    {
+      worker* w = static_cast<worker*>(p);
+      w->pool->work_loop(w);
+      return 0;
+    }
+  };
+
+}
+
+#endif
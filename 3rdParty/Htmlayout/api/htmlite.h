@@ -411,7 +411,7 @@ public:
     if(pb) 
     {
       pn->elementTag = pb;
-      pn->elementProc = htmlayout::event_handler::element_proc;
+      pn->elementProc = pb->event_proc();
       pn->elementEvents = pb->subscribed_to;
       return TRUE;
     }
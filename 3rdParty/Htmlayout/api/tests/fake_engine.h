@@ -0,0 +1,325 @@
+#ifndef __fake_engine_h__
+#define __fake_engine_h__
+
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * In-memory stand-in of the engine DOM API for the tests.
+ * Elements are fake::node's, HELEMENT is node*. Calls the headers under test make
+ * are implemented here, update calls are logged so tests can count them.
+ *
+ * Include it once per test executable, after the headers under test.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fake
+{
+  struct node
+  {
+    struct handler { LPELEMENT_EVENT_PROC proc; LPVOID tag; UINT subscription; };
+    struct timer   { UINT_PTR id; UINT ms; };
+
+    std::string                         tag;
+    node*                               parent;
+    std::vector<node*>                  kids;
+    std::map<std::string,std::wstring>  attributes;
+    std::map<std::string,std::wstring>  styles;
+    std::wstring                        text;
+    std::string                         html;     // markup set by HTMLayoutSetElementHtml
+    UINT                                state;
+    HWND                                hwnd;
+    bool                                dead;
+    bool                                visible;
+    int                                 uses;
+    HTMLayoutElementExpando*            expando;
+    std::vector<handler>                handlers;
+    std::vector<timer>                  timers;
+
+    node( const char* t, node* p = 0 ): tag(t), parent(0), state(0), hwnd((HWND)1), dead(false), visible(true), uses(0), expando(0)
+    {
+      if( p ) { parent = p; hwnd = p->hwnd; p->kids.push_back(this); }
+    }
+    UINT index() const
+    {
+      if( !parent ) return 0;
+      for( UINT n = UINT(parent->kids.size()); n > 0; --n ) if( parent->kids[n - 1] == this ) return n - 1; // last ones are killed first
+      return 0;
+    }
+  };
+
+  inline node* n( HELEMENT he ) { return (node*)he; }
+
+  struct update_call { HELEMENT he; UINT flags; };
+  inline std::vector<update_call>& updates() { static std::vector<update_call> log; return log; }
+
+  /** events posted by HTMLayoutPostEvent, they are not delivered **/
+  struct posted_event { HELEMENT he; UINT code; HELEMENT source; UINT_PTR reason; };
+  inline std::vector<posted_event>& posted() { static std::vector<posted_event> log; return log; }
+
+  /** number of ValueClear() calls **/
+  inline size_t& value_clears() { static size_t n = 0; return n; }
+
+  /** number of calls send() made to element procs **/
+  inline size_t& deliveries() { static size_t n = 0; return n; }
+
+  /** sends the event to the element handlers, last attached first, like the engine does **/
+  inline BOOL send( node* el, UINT evtg, LPVOID prms )
+  {
+    std::vector<node::handler> hs = el->handlers; // handlers may detach themselves
+    for( size_t i = hs.size(); i > 0; --i )
+    {
+      const node::handler& h = hs[i - 1];
+      if( evtg != HANDLE_INITIALIZATION && !(h.subscription & evtg) ) continue;
+      ++deliveries();
+      if( h.proc(h.tag, el, evtg, prms) ) return TRUE;
+    }
+    return FALSE;
+  }
+
+  /** the element is deleted from the DOM: handlers get BEHAVIOR_DETACH, the expando is released **/
+  inline void kill( node* el )
+  {
+    while( !el->kids.empty() ) kill(el->kids.back());
+    std::vector<node::handler> hs; hs.swap(el->handlers);
+    for( size_t i = hs.size(); i > 0; --i )
+    {
+      INITIALIZATION_PARAMS ip; ip.cmd = BEHAVIOR_DETACH;
+      hs[i - 1].proc(hs[i - 1].tag, el, HANDLE_INITIALIZATION, &ip);
+    }
+    if( el->expando && el->expando->finalizer ) el->expando->finalizer(el->expando, el);
+    el->expando = 0;
+    if( el->parent )
+    {
+      std::vector<node*>& ks = el->parent->kids;
+      ks.erase(ks.begin() + el->index());
+      el->parent = 0;
+    }
+    el->timers.clear();
+    el->dead = true;
+  }
+
+  /** fires the engine timer of the element **/
+  inline BOOL fire_timer( node* el, UINT_PTR id )
+  {
+    TIMER_PARAMS tp; tp.timerId = id;
+    return send(el, HANDLE_TIMER, &tp);
+  }
+}
+
+#define FAKE_CHECK(he) if( !(he) || fake::n(he)->dead ) return HLDOM_INVALID_HANDLE
+
+EXTERN_C HLDOM_RESULT HLAPI HTMLayout_UseElement( HELEMENT he )   { if( !he ) return HLDOM_INVALID_HANDLE; ++fake::n(he)->uses; return HLDOM_OK; }
+EXTERN_C HLDOM_RESULT HLAPI HTMLayout_UnuseElement( HELEMENT he ) { if( !he ) return HLDOM_INVALID_HANDLE; --fake::n(he)->uses; return HLDOM_OK; }
+
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetParentElement( HELEMENT he, HELEMENT* p_parent_he )
+{
+  FAKE_CHECK(he);
+  *p_parent_he = fake::n(he)->parent;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetChildrenCount( HELEMENT he, UINT* count )
+{
+  FAKE_CHECK(he);
+  *count = UINT(fake::n(he)->kids.size());
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetNthChild( HELEMENT he, UINT n, HELEMENT* phe )
+{
+  FAKE_CHECK(he);
+  *phe = n < fake::n(he)->kids.size()? fake::n(he)->kids[n]: 0;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetElementIndex( HELEMENT he, LPUINT p_index )
+{
+  FAKE_CHECK(he);
+  *p_index = fake::n(he)->index();
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetElementType( HELEMENT he, LPCSTR* p_type )
+{
+  FAKE_CHECK(he);
+  *p_type = fake::n(he)->tag.c_str();
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetElementHwnd( HELEMENT he, HWND* p_hwnd, BOOL )
+{
+  FAKE_CHECK(he);
+  *p_hwnd = fake::n(he)->hwnd;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutIsElementVisible( HELEMENT he, BOOL* pVisible )
+{
+  FAKE_CHECK(he);
+  *pVisible = fake::n(he)->visible;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutInsertElement( HELEMENT he, HELEMENT hparent, UINT index )
+{
+  FAKE_CHECK(he); FAKE_CHECK(hparent);
+  fake::node* el = fake::n(he); fake::node* p = fake::n(hparent);
+  if( el->parent ) { std::vector<fake::node*>& ks = el->parent->kids; ks.erase(ks.begin() + el->index()); }
+  if( index > p->kids.size() ) index = UINT(p->kids.size());
+  p->kids.insert(p->kids.begin() + index, el);
+  el->parent = p; el->hwnd = p->hwnd;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSwapElements( HELEMENT he1, HELEMENT he2 )
+{
+  FAKE_CHECK(he1); FAKE_CHECK(he2);
+  fake::node* a = fake::n(he1); fake::node* b = fake::n(he2);
+  fake::node* pa = a->parent; fake::node* pb = b->parent;
+  UINT ia = a->index(), ib = b->index();
+  pa->kids[ia] = b; pb->kids[ib] = a;
+  a->parent = pb; b->parent = pa;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutUpdateElementEx( HELEMENT he, UINT flags )
+{
+  FAKE_CHECK(he);
+  fake::update_call c = { he, flags };
+  fake::updates().push_back(c);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutUpdateElement( HELEMENT he, BOOL remeasure )
+{
+  return HTMLayoutUpdateElementEx(he, remeasure? RESET_STYLE_DEEP | MEASURE_DEEP: RESET_STYLE_DEEP);
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutPostEvent( HELEMENT he, UINT appEventCode, HELEMENT heSource, UINT reason )
+{
+  FAKE_CHECK(he);
+  fake::posted_event e = { he, appEventCode, heSource, reason };
+  fake::posted().push_back(e);
+  return HLDOM_OK;
+}
+
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetAttributeByName( HELEMENT he, LPCSTR name, LPCWSTR* p_value )
+{
+  FAKE_CHECK(he);
+  std::map<std::string,std::wstring>::const_iterator it = fake::n(he)->attributes.find(name);
+  *p_value = it == fake::n(he)->attributes.end()? 0: it->second.c_str();
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetAttributeByName( HELEMENT he, LPCSTR name, LPCWSTR value )
+{
+  FAKE_CHECK(he);
+  if( value ) fake::n(he)->attributes[name] = value; else fake::n(he)->attributes.erase(name);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetStyleAttribute( HELEMENT he, LPCSTR name, LPCWSTR* p_value )
+{
+  FAKE_CHECK(he);
+  std::map<std::string,std::wstring>::const_iterator it = fake::n(he)->styles.find(name);
+  *p_value = it == fake::n(he)->styles.end()? 0: it->second.c_str();
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetStyleAttribute( HELEMENT he, LPCSTR name, LPCWSTR value )
+{
+  FAKE_CHECK(he);
+  if( value ) fake::n(he)->styles[name] = value; else fake::n(he)->styles.erase(name);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetElementInnerText16( HELEMENT he, LPWSTR* utf16words )
+{
+  FAKE_CHECK(he);
+  *utf16words = const_cast<LPWSTR>(fake::n(he)->text.c_str());
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetElementInnerText16( HELEMENT he, LPCWSTR utf16words, UINT length )
+{
+  FAKE_CHECK(he);
+  fake::n(he)->text.assign(utf16words, length);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetElementHtml( HELEMENT he, LPCBYTE html, DWORD htmlLength, UINT where )
+{
+  FAKE_CHECK(he);
+  std::string& h = fake::n(he)->html;
+  if( where == SIH_REPLACE_CONTENT ) h.clear();
+  h.append((const char*)html, htmlLength);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutGetElementState( HELEMENT he, UINT* pstateBits )
+{
+  FAKE_CHECK(he);
+  *pstateBits = fake::n(he)->state;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetElementState( HELEMENT he, UINT stateBitsToSet, UINT stateBitsToClear, BOOL updateView )
+{
+  FAKE_CHECK(he);
+  fake::n(he)->state = (fake::n(he)->state & ~stateBitsToClear) | stateBitsToSet;
+  if( updateView ) HTMLayoutUpdateElementEx(he, RESET_STYLE_DEEP);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutElementSetExpando( HELEMENT he, HTMLayoutElementExpando* pExpando )
+{
+  FAKE_CHECK(he);
+  fake::n(he)->expando = pExpando;
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutElementGetExpando( HELEMENT he, HTMLayoutElementExpando** ppExpando )
+{
+  FAKE_CHECK(he);
+  *ppExpando = fake::n(he)->expando;
+  return HLDOM_OK;
+}
+
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutAttachEventHandlerEx( HELEMENT he, LPELEMENT_EVENT_PROC pep, LPVOID tag, UINT subscription )
+{
+  FAKE_CHECK(he);
+  fake::node::handler h = { pep, tag, subscription };
+  fake::n(he)->handlers.push_back(h);
+  INITIALIZATION_PARAMS ip; ip.cmd = BEHAVIOR_ATTACH;
+  pep(tag, he, HANDLE_INITIALIZATION, &ip);
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutAttachEventHandler( HELEMENT he, LPELEMENT_EVENT_PROC pep, LPVOID tag )
+{
+  return HTMLayoutAttachEventHandlerEx(he, pep, tag, HANDLE_ALL);
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutDetachEventHandler( HELEMENT he, LPELEMENT_EVENT_PROC pep, LPVOID tag )
+{
+  FAKE_CHECK(he);
+  std::vector<fake::node::handler>& hs = fake::n(he)->handlers;
+  for( size_t i = 0; i < hs.size(); ++i )
+    if( hs[i].proc == pep && hs[i].tag == tag )
+    {
+      hs.erase(hs.begin() + i);
+      INITIALIZATION_PARAMS ip; ip.cmd = BEHAVIOR_DETACH;
+      pep(tag, he, HANDLE_INITIALIZATION, &ip);
+      return HLDOM_OK;
+    }
+  return HLDOM_OK;
+}
+
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetTimerEx( HELEMENT he, UINT milliseconds, UINT_PTR timerId )
+{
+  FAKE_CHECK(he);
+  std::vector<fake::node::timer>& ts = fake::n(he)->timers;
+  for( size_t i = 0; i < ts.size(); ++i )
+    if( ts[i].id == timerId ) { ts.erase(ts.begin() + i); break; }
+  if( milliseconds )
+  {
+    fake::node::timer t = { timerId, milliseconds };
+    ts.push_back(t);
+  }
+  return HLDOM_OK;
+}
+EXTERN_C HLDOM_RESULT HLAPI HTMLayoutSetTimer( HELEMENT he, UINT milliseconds )
+{
+  return HTMLayoutSetTimerEx(he, milliseconds, 0);
+}
+
+// values hold no heap data here
+EXTERN_C UINT VALAPI ValueInit( VALUE* pval )  { memset(pval, 0, sizeof(VALUE)); return HV_OK; }
+EXTERN_C UINT VALAPI ValueClear( VALUE* pval ) { ++fake::value_clears(); memset(pval, 0, sizeof(VALUE)); return HV_OK; }
+
+#endif
@@ -0,0 +1,316 @@
+#ifndef __mock_windows_h__
+#define __mock_windows_h__
+
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Win32 stand-in for building the tests on Linux (pthreads).
+ * Only what the headers under test use: types, Interlocked*, critical sections,
+ * threads, semaphores, fiber local storage, message posting and window properties.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <time.h>
+#include <strings.h>
+#include <stdarg.h>
+
+typedef unsigned long DWORD; typedef long LONG; typedef unsigned long ULONG;
+typedef int INT; typedef unsigned int UINT; typedef int BOOL; typedef unsigned char BYTE;
+typedef unsigned short WORD; typedef wchar_t WCHAR; typedef char CHAR;
+typedef long long LONGLONG; typedef unsigned long long ULONGLONG;
+typedef int64_t INT64; typedef uint64_t UINT64; typedef intptr_t INT_PTR; typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR; typedef uintptr_t ULONG_PTR; typedef ULONG_PTR DWORD_PTR; typedef size_t SIZE_T;
+typedef void* PVOID; typedef void* LPVOID; typedef const void* LPCVOID; typedef void* HANDLE;
+typedef char* LPSTR; typedef const char* LPCSTR; typedef wchar_t* LPWSTR; typedef const wchar_t* LPCWSTR;
+typedef BYTE* LPBYTE; typedef UINT* LPUINT; typedef DWORD* LPDWORD;
+typedef UINT_PTR WPARAM; typedef LONG_PTR LPARAM; typedef LONG_PTR LRESULT;
+struct HWND__; typedef HWND__* HWND; struct HDC__; typedef HDC__* HDC;
+struct HINSTANCE__; typedef HINSTANCE__* HINSTANCE; typedef HINSTANCE HMODULE;
+struct HBITMAP__; typedef HBITMAP__* HBITMAP; struct HCURSOR__; typedef HCURSOR__* HCURSOR;
+struct POINT { LONG x, y; }; typedef POINT* LPPOINT;
+struct SIZE { LONG cx, cy; }; typedef SIZE* LPSIZE;
+struct RECT { LONG left, top, right, bottom; }; typedef RECT* LPRECT; typedef const RECT* LPCRECT;
+struct MSG { HWND hwnd; UINT message; WPARAM wParam; LPARAM lParam; DWORD time; POINT pt; };
+union LARGE_INTEGER { LONGLONG QuadPart; };
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define CALLBACK
+#define __stdcall
+#define __cdecl
+#define __declspec(x)
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define WM_NULL 0x0000
+#define WM_DESTROY 0x0002
+#define WM_TIMER 0x0113
+#define MEMORY_ALLOCATION_ALIGNMENT 16
+#ifdef __cplusplus
+#define EXTERN_C extern "C"
+#else
+#define EXTERN_C extern
+#endif
+#define _stricmp strcasecmp
+#define wcsicmp wcscasecmp
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define CP_THREAD_ACP 3
+inline int WideCharToMultiByte(UINT, DWORD, LPCWSTR ws, int wn, LPSTR s, int n, LPCSTR, BOOL*)
+{
+  if( wn < 0 ) wn = int(wcslen(ws)) + 1;
+  if( !n ) return wn;
+  int i = 0; for( ; i < wn && i < n; ++i ) s[i] = char(ws[i]); return i;
+}
+inline int MultiByteToWideChar(UINT, DWORD, LPCSTR s, int sn, LPWSTR ws, int n)
+{
+  if( sn < 0 ) sn = int(strlen(s)) + 1;
+  if( !n ) return sn;
+  int i = 0; for( ; i < sn && i < n; ++i ) ws[i] = WCHAR((unsigned char)s[i]); return i;
+}
+#define _itoa(v,b,r) (sprintf(b,"%d",int(v)),b)
+#define _itow(v,b,r) (swprintf(b,16,L"%d",int(v)),b)
+#define _snprintf snprintf
+#define _snwprintf swprintf
+#define _vsnprintf vsnprintf
+#define _vsnwprintf vswprintf
+#define _wtoi(s) int(wcstol(s, 0, 10))
+#define FAR
+#define NEAR
+#define VOID void
+typedef BOOL* LPBOOL;
+struct NMHDR { HWND hwndFrom; UINT_PTR idFrom; UINT code; }; typedef NMHDR* LPNMHDR;
+
+// synchronization
+struct CRITICAL_SECTION { pthread_mutex_t m; };
+inline void InitializeCriticalSection(CRITICAL_SECTION* c) { pthread_mutexattr_t a; pthread_mutexattr_init(&a); pthread_mutexattr_settype(&a, PTHREAD_MUTEX_RECURSIVE); pthread_mutex_init(&c->m, &a); pthread_mutexattr_destroy(&a); }
+inline void DeleteCriticalSection(CRITICAL_SECTION* c) { pthread_mutex_destroy(&c->m); }
+inline void EnterCriticalSection(CRITICAL_SECTION* c) { pthread_mutex_lock(&c->m); }
+inline void LeaveCriticalSection(CRITICAL_SECTION* c) { pthread_mutex_unlock(&c->m); }
+
+inline LONG InterlockedIncrement(volatile LONG* p) { return __atomic_add_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedDecrement(volatile LONG* p) { return __atomic_sub_fetch(p, 1, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchange(volatile LONG* p, LONG v) { return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedExchangeAdd(volatile LONG* p, LONG v) { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+inline LONG InterlockedCompareExchange(volatile LONG* p, LONG v, LONG c) { __atomic_compare_exchange_n(p, &c, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return c; }
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG* p, LONGLONG v) { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+inline PVOID InterlockedExchangePointer(PVOID volatile* p, PVOID v) { return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST); }
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile* p, PVOID v, PVOID c) { __atomic_compare_exchange_n(p, &c, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); return c; }
+inline void MemoryBarrier() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+inline void YieldProcessor() {}
+inline void Sleep(DWORD ms) { usleep(ms * 1000); }
+inline BOOL SwitchToThread() { sched_yield(); return TRUE; }
+
+// time
+inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* f) { f->QuadPart = 1000000000; return TRUE; }
+inline BOOL QueryPerformanceCounter(LARGE_INTEGER* c) { timespec t; clock_gettime(CLOCK_MONOTONIC, &t); c->QuadPart = t.tv_sec * 1000000000LL + t.tv_nsec; return TRUE; }
+// tests drive GetTickCount() by mock_clock::advance() once they called mock_clock::manual()
+struct mock_clock
+{
+  static bool& is_manual() { static bool m = false; return m; }
+  static DWORD& ms() { static DWORD t = 1000; return t; }
+  static void manual() { is_manual() = true; }
+  static void advance(DWORD d) { ms() += d; }
+};
+inline DWORD GetTickCount()
+{
+  if( mock_clock::is_manual() ) return mock_clock::ms();
+  timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return DWORD(t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+
+// threads
+inline DWORD GetCurrentThreadId() { static volatile LONG n = 0; static thread_local DWORD id = DWORD(InterlockedIncrement(&n)); return id; }
+struct SYSTEM_INFO { DWORD dwNumberOfProcessors; };
+inline void GetSystemInfo(SYSTEM_INFO* si) { si->dwNumberOfProcessors = DWORD(sysconf(_SC_NPROCESSORS_ONLN)); }
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID);
+
+// HANDLE is a kernel object: a thread or a semaphore
+struct mock_kernel_object
+{
+  enum { THREAD, SEMAPHORE } kind;
+  pthread_t thread; LPTHREAD_START_ROUTINE start; LPVOID param;
+  sem_t sem;
+  static void* thread_entry(void* p) { mock_kernel_object* o = (mock_kernel_object*)p; o->start(o->param); return 0; }
+};
+inline HANDLE CreateThread(void*, SIZE_T, LPTHREAD_START_ROUTINE start, LPVOID param, DWORD, DWORD*)
+{
+  mock_kernel_object* o = new mock_kernel_object(); o->kind = mock_kernel_object::THREAD; o->start = start; o->param = param;
+  pthread_create(&o->thread, 0, &mock_kernel_object::thread_entry, o);
+  return o;
+}
+inline HANDLE CreateSemaphore(void*, LONG initial, LONG, LPCWSTR)
+{
+  mock_kernel_object* o = new mock_kernel_object(); o->kind = mock_kernel_object::SEMAPHORE; sem_init(&o->sem, 0, unsigned(initial));
+  return o;
+}
+inline BOOL ReleaseSemaphore(HANDLE h, LONG n, LONG*) { while( n-- > 0 ) sem_post(&((mock_kernel_object*)h)->sem); return TRUE; }
+#define WAIT_OBJECT_0 0
+inline DWORD WaitForSingleObject(HANDLE h, DWORD)
+{
+  mock_kernel_object* o = (mock_kernel_object*)h;
+  if( o->kind == mock_kernel_object::THREAD ) pthread_join(o->thread, 0); else sem_wait(&o->sem);
+  return WAIT_OBJECT_0;
+}
+inline DWORD WaitForMultipleObjects(DWORD n, const HANDLE* h, BOOL, DWORD ms) { for( DWORD i = 0; i < n; ++i ) WaitForSingleObject(h[i], ms); return WAIT_OBJECT_0; }
+inline BOOL CloseHandle(HANDLE h)
+{
+  mock_kernel_object* o = (mock_kernel_object*)h;
+  if( o->kind == mock_kernel_object::SEMAPHORE ) sem_destroy(&o->sem);
+  delete o; return TRUE;
+}
+
+// fiber local storage, callbacks run when a thread ends
+#define TLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+#define FLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+typedef VOID (WINAPI *PFLS_CALLBACK_FUNCTION)(PVOID);
+struct mock_fls
+{
+  enum { SLOTS = 64 };
+  static PFLS_CALLBACK_FUNCTION* callbacks() { static PFLS_CALLBACK_FUNCTION cb[SLOTS]; return cb; }
+  static bool* used() { static bool u[SLOTS]; return u; }
+  struct values { PVOID v[SLOTS]; ~values() { for( int i = 0; i < SLOTS; ++i ) if( v[i] && callbacks()[i] ) { PVOID p = v[i]; v[i] = 0; callbacks()[i](p); } } };
+  static values& current() { static thread_local values vs; return vs; }
+};
+inline DWORD FlsAlloc(PFLS_CALLBACK_FUNCTION cb)
+{
+  for( DWORD i = 0; i < mock_fls::SLOTS; ++i )
+    if( !mock_fls::used()[i] ) { mock_fls::used()[i] = true; mock_fls::callbacks()[i] = cb; return i; }
+  return FLS_OUT_OF_INDEXES;
+}
+inline PVOID FlsGetValue(DWORD i) { return mock_fls::current().v[i]; }
+inline BOOL FlsSetValue(DWORD i, PVOID v) { mock_fls::current().v[i] = v; return TRUE; }
+inline BOOL FlsFree(DWORD i)
+{
+  // Windows runs the callback for every thread, the mock only for the calling one
+  PVOID p = mock_fls::current().v[i]; mock_fls::current().v[i] = 0;
+  if( p && mock_fls::callbacks()[i] ) mock_fls::callbacks()[i](p);
+  mock_fls::callbacks()[i] = 0; mock_fls::used()[i] = false; return TRUE;
+}
+inline DWORD TlsAlloc() { return FlsAlloc(0); }
+inline PVOID TlsGetValue(DWORD i) { return FlsGetValue(i); }
+inline BOOL TlsSetValue(DWORD i, PVOID v) { return FlsSetValue(i, v); }
+inline BOOL TlsFree(DWORD i) { return FlsFree(i); }
+
+// messages: one process-wide queue, PeekMessage() returns messages posted to any window or thread
+#define PM_NOREMOVE 0x0000
+#define PM_REMOVE 0x0001
+#define WM_USER 0x0400
+#define WM_APP 0x8000
+struct mock_message_queue
+{
+  pthread_mutex_t m; MSG* msgs; size_t n, cap;
+  static mock_message_queue& get() { static mock_message_queue q = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0 }; return q; }
+  BOOL post(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
+  {
+    pthread_mutex_lock(&m);
+    if( n == cap ) { cap = cap? cap * 2: 64; msgs = (MSG*)realloc(msgs, cap * sizeof(MSG)); }
+    MSG msg = { hwnd, message, wp, lp, GetTickCount(), { 0, 0 } }; msgs[n++] = msg;
+    pthread_mutex_unlock(&m);
+    return TRUE;
+  }
+  BOOL peek(MSG* pmsg, UINT remove)
+  {
+    pthread_mutex_lock(&m);
+    BOOL r = n != 0;
+    if( r ) { *pmsg = msgs[0]; if( remove & PM_REMOVE ) memmove(msgs, msgs + 1, --n * sizeof(MSG)); }
+    pthread_mutex_unlock(&m);
+    return r;
+  }
+};
+inline BOOL PostMessage(HWND hwnd, UINT message, WPARAM wp, LPARAM lp) { return mock_message_queue::get().post(hwnd, message, wp, lp); }
+inline BOOL PostThreadMessage(DWORD, UINT message, WPARAM wp, LPARAM lp) { return mock_message_queue::get().post(0, message, wp, lp); }
+inline BOOL PeekMessage(MSG* pmsg, HWND, UINT, UINT, UINT remove) { return mock_message_queue::get().peek(pmsg, remove); }
+#define PostMessageW PostMessage
+#define PostThreadMessageW PostThreadMessage
+#define PeekMessageW PeekMessage
+
+// window properties
+struct mock_window_props
+{
+  enum { MAX = 1024 };
+  struct prop { HWND hwnd; char name[64]; HANDLE data; };
+  pthread_mutex_t m; prop props[MAX]; int n;
+  static mock_window_props& get() { static mock_window_props p = { PTHREAD_MUTEX_INITIALIZER }; return p; }
+  int find(HWND hwnd, LPCSTR name) { for( int i = 0; i < n; ++i ) if( props[i].hwnd == hwnd && !strcmp(props[i].name, name) ) return i; return -1; }
+};
+inline BOOL SetPropA(HWND hwnd, LPCSTR name, HANDLE data)
+{
+  mock_window_props& p = mock_window_props::get(); pthread_mutex_lock(&p.m);
+  int i = p.find(hwnd, name);
+  if( i < 0 && p.n < mock_window_props::MAX ) { i = p.n++; p.props[i].hwnd = hwnd; strncpy(p.props[i].name, name, 63); p.props[i].name[63] = 0; }
+  if( i >= 0 ) p.props[i].data = data;
+  pthread_mutex_unlock(&p.m); return i >= 0;
+}
+inline HANDLE GetPropA(HWND hwnd, LPCSTR name)
+{
+  mock_window_props& p = mock_window_props::get(); pthread_mutex_lock(&p.m);
+  int i = p.find(hwnd, name); HANDLE r = i < 0? 0: p.props[i].data;
+  pthread_mutex_unlock(&p.m); return r;
+}
+inline HANDLE RemovePropA(HWND hwnd, LPCSTR name)
+{
+  mock_window_props& p = mock_window_props::get(); pthread_mutex_lock(&p.m);
+  int i = p.find(hwnd, name); HANDLE r = 0;
+  if( i >= 0 ) { r = p.props[i].data; p.props[i] = p.props[--p.n]; }
+  pthread_mutex_unlock(&p.m); return r;
+}
+
+// window timers, fired by tests with mock_window_timers::fire()
+typedef VOID (CALLBACK *TIMERPROC)(HWND, UINT, UINT_PTR, DWORD);
+struct mock_window_timers
+{
+  enum { MAX = 64 };
+  struct timer { HWND hwnd; UINT_PTR id; UINT ms; TIMERPROC proc; };
+  timer timers[MAX]; int n;
+  static mock_window_timers& get() { static mock_window_timers t = {}; return t; }
+  int find(HWND hwnd, UINT_PTR id) { for( int i = 0; i < n; ++i ) if( timers[i].hwnd == hwnd && timers[i].id == id ) return i; return -1; }
+  // calls procs of the timers of the window once, as if their periods elapsed
+  static int fire(HWND hwnd)
+  {
+    mock_window_timers& t = get(); int fired = 0;
+    timer copy[MAX]; int cn = t.n; memcpy(copy, t.timers, sizeof(timer) * cn);
+    for( int i = 0; i < cn; ++i )
+      if( copy[i].hwnd == hwnd && t.find(hwnd, copy[i].id) >= 0 ) { copy[i].proc(hwnd, WM_TIMER, copy[i].id, GetTickCount()); ++fired; }
+    return fired;
+  }
+  // period of the timer, 0 - not set
+  static UINT period(HWND hwnd, UINT_PTR id) { mock_window_timers& t = get(); int i = t.find(hwnd, id); return i < 0? 0: t.timers[i].ms; }
+};
+inline UINT_PTR SetTimer(HWND hwnd, UINT_PTR id, UINT ms, TIMERPROC proc)
+{
+  mock_window_timers& t = mock_window_timers::get();
+  int i = t.find(hwnd, id);
+  if( i < 0 ) { if( t.n == mock_window_timers::MAX ) return 0; i = t.n++; }
+  mock_window_timers::timer tm = { hwnd, id, ms, proc }; t.timers[i] = tm;
+  return id;
+}
+inline BOOL KillTimer(HWND hwnd, UINT_PTR id)
+{
+  mock_window_timers& t = mock_window_timers::get();
+  int i = t.find(hwnd, id);
+  if( i < 0 ) return FALSE;
+  t.timers[i] = t.timers[--t.n];
+  return TRUE;
+}
+
+// input
+inline BOOL ReleaseCapture() { return TRUE; }
+inline BOOL PtInRect(const RECT* rc, POINT pt) { return pt.x >= rc->left && pt.x < rc->right && pt.y >= rc->top && pt.y < rc->bottom; }
+
+
+// windows.h defines min and max as macros, libstdc++ does not survive them
+template<typename T> inline T min(T a, T b) { return a < b? a: b; }
+template<typename T> inline T max(T a, T b) { return a > b? a: b; }
+
+#endif
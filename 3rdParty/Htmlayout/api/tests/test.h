@@ -0,0 +1,49 @@
+#ifndef __test_h__
+#define __test_h__
+
+/*
+ * Terra Informatica Lightweight Embeddable HTMLayout control
+ * http://terrainformatica.com/htmlayout
+ *
+ * Minimal harness of the tests: include order, checks and timing.
+ *
+ * The tests are built on Linux against tests/mock/windows.h, e.g.
+ *   g++ -std=c++20 -O2 -DLIBRARY_BUILD -Itests/mock -I. tests/test_batch.cpp -lpthread
+ * LIBRARY_BUILD keeps htmlayout.h to the plain API, the C++ wrappers are included here.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#include "htmlayout.h"
+#include "htmlayout_behavior.hpp"
+#include "htmlayout_dom.hpp"
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+  do { if( !(cond) ) { ++test_failures; printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while(0)
+
+#define CHECK_EQ(a, b) \
+  do { long long va_ = (long long)(a), vb_ = (long long)(b); \
+       if( va_ != vb_ ) { ++test_failures; printf("%s(%d): CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, va_, vb_); } } while(0)
+
+/** milliseconds since t0 = now_ms() **/
+inline double now_ms()
+{
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+  return double(c.QuadPart) * 1000.0 / double(f.QuadPart);
+}
+
+inline int test_result( const char* name )
+{
+  if( test_failures ) printf("%s: %d check(s) FAILED\n", name, test_failures);
+  else printf("%s: OK\n", name);
+  return test_failures? 1: 0;
+}
+
+#endif
@@ -0,0 +1,89 @@
+// dom::batch: every mutation applied, one engine update per top-most dirty subtree.
+
+#include "test.h"
+#include "htmlayout_batch.hpp"
+#include "fake_engine.h"
+
+using namespace htmlayout;
+
+static fake::node* grid( fake::node* parent, int rows, int cols )
+{
+  fake::node* table = new fake::node("table", parent);
+  for( int r = 0; r < rows; ++r )
+  {
+    fake::node* row = new fake::node("tr", table);
+    for( int c = 0; c < cols; ++c ) new fake::node("td", row);
+  }
+  return table;
+}
+
+int main()
+{
+  fake::node* html = new fake::node("html");
+  fake::node* body = new fake::node("body", html);
+  fake::node* header = new fake::node("div", body);
+  fake::node* head_cell = new fake::node("span", header);
+  fake::node* table = grid(body, 20, 4);
+  fake::node* footer = new fake::node("div", body);
+  fake::node* footer_link = new fake::node("a", footer);
+
+  // text only: the engine updates on set_text itself
+  fake::updates().clear();
+  {
+    dom::batch b;
+    for( int r = 0; r < 20; ++r )
+      for( int c = 0; c < 4; ++c )
+        b.set_text(table->kids[r]->kids[c], L"cell");
+  }
+  CHECK_EQ(fake::updates().size(), 0);
+  CHECK(table->kids[19]->kids[3]->text == L"cell");
+
+  // attributes of unrelated elements are not folded into <body>
+  fake::updates().clear();
+  {
+    dom::batch b;
+    b.set_attribute(head_cell, "title", L"head");
+    b.set_attribute(footer_link, "href", L"#top");
+  }
+  CHECK_EQ(fake::updates().size(), 2);
+  for( size_t n = 0; n < fake::updates().size(); ++n )
+    CHECK(fake::updates()[n].he == head_cell || fake::updates()[n].he == footer_link);
+  CHECK(footer_link->attributes["href"] == L"#top");
+
+  // states of rows, each row once even if touched twice
+  fake::updates().clear();
+  {
+    dom::batch b;
+    for( int r = 0; r < 20; ++r ) b.set_state(table->kids[r], STATE_CHECKED);
+    for( int r = 0; r < 20; ++r ) b.set_attribute(table->kids[r], "index", L"1");
+    CHECK_EQ(b.size(), 40);
+  }
+  CHECK_EQ(fake::updates().size(), 20);
+  CHECK_EQ(table->kids[7]->state, STATE_CHECKED);
+
+  // rows of the dirty table fold into the table
+  fake::updates().clear();
+  {
+    dom::batch b;
+    b.set_attribute(table, "class", L"busy");
+    for( int r = 0; r < 20; ++r ) b.set_state(table->kids[r], 0, STATE_CHECKED);
+    b.apply();
+    CHECK_EQ(b.saved_calls(), 20);
+    CHECK_EQ(b.issued_calls(), 1);
+  }
+  CHECK_EQ(fake::updates().size(), 1);
+  CHECK(fake::updates().size() == 1 && fake::updates()[0].he == (HELEMENT)table);
+
+  // inserts update the new and the old parent
+  fake::updates().clear();
+  {
+    dom::batch b;
+    fake::node* row = table->kids[0];
+    b.append(footer, row);
+  }
+  CHECK_EQ(table->kids.size(), 19);
+  CHECK_EQ(footer->kids.size(), 2);
+  CHECK_EQ(fake::updates().size(), 2);
+
+  return test_result("test_batch");
+}
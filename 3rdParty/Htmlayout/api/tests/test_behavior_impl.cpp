@@ -0,0 +1,96 @@
+// behavior_impl<Derived>: subscription mask of defined handlers, events delivered and handled.
+
+#include "test.h"
+#include "fake_engine.h"
+
+using namespace htmlayout;
+
+struct clicks_impl: public behavior_impl<clicks_impl>
+{
+  int mouse, detaches;
+  clicks_impl(): mouse(0), detaches(0) {}
+  virtual BOOL on_mouse( HELEMENT, HELEMENT, UINT, POINT, UINT, UINT ) { ++mouse; return FALSE; }
+  virtual void detached( HELEMENT ) { ++detaches; }
+};
+
+struct ticks_impl: public behavior_impl<ticks_impl>
+{
+  int ticks;
+  ticks_impl(): ticks(0) {}
+  virtual BOOL on_timer( HELEMENT, UINT_PTR ) { ++ticks; return TRUE; }
+};
+
+// the same handler the legacy way: subscribed to everything, dispatched by virtual calls
+struct clicks_legacy: public event_handler
+{
+  int mouse;
+  clicks_legacy(): event_handler(HANDLE_ALL), mouse(0) {}
+  virtual BOOL on_mouse( HELEMENT, HELEMENT, UINT, POINT, UINT, UINT ) { ++mouse; return FALSE; }
+};
+
+// one event of each group a plain element gets
+static void events( fake::node* el, int rounds )
+{
+  for( int n = 0; n < rounds; ++n )
+  {
+    MOUSE_PARAMS mp = {}; mp.cmd = MOUSE_MOVE; mp.target = el;
+    KEY_PARAMS kp = {}; kp.cmd = KEY_DOWN; kp.target = el;
+    FOCUS_PARAMS fp = {}; fp.cmd = FOCUS_GOT; fp.target = el;
+    BEHAVIOR_EVENT_PARAMS bp = {}; bp.cmd = BUTTON_CLICK; bp.heTarget = el;
+    DRAW_PARAMS dp = {}; dp.cmd = DRAW_CONTENT;
+    fake::send(el, HANDLE_MOUSE, &mp);
+    fake::send(el, HANDLE_KEY, &kp);
+    fake::send(el, HANDLE_FOCUS, &fp);
+    fake::send(el, HANDLE_BEHAVIOR_EVENT, &bp);
+    fake::send(el, HANDLE_DRAW, &dp);
+    fake::send(el, HANDLE_SIZE, 0);
+  }
+}
+
+int main()
+{
+  CHECK_EQ(clicks_impl::subscriptions(), HANDLE_MOUSE);
+  CHECK_EQ(ticks_impl::subscriptions(), HANDLE_TIMER);
+
+  const int rounds = 1000;
+
+  // only mouse events reach the proc of behavior_impl
+  {
+    fake::node el("div");
+    clicks_impl h;
+    attach_event_handler(&el, &h, h.subscribed_to);
+    fake::deliveries() = 0;
+    events(&el, rounds);
+    CHECK_EQ(h.mouse, rounds);
+    CHECK_EQ(fake::deliveries(), rounds);
+    detach_event_handler(&el, &h);
+    CHECK_EQ(h.detaches, 1);
+  }
+
+  // the legacy handler handles as many, but gets all of them
+  {
+    fake::node el("div");
+    clicks_legacy h;
+    attach_event_handler(&el, &h, h.subscribed_to);
+    fake::deliveries() = 0;
+    events(&el, rounds);
+    CHECK_EQ(h.mouse, rounds);
+    CHECK_EQ(fake::deliveries(), rounds * 6);
+    detach_event_handler(&el, &h);
+  }
+
+  // on_timer(he, id) is found through the overload and called with the id
+  {
+    fake::node el("div");
+    ticks_impl h;
+    attach_event_handler(&el, &h, h.subscribed_to);
+    fake::deliveries() = 0;
+    events(&el, rounds);
+    CHECK_EQ(fake::deliveries(), 0);
+    CHECK(fake::fire_timer(&el, 7));
+    CHECK_EQ(h.ticks, 1);
+    detach_event_handler(&el, &h);
+  }
+
+  return test_result("test_behavior_impl");
+}
@@ -0,0 +1,83 @@
+// coalesced_input: bursts of moves delivered once per tick, deferred targets that leave the DOM.
+
+#include "test.h"
+#include "htmlayout_coalesce.hpp"
+#include "fake_engine.h"
+
+using namespace htmlayout;
+
+struct mover: public coalesced_input<event_handler>
+{
+  int       moves;
+  HELEMENT  last_target;
+  POINT     last_delta;
+  mover(): coalesced_input<event_handler>(HANDLE_MOUSE), moves(0), last_target(0) {}
+  virtual BOOL on_mouse( HELEMENT, HELEMENT target, UINT, POINT, UINT, UINT )
+  {
+    ++moves; last_target = target; last_delta = coalesced_delta();
+    return TRUE;
+  }
+};
+
+static BOOL move( fake::node* el, fake::node* target, int x, fake::node* dragging = 0 )
+{
+  MOUSE_PARAMS mp = {};
+  mp.cmd = dragging? MOUSE_MOVE | DRAGGING: MOUSE_MOVE;
+  mp.target = target; mp.pos.x = x; mp.dragging = dragging;
+  return fake::send(el, HANDLE_MOUSE, &mp);
+}
+
+static BOOL tick( fake::node* el, mover& h ) { return fake::fire_timer(el, UINT_PTR(&h)); }
+
+int main()
+{
+  fake::node* body = new fake::node("body");
+  fake::node* list = new fake::node("ul", body);
+  fake::node* item = new fake::node("li", list);
+  fake::node* other = new fake::node("li", list);
+
+  mover h;
+  attach_event_handler(list, &h, h.subscribed_to);
+
+  // the leading move goes at once, the rest of the burst on the tick
+  CHECK(move(list, item, 1));
+  for( int x = 2; x <= 10; ++x ) CHECK(move(list, item, x));
+  CHECK_EQ(h.moves, 1);
+  CHECK(tick(list, h));
+  CHECK_EQ(h.moves, 2);
+  CHECK_EQ(h.last_delta.x, 9);
+  CHECK(h.last_target == (HELEMENT)item);
+  CHECK(!tick(list, h)); // nothing pending, the window closes
+  CHECK_EQ(item->uses, 0);
+
+  // the target is removed while its move waits: retargeted to the element
+  move(list, other, 1);
+  move(list, other, 5);
+  CHECK_EQ(other->uses, 1);
+  fake::kill(other);
+  tick(list, h);
+  CHECK_EQ(h.moves, 4);
+  CHECK(h.last_target == (HELEMENT)list);
+  CHECK_EQ(other->uses, 0);
+  tick(list, h);
+
+  // the dragged element is removed: the deferred move is dropped
+  fake::node* dragged = new fake::node("div", body);
+  move(list, item, 1, dragged);
+  move(list, item, 7, dragged);
+  fake::kill(dragged);
+  tick(list, h);
+  CHECK_EQ(h.moves, 5);
+  CHECK_EQ(dragged->uses, 0);
+  tick(list, h);
+
+  // detach with a move pending releases its references
+  move(list, item, 1);
+  move(list, item, 2);
+  CHECK_EQ(item->uses, 1);
+  detach_event_handler(list, &h);
+  CHECK_EQ(item->uses, 0);
+  CHECK_EQ(list->timers.size(), 0);
+
+  return test_result("test_coalesce");
+}
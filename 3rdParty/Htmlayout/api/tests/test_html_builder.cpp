@@ -0,0 +1,37 @@
+// dom::html_builder: escaping, templates and number formatting without a target.
+
+#include "test.h"
+#include "htmlayout_html_builder.hpp"
+#include "fake_engine.h"
+
+#include <float.h>
+#include <string>
+
+using namespace htmlayout;
+
+static std::string markup( dom::html_builder& b ) { return std::string((const char*)b.data(), b.length()); }
+
+int main()
+{
+  {
+    dom::html_builder b;
+    b.row_begin().cell(L"a<b").cell(42).cell(1.25, 2).row_end();
+    CHECK(markup(b) == "<tr><td>a&lt;b</td><td>42</td><td>1.25</td></tr>");
+    CHECK_EQ(b.rows(), 1);
+  }
+  {
+    dom::row_template tpl("<tr><td>{0}</td><td class=name>{1}</td><td>{2}</td></tr>");
+    dom::html_builder b;
+    b.row(tpl, 7, L"x&y", 0.5);
+    CHECK(markup(b) == "<tr><td>7</td><td class=name>x&amp;y</td><td>0.50</td></tr>");
+  }
+  {
+    // the widest double, fractional digits are clamped
+    dom::html_builder b;
+    b.cell(-DBL_MAX, 100);
+    std::string s = markup(b);
+    CHECK(s.compare(0, 6, "<td>-1") == 0);
+    CHECK(s.length() > 300 && s.length() < 360);
+  }
+  return test_result("test_html_builder");
+}
@@ -0,0 +1,70 @@
+// pooled<T>: 100k attach/detach of per-element handlers, pool vs heap, pools outlive other statics.
+
+#include "test.h"
+#include "htmlayout_pool.hpp"
+#include "fake_engine.h"
+
+using namespace htmlayout;
+
+template <class Base>
+  struct counter_handler: public event_handler, public Base
+  {
+    int clicks;
+    counter_handler(): event_handler(HANDLE_MOUSE), clicks(0) {}
+    virtual void detached( HELEMENT ) { delete this; }
+  };
+
+struct heap_base {};
+typedef counter_handler<heap_base> heap_handler;
+struct pooled_handler: public counter_handler< pooled<pooled_handler> > {};
+
+// attaches a handler to every row, then kills the rows: detached() deletes the handlers
+template <class H>
+  static double attach_detach( int rows )
+  {
+    fake::node* table = new fake::node("table");
+    for( int r = 0; r < rows; ++r ) new fake::node("tr", table);
+    std::vector<fake::node*> kids = table->kids;
+    double t0 = now_ms();
+    for( int r = 0; r < rows; ++r ) attach_event_handler(kids[r], new H());
+    for( int r = rows; r > 0; --r ) fake::kill(kids[r - 1]);
+    double t = now_ms() - t0;
+    for( int r = 0; r < rows; ++r ) delete kids[r];
+    delete table;
+    return t;
+  }
+
+// deletes its handler in the global destructor, after main() returned
+struct late_owner
+{
+  pooled_handler* p;
+  late_owner(): p(0) {}
+  ~late_owner() { delete p; }
+} late;
+
+int main()
+{
+  const int rows = 100000;
+
+  attach_detach<pooled_handler>(1000); // warm up both
+  attach_detach<heap_handler>(1000);
+
+  double tp = attach_detach<pooled_handler>(rows);
+  CHECK_EQ(pooled_handler::live(), 0);
+  LONG slabs = pooled_handler::pool().stats().slabs;
+  double th = attach_detach<heap_handler>(rows);
+  printf("%d attach/detach: pooled %.1f ms, heap %.1f ms, %ld slab(s) of %u byte blocks\n",
+    rows, tp, th, (long)slabs, (UINT)pooled_handler::pool().block_size());
+
+  // the blocks are reused: the second run takes no new slabs
+  attach_detach<pooled_handler>(rows);
+  CHECK_EQ(pooled_handler::pool().stats().slabs, slabs);
+  CHECK_EQ(pooled_handler::pool().stats().peak, rows);
+
+  // late_owner was constructed before the pool, so it is destroyed after main() returns;
+  // the pool is never destroyed and takes the block back
+  late.p = new pooled_handler();
+  CHECK_EQ(pooled_handler::live(), 1);
+
+  return test_result("test_pool");
+}
@@ -0,0 +1,88 @@
+// queue::post(callable): inline and boxed closures, post() vs new gui_task, task nodes outlive other statics.
+
+#include "test.h"
+#include "htmlayout_queue.h"
+#include "fake_engine.h"
+
+#include <vector>
+
+using namespace htmlayout;
+
+htmlayout::queue gui_queue;
+
+// drops the tasks left in gui_queue in the global destructor, after main() returned
+struct late_clear { ~late_clear() { gui_queue.clear(); } } late;
+
+static LONG sum = 0; // tasks run in the GUI thread only
+static volatile LONG finished = 0; // producers that are done
+
+struct add_task: public gui_task
+{
+  LONG n;
+  add_task( LONG v ): n(v) {}
+  virtual void exec() { sum += n; }
+};
+
+struct producer_args { UINT tasks; bool use_post; };
+
+static DWORD WINAPI producer( LPVOID p )
+{
+  producer_args* pa = (producer_args*)p;
+  for( UINT n = 0; n < pa->tasks; ++n )
+    if( pa->use_post ) gui_queue.post([]() { sum += 1; });
+    else gui_queue.push(new add_task(1));
+  task_node_pool().flush();
+  ::InterlockedIncrement(&finished);
+  return 0;
+}
+
+// tasks per second of producers that push while the GUI thread executes
+static double produce( UINT producers, UINT tasks, bool use_post )
+{
+  sum = 0; finished = 0;
+  producer_args pa = { tasks / producers, use_post };
+  std::vector<HANDLE> threads;
+  double t0 = now_ms();
+  for( UINT n = 0; n < producers; ++n ) threads.push_back(::CreateThread(0, 0, &producer, &pa, 0, 0));
+  while( finished < LONG(producers) )
+    gui_queue.execute();
+  gui_queue.execute();
+  double t = now_ms() - t0;
+  ::WaitForMultipleObjects(DWORD(threads.size()), &threads[0], TRUE, INFINITE);
+  for( UINT n = 0; n < producers; ++n ) ::CloseHandle(threads[n]);
+  CHECK_EQ(sum, pa.tasks * producers);
+  return double(pa.tasks * producers) / t * 1000.0;
+}
+
+int main()
+{
+  // order of posts, small closures inline, big ones boxed
+  {
+    std::vector<int> order;
+    char big[256] = { 7 };
+    for( int n = 0; n < 100; ++n )
+    {
+      if( n % 10 ) gui_queue.post([&order, n]() { order.push_back(n); });
+      else gui_queue.post([&order, n, big]() { order.push_back(n + big[0] - 7); });
+    }
+    gui_queue.execute();
+    CHECK_EQ(order.size(), 100);
+    for( int n = 0; n < int(order.size()); ++n ) CHECK_EQ(order[n], n);
+    CHECK(gui_queue.is_empty());
+  }
+
+  // one thread, then 8 producers
+  const UINT tasks = 1000000;
+  double p1 = produce(1, tasks, true), n1 = produce(1, tasks, false);
+  double p8 = produce(8, tasks, true), n8 = produce(8, tasks, false);
+  printf("1 producer:  post %.1fM tasks/s, new gui_task %.1fM tasks/s\n", p1 / 1e6, n1 / 1e6);
+  printf("8 producers: post %.1fM tasks/s, new gui_task %.1fM tasks/s\n", p8 / 1e6, n8 / 1e6);
+  task_node_pool().flush();
+  CHECK_EQ(task_node_pool().stats().live, 0);
+
+  // task_node_pool() is created after late_clear, so it would be destroyed before it;
+  // the pool is never destroyed and late_clear can free these nodes
+  for( int n = 0; n < 10; ++n ) gui_queue.post([]() { sum += 1; });
+
+  return test_result("test_post");
+}
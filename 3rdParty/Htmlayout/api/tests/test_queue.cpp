@@ -0,0 +1,137 @@
+// queue: lock-free push of 8 producers, wakeups on empty -> non-empty only, re-signal of lost wakeups.
+
+#include "test.h"
+#include "htmlayout_queue.h"
+#include "fake_engine.h"
+
+#include <vector>
+
+using namespace htmlayout;
+
+htmlayout::queue gui_queue;
+
+// wakeup of a GUI thread that waits on a condition variable instead of a message queue
+class condvar_wakeup: public queue_wakeup
+{
+  pthread_mutex_t m;
+  pthread_cond_t  cv;
+  bool            pending;
+public:
+  volatile LONG   signals;
+  condvar_wakeup(): pending(false), signals(0) { pthread_mutex_init(&m, 0); pthread_cond_init(&cv, 0); }
+  ~condvar_wakeup() { pthread_cond_destroy(&cv); pthread_mutex_destroy(&m); }
+  virtual void signal()
+  {
+    ::InterlockedIncrement(&signals);
+    pthread_mutex_lock(&m);
+    pending = true;
+    pthread_cond_signal(&cv);
+    pthread_mutex_unlock(&m);
+  }
+  // true if signalled, false on timeout
+  bool wait( UINT ms )
+  {
+    timespec t; clock_gettime(CLOCK_REALTIME, &t);
+    t.tv_nsec += long(ms) * 1000000; t.tv_sec += t.tv_nsec / 1000000000; t.tv_nsec %= 1000000000;
+    pthread_mutex_lock(&m);
+    while( !pending && pthread_cond_timedwait(&cv, &m, &t) == 0 ) ;
+    bool r = pending;
+    pending = false;
+    pthread_mutex_unlock(&m);
+    return r;
+  }
+};
+
+// drops every signal, e.g. a thread message eaten by a modal loop
+class lossy_wakeup: public queue_wakeup
+{
+public:
+  LONG signals;
+  lossy_wakeup(): signals(0) {}
+  virtual void signal() { ++signals; }
+};
+
+static LONG sum = 0; // tasks run in the GUI thread only
+static volatile LONG finished = 0; // producers that are done
+
+struct add_task: public gui_task
+{
+  virtual void exec() { ++sum; }
+};
+
+static DWORD WINAPI producer( LPVOID p )
+{
+  UINT tasks = *(UINT*)p;
+  for( UINT n = 0; n < tasks; ++n )
+    gui_queue.push(new add_task());
+  ::InterlockedIncrement(&finished);
+  return 0;
+}
+
+int main()
+{
+  // 8 producers, the GUI thread sleeps until the wakeup
+  {
+    condvar_wakeup cw;
+    gui_queue.set_wakeup(&cw);
+    const UINT producers = 8, tasks = 250000;
+    UINT per_producer = tasks;
+    LONG woken_before = gui_queue.woken();
+    UINT stranded = 0; // timeouts that found tasks: a lost wakeup
+    std::vector<HANDLE> threads;
+    double t0 = now_ms();
+    for( UINT n = 0; n < producers; ++n ) threads.push_back(::CreateThread(0, 0, &producer, &per_producer, 0, 0));
+    while( finished < LONG(producers) || !gui_queue.is_empty() )
+    {
+      if( !cw.wait(50) && !gui_queue.is_empty() ) ++stranded;
+      gui_queue.execute();
+    }
+    double t = now_ms() - t0;
+    ::WaitForMultipleObjects(DWORD(threads.size()), &threads[0], TRUE, INFINITE);
+    for( UINT n = 0; n < producers; ++n ) ::CloseHandle(threads[n]);
+    LONG woken = gui_queue.woken() - woken_before;
+    CHECK_EQ(sum, producers * tasks);
+    CHECK_EQ(stranded, 0);
+    CHECK_EQ(cw.signals, woken);
+    CHECK(woken < LONG(producers * tasks / 10)); // coalesced
+    printf("%u producers: %.1fM tasks/s, %ld wakeups for %u tasks\n", producers, producers * tasks / t / 1000.0, long(woken), producers * tasks);
+    gui_queue.set_wakeup(0);
+  }
+
+  // the first signal is lost, pushes into the non-empty queue signal again after the interval
+  {
+    mock_clock::manual();
+    lossy_wakeup lw;
+    gui_queue.set_wakeup(&lw);
+    gui_queue.set_resignal_interval(100);
+    gui_queue.push(new add_task());
+    CHECK_EQ(lw.signals, 1);
+    gui_queue.push(new add_task());
+    mock_clock::advance(99);
+    gui_queue.push(new add_task());
+    CHECK_EQ(lw.signals, 1);
+    mock_clock::advance(1);
+    gui_queue.push(new add_task());
+    CHECK_EQ(lw.signals, 2);
+    gui_queue.push(new add_task());
+    CHECK_EQ(lw.signals, 2);
+
+    // execute() took the tasks: the next push is the empty -> non-empty one
+    sum = 0;
+    gui_queue.execute();
+    CHECK_EQ(sum, 5);
+    gui_queue.push(new add_task());
+    CHECK_EQ(lw.signals, 3);
+
+    // execute() stopped by max_tasks signals for the rest itself
+    gui_queue.push(new add_task());
+    gui_queue.execute(0, 1);
+    CHECK_EQ(lw.signals, 4);
+    CHECK(!gui_queue.is_empty());
+    gui_queue.execute();
+    CHECK(gui_queue.is_empty());
+    gui_queue.set_wakeup(0);
+  }
+
+  return test_result("test_queue");
+}
@@ -0,0 +1,87 @@
+// dom::sort_children*: order, minimal swaps, parallel permutation sort, one update of the parent.
+
+#include "test.h"
+#include "htmlayout_sort.hpp"
+#include "fake_engine.h"
+
+#include <stdlib.h>
+
+using namespace htmlayout;
+
+static fake::node* table_of( const int* values, int rows, int fixed_rows )
+{
+  fake::node* table = new fake::node("table");
+  for( int r = 0; r < fixed_rows; ++r ) new fake::node("tr", table);
+  for( int r = 0; r < rows; ++r )
+  {
+    fake::node* row = new fake::node("tr", table);
+    new fake::node("td", row);
+    fake::node* cell = new fake::node("td", row);
+    wchar_t buf[16]; swprintf(buf, 16, L"%d", values[r]);
+    cell->text = buf;
+  }
+  return table;
+}
+
+static int value_at( fake::node* table, int r ) { return int(wcstol(table->kids[r]->kids[1]->text.c_str(), 0, 10)); }
+
+struct int_of_cell
+{
+  int operator()( HELEMENT row ) const
+  {
+    return int(wcstol(fake::n(row)->kids[1]->text.c_str(), 0, 10));
+  }
+};
+
+int main()
+{
+  const int values[] = { 5, -3, 12, 7, 7, 0, 100, -40 };
+  const int n = sizeof(values) / sizeof(values[0]);
+
+  // by text, the fixed header row stays in place
+  {
+    fake::node* table = table_of(values, n, 1);
+    fake::node* header = table->kids[0];
+    fake::updates().clear();
+    dom::sort_stats st = dom::sort_children_by_text(table, 1, 1);
+    CHECK(table->kids[0] == header);
+    for( int r = 2; r <= n; ++r )
+      CHECK(table->kids[r - 1]->kids[1]->text <= table->kids[r]->kids[1]->text);
+    CHECK_EQ(st.elements, n);
+    CHECK(st.swaps < UINT(n));
+    CHECK_EQ(fake::updates().size(), 1);
+    CHECK(fake::updates().size() == 1 && fake::updates()[0].he == (HELEMENT)table);
+  }
+
+  // by int, descending
+  {
+    fake::node* table = table_of(values, n, 0);
+    fake::updates().clear();
+    dom::sort_children_by_int(table, 1, 0, -1, false);
+    for( int r = 1; r < n; ++r )
+      CHECK(value_at(table, r - 1) >= value_at(table, r));
+    CHECK_EQ(fake::updates().size(), 1);
+
+    // already sorted: no swaps, no update
+    fake::updates().clear();
+    dom::sort_stats st = dom::sort_children_by_int(table, 1, 0, -1, false);
+    CHECK_EQ(st.swaps, 0);
+    CHECK_EQ(fake::updates().size(), 0);
+  }
+
+  // large set, the permutation is sorted by several threads
+  {
+    const int big = 50000;
+    std::vector<int> vs(big);
+    srand(1);
+    for( int i = 0; i < big; ++i ) vs[i] = rand() % 1000;
+    fake::node* table = table_of(&vs[0], big, 0);
+    dom::sort_stats st = dom::sort_children<int>(table, int_of_cell(), std::less<int>());
+    for( int r = 1; r < big; ++r )
+      CHECK(value_at(table, r - 1) <= value_at(table, r));
+    CHECK_EQ(st.extractions, big);
+    printf("sorted %d rows, %u thread(s), %u swaps\n", big, st.threads, st.swaps);
+  }
+
+  return test_result("test_sort");
+}
@@ -0,0 +1,244 @@
+// sqlite_source: pages against plain ORDER BY, count estimates, header clicks; benchmark on a 10M-row file.
+//
+//   g++ -std=c++20 -O2 -DLIBRARY_BUILD -Itests/mock -I. tests/test_sqlite.cpp -lsqlite3 -lpthread
+//   a.out                 - checks on in-memory tables
+//   a.out /tmp/log.db     - and the benchmark, the file is made with 10M records if it does not exist
+
+#include "test.h"
+#include "htmlayout_sqlite_source.hpp"
+#include "fake_engine.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace htmlayout;
+
+htmlayout::queue gui_queue;
+
+static const char* t_columns[] = { "id", "v", "name" };
+
+static std::vector<std::string> columns_of( const char** names, size_t n ) { return std::vector<std::string>(names, names + n); }
+
+static void exec( sqlite3* db, const char* sql ) { CHECK_EQ(sqlite3_exec(db, sql, 0, 0, 0), SQLITE_OK); }
+
+// ids in order of plain SQL
+static std::vector<long long> reference( sqlite3* db, const char* order )
+{
+  std::vector<long long> r;
+  sqlite3_stmt* st = 0;
+  std::string sql = std::string("SELECT id FROM t ORDER BY ") + order;
+  sqlite3_prepare_v2(db, sql.c_str(), -1, &st, 0);
+  while( sqlite3_step(st) == SQLITE_ROW ) r.push_back(sqlite3_column_int64(st, 0));
+  sqlite3_finalize(st);
+  return r;
+}
+
+// records of fetch(first, count) are the ones of the reference
+static bool same( sqlite_source& src, const std::vector<long long>& ref, UINT first, UINT count )
+{
+  record_batch b;
+  if( !src.fetch(first, count, b) ) return false;
+  UINT expect = first >= ref.size()? 0: UINT((std::min)(size_t(count), ref.size() - first));
+  if( b.count != expect ) return false;
+  for( UINT i = 0; i < b.count; ++i )
+    if( b.columns[0].ints[i] != ref[first + i] ) return false;
+  return true;
+}
+
+// pages in sequence, shuffled and in reverse, then random windows
+static void check_order( sqlite3* db, int col, bool asc, const char* order )
+{
+  std::vector<long long> ref = reference(db, order);
+  std::mt19937 rng(col * 2 + asc);
+  const UINT page = 7, pages = UINT((ref.size() + page - 1) / page + 2);
+  for( int pass = 0; pass < 3; ++pass )
+  {
+    sqlite_source src(db, "t", columns_of(t_columns, 3), "id");
+    src.order_by(col, asc);
+    std::vector<UINT> seq(pages);
+    for( UINT i = 0; i < pages; ++i ) seq[i] = i;
+    if( pass == 1 ) std::shuffle(seq.begin(), seq.end(), rng);
+    if( pass == 2 ) std::reverse(seq.begin(), seq.end());
+    UINT bad = 0;
+    for( UINT i = 0; i < pages; ++i )
+      if( !same(src, ref, seq[i] * page, page) ) ++bad;
+    CHECK_EQ(bad, 0);
+    if( pass == 0 ) CHECK(src.count_is_exact() && src.total_records() == ref.size());
+    if( pass == 2 ) CHECK(src.stats().backward > 0);
+  }
+  for( int pass = 0; pass < 4; ++pass )
+  {
+    sqlite_source src(db, "t", columns_of(t_columns, 3), "id");
+    src.order_by(col, asc);
+    UINT bad = 0;
+    for( int i = 0; i < 300; ++i )
+      if( !same(src, ref, UINT(rng() % (ref.size() + 5)), 1 + UINT(rng() % 40)) ) ++bad;
+    CHECK_EQ(bad, 0);
+  }
+}
+
+static double benchmark_page( sqlite_source& src, UINT first, UINT count, UINT pages, bool backwards = false )
+{
+  double t0 = now_ms();
+  for( UINT p = 0; p < pages; ++p )
+  {
+    record_batch b;
+    UINT at = backwards? first - p * count: first + p * count;
+    CHECK(src.fetch(at, count, b) && b.count == count);
+  }
+  return (now_ms() - t0) / pages;
+}
+
+static double offset_page( sqlite3* db, const char* order, UINT first, UINT count )
+{
+  char sql[256];
+  snprintf(sql, sizeof(sql), "SELECT id, time, level, message, size FROM log ORDER BY %s LIMIT %u OFFSET %u", order, count, first);
+  double t0 = now_ms();
+  sqlite3_stmt* st = 0;
+  sqlite3_prepare_v2(db, sql, -1, &st, 0);
+  while( sqlite3_step(st) == SQLITE_ROW ) ;
+  sqlite3_finalize(st);
+  return now_ms() - t0;
+}
+
+static void make_log( const char* path, UINT records )
+{
+  printf("making %s with %u records...\n", path, records);
+  sqlite3* db = 0;
+  sqlite3_open(path, &db);
+  exec(db, "PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF;");
+  exec(db, "CREATE TABLE log(id INTEGER PRIMARY KEY, time INTEGER, level INTEGER, message TEXT, size INTEGER)");
+  exec(db, "BEGIN");
+  sqlite3_stmt* st = 0;
+  sqlite3_prepare_v2(db, "INSERT INTO log VALUES(?1, ?2, ?3, ?4, ?5)", -1, &st, 0);
+  std::mt19937 rng(1);
+  char msg[64];
+  for( UINT i = 1; i <= records; ++i )
+  {
+    sqlite3_bind_int64(st, 1, i);
+    sqlite3_bind_int64(st, 2, 1600000000LL + i * 3 + rng() % 5);
+    sqlite3_bind_int(st, 3, int(rng() % 5));
+    snprintf(msg, sizeof(msg), "request %u served", UINT(rng()));
+    sqlite3_bind_text(st, 4, msg, -1, SQLITE_TRANSIENT);
+    if( rng() % 100 == 0 ) sqlite3_bind_null(st, 5); else sqlite3_bind_int(st, 5, int(rng() % 100000));
+    sqlite3_step(st);
+    sqlite3_reset(st);
+  }
+  sqlite3_finalize(st);
+  exec(db, "COMMIT");
+  exec(db, "CREATE INDEX log_time ON log(time); CREATE INDEX log_size ON log(size); ANALYZE;");
+  sqlite3_close(db);
+}
+
+static void benchmark( const char* path )
+{
+  const UINT records = 10000000, PS = 128;
+  if( FILE* f = fopen(path, "rb") ) fclose(f); else make_log(path, records);
+  sqlite3* db = 0;
+  sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX, 0);
+  const char* cols[] = { "time", "level", "message", "size" };
+
+  double t0 = now_ms();
+  sqlite_source src(db, "log", columns_of(cols, 4), "id");
+  printf("open, estimate %u: %.2f ms\n", src.total_records(), now_ms() - t0);
+  t0 = now_ms();
+  UINT n = src.count_exact();
+  printf("COUNT(*) = %u: %.1f ms\n", n, now_ms() - t0);
+  CHECK_EQ(n, records);
+
+  const UINT deep = records - records / 100;
+  printf("by id:   sequential %.3f ms/page\n", benchmark_page(src, 0, PS, 200));
+  t0 = now_ms(); benchmark_page(src, deep, PS, 1);
+  printf("         jump to %u: %.1f ms, then %.3f ms/page\n", deep, now_ms() - t0, benchmark_page(src, deep + PS, PS, 200));
+  printf("         OFFSET page at %u: %.1f ms\n", deep, offset_page(db, "id", deep, PS));
+
+  src.order_by(0, false);
+  printf("by time desc: sequential %.3f ms/page\n", benchmark_page(src, 0, PS, 200));
+  t0 = now_ms(); benchmark_page(src, records / 2, PS, 1);
+  printf("         jump to %u: %.1f ms, then %.3f ms/page\n", records / 2, now_ms() - t0, benchmark_page(src, records / 2 + PS, PS, 200));
+  printf("         OFFSET page at %u: %.1f ms\n", records / 2, offset_page(db, "time DESC, id DESC", records / 2, PS));
+
+  src.order_by(3, true); // 1% NULLs, first
+  printf("by size: sequential %.3f ms/page\n", benchmark_page(src, 0, PS, 200));
+  t0 = now_ms(); benchmark_page(src, deep, PS, 1);
+  printf("         jump to %u: %.1f ms, scrolling up %.3f ms/page\n", deep, now_ms() - t0, benchmark_page(src, deep - PS, PS, 200, true));
+
+  const sqlite_source_stats& s = src.stats();
+  printf("stats: prepared %u reused %u pages %u seeks %u backward %u skipped %u\n", s.prepared, s.reused, s.pages, s.seeks, s.backward, s.skipped);
+  sqlite3_close(db);
+}
+
+int main( int argc, char** argv )
+{
+  // 1000 records with NULLs and duplicates in v
+  sqlite3* db = 0;
+  sqlite3_open(":memory:", &db);
+  exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, v REAL, name TEXT); CREATE INDEX t_v ON t(v);");
+  {
+    std::mt19937 rng(5);
+    exec(db, "BEGIN");
+    for( int i = 1; i <= 1000; ++i )
+    {
+      char sql[128];
+      if( rng() % 10 == 0 ) snprintf(sql, sizeof(sql), "INSERT INTO t VALUES(%d, NULL, 'n%d')", i * 3, i);
+      else snprintf(sql, sizeof(sql), "INSERT INTO t VALUES(%d, %d, 'n%d')", i * 3, int(rng() % 50), i);
+      exec(db, sql);
+    }
+    exec(db, "COMMIT");
+  }
+  check_order(db, -1, true, "id");
+  check_order(db, -1, false, "id DESC");
+  check_order(db, 1, true, "v ASC, id ASC");
+  check_order(db, 1, false, "v DESC, id DESC");
+  check_order(db, 2, true, "name ASC, id ASC");
+
+  // estimates: max(key) without ANALYZE, sqlite_stat1 after it
+  {
+    sqlite_source src(db, "t", columns_of(t_columns, 3), "id");
+    CHECK_EQ(src.total_records(), 3000);
+    CHECK(!src.count_is_exact());
+    record_batch b;
+    CHECK(src.fetch(0, 3, b));
+    CHECK(b.columns[0].type == DATA_INT && b.columns[1].type == DATA_REAL && b.columns[2].type == DATA_TEXT);
+  }
+  exec(db, "ANALYZE");
+  {
+    sqlite_source src(db, "t", columns_of(t_columns, 3), "id");
+    CHECK_EQ(src.total_records(), 1000);
+  }
+  // a key beyond UINT range is no estimate
+  {
+    exec(db, "CREATE TABLE big(id INTEGER PRIMARY KEY, v INTEGER); INSERT INTO big VALUES(1, 1), (2, 2), (5000000000, 3);");
+    const char* cols[] = { "v" };
+    sqlite_source src(db, "big", columns_of(cols, 1), "id");
+    CHECK_EQ(src.total_records(), 3);
+    CHECK(src.count_is_exact());
+  }
+
+  // header clicks order by the column, the second one reverses it
+  {
+    workers pool(1);
+    std::shared_ptr<sqlite_source> src = std::make_shared<sqlite_source>(db, "t", columns_of(t_columns, 3), "id");
+    sqlite_rows_source* rs = new sqlite_rows_source(src, pool);
+    fake::node* row = new fake::node("tr");
+    fake::node* c0 = new fake::node("th", row);
+    fake::node* c1 = new fake::node("th", row);
+    rs->on_event(0, c1, TABLE_HEADER_CLICK, 1);
+    CHECK(src->order_column() == 1 && src->order_ascending());
+    CHECK((c1->state & STATE_CHECKED) && c1->attributes["order"] == L"asc");
+    rs->on_event(0, c1, TABLE_HEADER_CLICK, 1);
+    CHECK(!src->order_ascending() && c1->attributes["order"] == L"desc");
+    rs->on_event(0, c0, TABLE_HEADER_CLICK, 0);
+    CHECK(src->order_column() == 0 && src->order_ascending());
+    CHECK(!(c1->state & STATE_CHECKED) && !c1->attributes.count("order") && (c0->state & STATE_CHECKED));
+    CHECK_EQ(fake::posted().size(), 3);
+    delete rs;
+    delete c0; delete c1; delete row;
+  }
+  sqlite3_close(db);
+
+  if( argc > 1 ) benchmark(argv[1]);
+  return test_result("test_sqlite");
+}
@@ -0,0 +1,120 @@
+// table::view: int filters with bounds out of the int range, min/max of group(), row snapshots under sort().
+
+#include "test.h"
+#include "htmlayout_table.hpp"
+#include "fake_engine.h"
+
+#include <limits.h>
+#include <math.h>
+#include <vector>
+
+using namespace htmlayout;
+using namespace htmlayout::table;
+
+htmlayout::queue gui_queue;
+
+static const int values[] = { INT_MIN, -1, 0, 1, INT_MAX };
+static const int repeats = 20; // 120 rows, whole words go through SIMD compares
+
+static size_t count( view& v, UINT col, PREDICATE_OP op, double a, double b = 0 )
+{
+  v.filter( predicate(col, op, a, b) );
+  return v.rows()->size() / repeats;
+}
+
+static DWORD WINAPI reader( LPVOID p )
+{
+  view* v = (view*)p;
+  for( int n = 0; n < 2000; ++n )
+  {
+    record_batch batch;
+    UINT total = v->total_records();
+    CHECK(total == 0 || v->fetch(0, total < 10? total: 10, batch));
+  }
+  return 0;
+}
+
+int main()
+{
+  std::shared_ptr<columnar_table> t = std::make_shared<columnar_table>();
+  UINT key = t->add_column(L"key", DATA_INT), val = t->add_column(L"val", DATA_INT);
+  for( int r = 0; r < repeats; ++r )
+  {
+    for( int i = 0; i < 5; ++i )
+    {
+      t->column_at(key).push_int(i % 2);
+      t->column_at(val).push_int(values[i]);
+      t->commit_row();
+    }
+    t->column_at(key).push_int(0);
+    t->column_at(val).push_null();
+    t->commit_row();
+  }
+
+  view v(t);
+  {
+    // bounds beyond the int range select all or nothing
+    CHECK_EQ(count(v, val, OP_LT, 3e9), 5);
+    CHECK_EQ(count(v, val, OP_LE, 3e9), 5);
+    CHECK_EQ(count(v, val, OP_GT, 3e9), 0);
+    CHECK_EQ(count(v, val, OP_GE, 3e9), 0);
+    CHECK_EQ(count(v, val, OP_LT, -3e9), 0);
+    CHECK_EQ(count(v, val, OP_LE, -3e9), 0);
+    CHECK_EQ(count(v, val, OP_GT, -3e9), 5);
+    CHECK_EQ(count(v, val, OP_GE, -3e9), 5);
+    CHECK_EQ(count(v, val, OP_BETWEEN, 3e9, 4e9), 0);
+    CHECK_EQ(count(v, val, OP_BETWEEN, -4e9, -3e9), 0);
+    CHECK_EQ(count(v, val, OP_BETWEEN, -3e9, 3e9), 5);
+    CHECK_EQ(count(v, val, OP_EQ, 3e9), 0);
+    CHECK_EQ(count(v, val, OP_NE, 3e9), 5);
+    // at the ends of the range
+    CHECK_EQ(count(v, val, OP_LT, INT_MAX), 4);
+    CHECK_EQ(count(v, val, OP_GE, INT_MAX), 1);
+    CHECK_EQ(count(v, val, OP_GT, 2147483646.5), 1);
+    CHECK_EQ(count(v, val, OP_LE, INT_MIN), 1);
+    CHECK_EQ(count(v, val, OP_GT, INT_MIN), 4);
+    CHECK_EQ(count(v, val, OP_LT, -2147483647.5), 1);
+    CHECK_EQ(count(v, val, OP_EQ, INT_MIN), 1);
+    CHECK_EQ(count(v, val, OP_NE, INT_MAX), 4);
+    // fractions and NaN
+    CHECK_EQ(count(v, val, OP_LT, -0.5), 2);
+    CHECK_EQ(count(v, val, OP_GT, 0.5), 2);
+    CHECK_EQ(count(v, val, OP_BETWEEN, -0.5, 0.5), 1);
+    CHECK_EQ(count(v, val, OP_BETWEEN, 0.2, 0.8), 0);
+    CHECK_EQ(count(v, val, OP_EQ, 0.5), 0);
+    CHECK_EQ(count(v, val, OP_NE, 0.5), 5);
+    CHECK_EQ(count(v, val, OP_LT, NAN), 0);
+    CHECK_EQ(count(v, val, OP_BETWEEN, NAN, 1), 0);
+    CHECK_EQ(count(v, val, OP_LT, INFINITY), 5);
+    v.clear_filter();
+  }
+
+  // min and max of groups
+  {
+    std::vector<aggregate> aggs;
+    aggs.push_back( aggregate(val, AGG_MIN, L"min") );
+    aggs.push_back( aggregate(val, AGG_MAX, L"max") );
+    aggs.push_back( aggregate(UINT(-1), AGG_COUNT, L"rows") );
+    std::shared_ptr<columnar_table> g = v.group(key, aggs);
+    CHECK_EQ(g->rows(), 2);
+    // key 0: INT_MIN, 0, INT_MAX and nulls; key 1: -1, 1
+    CHECK_EQ(g->column_at(0).ints[0], 0);
+    CHECK(g->column_at(1).reals[0] == double(INT_MIN) && g->column_at(2).reals[0] == double(INT_MAX));
+    CHECK(g->column_at(1).reals[1] == -1.0 && g->column_at(2).reals[1] == 1.0);
+    CHECK_EQ(g->column_at(3).ints[0], repeats * 4);
+  }
+
+  // fetch() of another thread while rows are replaced by sort() and filter()
+  {
+    HANDLE th = ::CreateThread(0, 0, &reader, &v, 0, 0);
+    for( int n = 0; n < 200; ++n )
+    {
+      v.sort( sort_key(val, n % 2 == 0) );
+      if( n % 3 ) v.filter( predicate(val, OP_GE, 0.0) ); else v.clear_filter();
+    }
+    ::WaitForSingleObject(th, INFINITE);
+    ::CloseHandle(th);
+  }
+
+  return test_result("test_table");
+}
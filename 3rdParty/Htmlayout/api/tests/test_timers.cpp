@@ -0,0 +1,118 @@
+// timers::set/kill: firing, re-arm from on_timer, suspended windows, wheels freed, fallback engine timers.
+
+#include "test.h"
+#include "htmlayout_timers.hpp"
+#include "fake_engine.h"
+
+using namespace htmlayout;
+
+struct ticker: public event_handler
+{
+  int  ticks;
+  BOOL keep;
+  UINT rearm_ms; // set again from on_timer
+  ticker(): event_handler(HANDLE_TIMER), ticks(0), keep(TRUE), rearm_ms(0) {}
+  virtual BOOL on_timer( HELEMENT he )
+  {
+    ++ticks;
+    if( rearm_ms ) timers::set(he, this, rearm_ms);
+    return keep;
+  }
+};
+
+static const HWND hwnd = (HWND)1;
+
+// advances the clock by ms, the window timer fires once
+static void elapse( DWORD ms )
+{
+  mock_clock::advance(ms);
+  mock_window_timers::fire(hwnd);
+}
+
+static UINT_PTR wheel_timer() { return mock_window_timers::get().n? mock_window_timers::get().timers[0].id: 0; }
+
+int main()
+{
+  mock_clock::manual();
+  timers::service& svc = timers::service::instance();
+
+  fake::node* body = new fake::node("body");
+  fake::node* el = new fake::node("div", body);
+
+  // periodic timer, one window timer of TICK_MS
+  {
+    ticker t;
+    attach_event_handler(el, &t);
+    timers::set(el, &t, 100);
+    CHECK_EQ(svc.wheels(), 1);
+    CHECK_EQ(mock_window_timers::period(hwnd, wheel_timer()), timers::TICK_MS);
+    elapse(50);  CHECK_EQ(t.ticks, 0);
+    elapse(50);  CHECK_EQ(t.ticks, 1);
+    elapse(100); CHECK_EQ(t.ticks, 2);
+
+    // returns FALSE but sets itself again: keeps going with the new period
+    t.keep = FALSE; t.rearm_ms = 30;
+    elapse(100); CHECK_EQ(t.ticks, 3);
+    t.rearm_ms = 0;
+    elapse(30);  CHECK_EQ(t.ticks, 4); // FALSE without re-arm stops it
+    elapse(100); CHECK_EQ(t.ticks, 4);
+
+    // the last timer is gone: the window timer is killed and the wheel freed
+    CHECK_EQ(svc.wheels(), 0);
+    CHECK_EQ(mock_window_timers::get().n, 0);
+    CHECK_EQ(el->uses, 0);
+    detach_event_handler(el, &t);
+  }
+
+  // timers of hidden elements are suspended, the window polls them at SUSPEND_POLL_MS
+  {
+    ticker t;
+    attach_event_handler(el, &t);
+    timers::set(el, &t, 20);
+    el->visible = false;
+    elapse(20);
+    CHECK_EQ(t.ticks, 0);
+    CHECK_EQ(timers::stats().suspended, 1);
+    CHECK_EQ(mock_window_timers::period(hwnd, wheel_timer()), timers::SUSPEND_POLL_MS);
+    el->visible = true;
+    elapse(timers::SUSPEND_POLL_MS);
+    CHECK_EQ(t.ticks, 1);
+    CHECK_EQ(timers::stats().suspended, 0);
+    CHECK_EQ(mock_window_timers::period(hwnd, wheel_timer()), timers::TICK_MS);
+
+    // detach cancels timers of the handler and frees the wheel
+    detach_event_handler(el, &t);
+    CHECK_EQ(svc.wheels(), 0);
+    CHECK_EQ(mock_window_timers::get().n, 0);
+    CHECK_EQ(timers::stats().timers, 0);
+  }
+
+  // element out of window: engine timer, cleared by kill() or detach
+  {
+    fake::node* loose = new fake::node("div");
+    loose->hwnd = 0;
+    ticker t;
+    attach_event_handler(loose, &t);
+    timers::set(loose, &t, 100);
+    CHECK_EQ(loose->timers.size(), 1);
+    timers::kill(loose, &t);
+    CHECK_EQ(loose->timers.size(), 0);
+    timers::set(loose, &t, 100, 7);
+    detach_event_handler(loose, &t);
+    CHECK_EQ(loose->timers.size(), 0);
+    delete loose;
+  }
+
+  // kill() leaves engine timers it did not set alone
+  {
+    ticker t;
+    attach_event_handler(el, &t);
+    HTMLayoutSetTimerEx(el, 500, 0); // by someone else
+    timers::set(el, &t, 100);
+    timers::kill(el, &t);
+    CHECK_EQ(el->timers.size(), 1);
+    detach_event_handler(el, &t);
+  }
+
+  return test_result("test_timers");
+}
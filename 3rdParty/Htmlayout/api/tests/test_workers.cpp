@@ -0,0 +1,133 @@
+// workers: throughput of outside and nested tasks, continuations, element tokens, detach races.
+
+#include "test.h"
+#include "htmlayout_workers.hpp"
+#include "fake_engine.h"
+
+#include <vector>
+
+using namespace htmlayout;
+
+htmlayout::queue gui_queue;
+
+static volatile LONG done = 0;
+
+// binary fan-out, every task spawns two from the worker thread
+struct fan
+{
+  workers* pool;
+  int      depth;
+  void operator()()
+  {
+    ::InterlockedIncrement(&done);
+    if( !depth ) return;
+    pool->run(fan { pool, depth - 1 });
+    pool->run(fan { pool, depth - 1 });
+  }
+};
+
+static void wait_done( LONG n ) { while( done < n ) ::Sleep(1); }
+
+int main()
+{
+  // throughput: tasks from outside, nested tasks, results to the GUI thread
+  {
+    workers pool(4);
+    const LONG outside = 1000000;
+    done = 0;
+    double t0 = now_ms();
+    for( LONG n = 0; n < outside; ++n ) pool.run([]() { ::InterlockedIncrement(&done); });
+    wait_done(outside);
+    double t1 = now_ms();
+
+    const int depth = 19;
+    const LONG nested = (1 << (depth + 1)) - 1;
+    done = 0;
+    pool.run(fan { &pool, depth });
+    wait_done(nested);
+    double t2 = now_ms();
+
+    const int results = 100000;
+    long long sum = 0;
+    int delivered = 0;
+    for( int n = 0; n < results; ++n )
+      pool.run([n]() { return n; }).then_on_gui([&](int r) { sum += r; ++delivered; });
+    while( delivered < results ) gui_queue.execute();
+    double t3 = now_ms();
+
+    CHECK_EQ(sum, (long long)results * (results - 1) / 2);
+    workers_stats st = pool.stats();
+    CHECK_EQ(st.cancelled, 0);
+    printf("%u threads: outside %.1fM tasks/s, nested %.1fM tasks/s (%ld stolen), with continuation %.1fM tasks/s\n",
+      pool.threads(), outside / (t1 - t0) / 1000.0, nested / (t2 - t1) / 1000.0, long(st.stolen), results / (t3 - t2) / 1000.0);
+  }
+
+  // tokens of the element alone and of the element and a handler
+  {
+    fake::node* el = new fake::node("div");
+    event_handler a(0), b(0);
+    attach_event_handler(el, &a);
+    attach_event_handler(el, &b);
+    cancel_token of_a = element_token(el, &a), of_el = element_token(el);
+    CHECK_EQ(element_tokens::instance().size(), 2);
+    detach_event_handler(el, &b);
+    CHECK(of_el.cancelled());
+    CHECK(!of_a.cancelled());
+    CHECK(!element_token(el).cancelled()); // new one
+    fake::kill(el); // detaches a
+    CHECK(of_a.cancelled());
+    CHECK_EQ(element_tokens::instance().size(), 0);
+    delete el;
+  }
+
+  // elements die while their work waits or runs: no continuation sees a dead element
+  {
+    const int elements = 64, jobs = 200;
+    fake::node* body = new fake::node("body");
+    std::vector<event_handler*> hs;
+    std::vector<int> results(elements, 0);
+    for( int i = 0; i < elements; ++i )
+    {
+      fake::node* el = new fake::node("div", body);
+      hs.push_back(new event_handler(0));
+      attach_event_handler(el, hs.back());
+    }
+    std::vector<fake::node*> els = body->kids;
+    static volatile LONG gate = 0;
+    {
+      workers pool(4);
+      for( int j = 0; j < jobs; ++j )
+        for( int i = 0; i < elements; ++i )
+        {
+          fake::node* el = els[i];
+          pool.run([]() { while( !gate ) ::Sleep(0); volatile int x = 0; for( int k = 0; k < 2000; ++k ) x = x + k; return int(x != 0); })
+              .on(el)
+              .then_on_gui([el, i, &results](int) { CHECK(!el->dead); ++results[i]; });
+        }
+      // elements 0, 4, 8 ... are killed before the work goes, the first tasks are already running
+      for( int i = 0; i < elements; i += 4 )
+        fake::kill(els[i]);
+      ::InterlockedExchange(&gate, 1);
+      // elements 2, 6, 10 ... while the work is in flight
+      for( int i = 2; i < elements; i += 4 )
+      {
+        gui_queue.execute();
+        fake::kill(els[i]);
+      }
+      while( pool.stats().executed < elements * jobs ) gui_queue.execute();
+      CHECK(pool.stats().cancelled >= elements / 4 * (jobs - 1));
+      printf("detach race: %ld of %d tasks cancelled by the pool\n", long(pool.stats().cancelled), elements * jobs);
+    } // waits for the running tasks
+    gui_queue.execute();
+    for( int i = 0; i < elements; ++i )
+      if( i % 4 == 0 ) CHECK_EQ(results[i], 0);
+      else if( i % 2 ) CHECK_EQ(results[i], jobs);
+    for( int i = 1; i < elements; i += 2 ) fake::kill(els[i]);
+    CHECK_EQ(element_tokens::instance().size(), 0);
+    for( int i = 0; i < elements; ++i ) { delete els[i]; delete hs[i]; }
+    delete body;
+  }
+
+  CHECK(gui_queue.is_empty());
+  return test_result("test_workers");
+}
@@ -193,7 +193,7 @@ public:
   {
     T* pT = static_cast<T*>(this);
     ATLASSERT(::IsWindow(pT->m_hWnd));
-    HTMLayoutWindowAttachEventHandler(pT->m_hWnd, htmlayout::event_handler::element_proc,peh,peh->subscribed_to); 
+    HTMLayoutWindowAttachEventHandler(pT->m_hWnd, peh->event_proc(),peh,peh->subscribed_to); 
   }
 
 	// Overridables
@@ -0,0 +1,408 @@
+#ifndef __aux_profiler_h__
+#define __aux_profiler_h__
+
+/*
+ * Terra Informatica Sciter and HTMLayout Engines
+ * http://terrainformatica.com/sciter, http://terrainformatica.com/htmlayout
+ *
+ * event dispatch profiler.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+/**\file
+ * \brief event dispatch profiler: per handler/event group counters, latency histograms and traces
+ **/
+
+/*
+
+  Included by htmlayout_behavior.hpp (sciter-x-behavior.h) when HTMLAYOUT_PROFILE_EVENTS
+  (SCITER_PROFILE_EVENTS) is defined. Without it nothing of this is compiled in.
+
+  aux::profiler::event_scope          - measures one call of ElementEventProc.
+  aux::profiler::write_json()         - calls, handled/unhandled counts and latency histograms
+                                        per handler class and event group.
+  aux::profiler::write_chrome_trace() - recent calls in Chrome trace_event format,
+                                        load it in chrome://tracing.
+
+  Each thread writes to its own buffer, no locks and no interlocked operations
+  on the dispatch path. Buffers are never freed so data of finished threads
+  stays available for export. Export and reset() read/write buffers of other threads
+  without synchronization - numbers taken while events are dispatched are approximate.
+
+*/
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <map>
+
+#if defined(_CPPRTTI)
+  #include <typeinfo>
+#endif
+
+namespace aux
+{
+  namespace profiler
+  {
+    typedef unsigned __int64 uint64;
+
+    /** log-linear (HDR-style) histogram of nanoseconds:
+     *  SUB linear buckets per power of two, relative error <= 1/SUB.
+     **/
+    struct histogram
+    {
+      enum
+      {
+        SUB_BITS = 3,
+        SUB = 1 << SUB_BITS,
+        MAX_BITS = 40, // ~18 minutes, longer values go to the last bucket
+        BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB
+      };
+
+      static UINT bucket_of( uint64 v )
+      {
+        if( v >= (uint64(1) << MAX_BITS) ) v = (uint64(1) << MAX_BITS) - 1;
+        if( v < SUB ) return UINT(v);
+        UINT msb = 0;
+        for( uint64 t = v; t >>= 1; ) ++msb;
+        return (msb - SUB_BITS + 1) * SUB + UINT((v >> (msb - SUB_BITS)) & (SUB - 1));
+      }
+      // max value that goes to the bucket
+      static uint64 upper_of( UINT idx )
+      {
+        if( idx < SUB ) return idx;
+        UINT   msb = idx / SUB + SUB_BITS - 1;
+        uint64 lower = uint64(SUB + idx % SUB) << (msb - SUB_BITS);
+        return lower + (uint64(1) << (msb - SUB_BITS)) - 1;
+      }
+      // value at quantile q (0..1) of the buckets
+      static uint64 quantile( const UINT* buckets, uint64 total, double q )
+      {
+        if( !total ) return 0;
+        uint64 rank = uint64(q * double(total) + 0.5); if( rank < 1 ) rank = 1;
+        uint64 seen = 0;
+        for( UINT n = 0; n < BUCKETS; ++n )
+          if( (seen += buckets[n]) >= rank )
+            return upper_of(n);
+        return upper_of(BUCKETS - 1);
+      }
+    };
+
+    // calls of one handler (class) in one event group
+    struct entry
+    {
+      const char* name;   // handler class name, static string
+      UINT        group;  // EVENT_GROUPS value
+      UINT        calls;
+      UINT        handled;
+      uint64      total_ns;
+      uint64      max_ns;
+      UINT        buckets[histogram::BUCKETS];
+    };
+
+    // one call, for traces
+    struct trace_record
+    {
+      const char* name;
+      UINT        group;
+      BOOL        handled;
+      uint64      start;    // QPC ticks
+      uint64      duration; // QPC ticks
+    };
+
+    enum
+    {
+      SLOTS = 128,          // number of name/group entries per thread
+      TRACE_SIZE = 16384    // ring of last calls per thread
+    };
+
+    struct thread_buffer
+    {
+      DWORD           thread_id;
+      entry           slots[SLOTS];
+      UINT            dropped;     // calls that did not fit into slots
+      trace_record*   trace;       // allocated on first traced call
+      volatile LONG   trace_count; // total number of traced calls, ring position is trace_count % TRACE_SIZE
+      thread_buffer*  next;
+    };
+
+    inline thread_buffer* volatile& first_buffer() { static thread_buffer* volatile _first = 0; return _first; }
+    inline volatile LONG& trace_enabled() { static volatile LONG _on = 1; return _on; }
+
+    /** turns recording of traces on/off, counters and histograms are always collected **/
+    inline void enable_trace( bool on ) { trace_enabled() = on? 1: 0; }
+
+    inline uint64 ticks_per_second()
+    {
+      static uint64 _freq = 0;
+      if( !_freq ) { LARGE_INTEGER f; ::QueryPerformanceFrequency(&f); _freq = uint64(f.QuadPart); }
+      return _freq;
+    }
+    inline uint64 ticks_to_ns( uint64 ticks ) { return uint64( double(ticks) * 1e9 / double(ticks_per_second()) ); }
+
+    inline DWORD tls_index()
+    {
+      static volatile LONG _index = LONG(TLS_OUT_OF_INDEXES);
+      if( _index == LONG(TLS_OUT_OF_INDEXES) )
+      {
+        DWORD idx = ::TlsAlloc();
+        if( ::InterlockedCompareExchange(&_index, LONG(idx), LONG(TLS_OUT_OF_INDEXES)) != LONG(TLS_OUT_OF_INDEXES) )
+          ::TlsFree(idx); // other thread was first
+      }
+      return DWORD(_index);
+    }
+
+    // buffer of the current thread
+    inline thread_buffer* current()
+    {
+      DWORD idx = tls_index();
+      if( idx == TLS_OUT_OF_INDEXES ) return 0;
+      thread_buffer* tb = static_cast<thread_buffer*>(::TlsGetValue(idx));
+      if( tb ) return tb;
+      tb = new thread_buffer();
+      memset(tb, 0, sizeof(thread_buffer));
+      tb->thread_id = ::GetCurrentThreadId();
+      ::TlsSetValue(idx, tb);
+      thread_buffer* head;
+      do { head = first_buffer(); tb->next = head; }
+      while( ::InterlockedCompareExchangePointer((PVOID volatile*)&first_buffer(), tb, head) != head );
+      return tb;
+    }
+
+    inline void record( const char* name, UINT group, BOOL handled, uint64 start, uint64 end )
+    {
+      thread_buffer* tb = current();
+      if( !tb ) return;
+      uint64 ns = ticks_to_ns(end - start);
+
+      UINT h = (UINT(UINT_PTR(name)) >> 3) ^ (group * 2654435761u);
+      entry* e = 0;
+      for( UINT n = 0; n < SLOTS; ++n )
+      {
+        entry& s = tb->slots[(h + n) % SLOTS];
+        if( s.name == name && s.group == group ) { e = &s; break; }
+        if( !s.name ) { s.name = name; s.group = group; e = &s; break; }
+      }
+      if( !e ) { ++tb->dropped; return; }
+      ++e->calls;
+      if( handled ) ++e->handled;
+      e->total_ns += ns;
+      if( ns > e->max_ns ) e->max_ns = ns;
+      ++e->buckets[histogram::bucket_of(ns)];
+
+      if( !trace_enabled() ) return;
+      if( !tb->trace ) tb->trace = new trace_record[TRACE_SIZE];
+      trace_record& tr = tb->trace[ UINT(tb->trace_count) % TRACE_SIZE ];
+      tr.name = name; tr.group = group; tr.handled = handled;
+      tr.start = start; tr.duration = end - start;
+      tb->trace_count = tb->trace_count + 1; // single writer
+    }
+
+    /** event_scope - measures one dispatch:
+     *    aux::profiler::event_scope ps( name, evtg );
+     *    return ps.done( dispatch(...) );
+     **/
+    class event_scope
+    {
+      const char*   _name;
+      UINT          _group;
+      LARGE_INTEGER _start;
+    public:
+      event_scope( const char* name, UINT group ): _name(name), _group(group) { ::QueryPerformanceCounter(&_start); }
+      BOOL done( BOOL handled )
+      {
+        LARGE_INTEGER end; ::QueryPerformanceCounter(&end);
+        record( _name, _group, handled, uint64(_start.QuadPart), uint64(end.QuadPart) );
+        return handled;
+      }
+    };
+
+    /** name of handler class, static string **/
+    template <typename T>
+      inline const char* name_of( const T* p )
+      {
+#if defined(_CPPRTTI)
+        return typeid(*p).name();
+#else
+        p;
+        return "event_handler";
+#endif
+      }
+
+    // EVENT_GROUPS values are the same in both engines
+    inline const char* group_name( UINT group )
+    {
+      switch( group )
+      {
+        case 0x0000: return "initialization";
+        case 0x0001: return "mouse";
+        case 0x0002: return "key";
+        case 0x0004: return "focus";
+        case 0x0008: return "scroll";
+        case 0x0010: return "timer";
+        case 0x0020: return "size";
+        case 0x0040: return "draw";
+        case 0x0080: return "data_arrived";
+        case 0x0100: return "behavior_event";
+        case 0x0200: return "method_call";
+        case 0x0400: return "scripting_method_call";
+      }
+      return "other";
+    }
+
+    /** clears collected data, call it when events are not dispatched (e.g. from the GUI thread). **/
+    inline void reset()
+    {
+      for( thread_buffer* tb = first_buffer(); tb; tb = tb->next )
+      {
+        memset(tb->slots, 0, sizeof(tb->slots));
+        tb->dropped = 0;
+        tb->trace_count = 0;
+      }
+    }
+
+    // JSON output helpers
+    inline void put_string( std::string& out, const char* s )
+    {
+      out += '"';
+      for( ; *s; ++s )
+      {
+        if( *s == '"' || *s == '\\' ) out += '\\';
+        if( (unsigned char)*s >= 0x20 ) out += *s;
+      }
+      out += '"';
+    }
+    inline void put_number( std::string& out, uint64 n )
+    {
+      char buf[32]; _snprintf(buf, sizeof(buf), "%I64u", n); buf[31] = 0;
+      out += buf;
+    }
+    inline void put_number( std::string& out, double d )
+    {
+      char buf[64]; _snprintf(buf, sizeof(buf), "%.3f", d); buf[63] = 0;
+      out += buf;
+    }
+
+    /** appends per handler/event group statistics to the out as JSON:
+     *  { "handlers": [ { "name":..., "group":"mouse", "calls":N, "handled":N, "unhandled":N, "handled_ratio":0.5,
+     *                    "total_us":..., "max_us":..., "p50_us":..., "p90_us":..., "p99_us":...,
+     *                    "histogram": [ [upper_ns, count], ... ] }, ... ],
+     *    "dropped": N }
+     **/
+    inline void write_json( std::string& out )
+    {
+      struct total
+      {
+        UINT   calls, handled;
+        uint64 total_ns, max_ns;
+        UINT   buckets[histogram::BUCKETS];
+      };
+      typedef std::map< std::pair<std::string, UINT>, total > totals_t;
+      totals_t totals;
+      UINT     dropped = 0;
+
+      for( thread_buffer* tb = first_buffer(); tb; tb = tb->next )
+      {
+        dropped += tb->dropped;
+        for( UINT n = 0; n < SLOTS; ++n )
+        {
+          const entry& e = tb->slots[n];
+          if( !e.name ) continue;
+          std::pair<std::string, UINT> key(e.name, e.group);
+          totals_t::iterator it = totals.find(key);
+          if( it == totals.end() )
+          {
+            total t; memset(&t, 0, sizeof(t));
+            it = totals.insert( totals_t::value_type(key, t) ).first;
+          }
+          total& t = it->second;
+          t.calls += e.calls; t.handled += e.handled;
+          t.total_ns += e.total_ns;
+          if( e.max_ns > t.max_ns ) t.max_ns = e.max_ns;
+          for( UINT b = 0; b < histogram::BUCKETS; ++b )
+            t.buckets[b] += e.buckets[b];
+        }
+      }
+
+      out += "{\"handlers\":[";
+      for( totals_t::const_iterator it = totals.begin(); it != totals.end(); ++it )
+      {
+        const total& t = it->second;
+        if( it != totals.begin() ) out += ',';
+        out += "\n{\"name\":"; put_string(out, it->first.first.c_str());
+        out += ",\"group\":"; put_string(out, group_name(it->first.second));
+        out += ",\"calls\":"; put_number(out, uint64(t.calls));
+        out += ",\"handled\":"; put_number(out, uint64(t.handled));
+        out += ",\"unhandled\":"; put_number(out, uint64(t.calls - t.handled));
+        out += ",\"handled_ratio\":"; put_number(out, t.calls? double(t.handled) / t.calls: 0.0);
+        out += ",\"total_us\":"; put_number(out, double(t.total_ns) / 1000);
+        out += ",\"max_us\":"; put_number(out, double(t.max_ns) / 1000);
+        out += ",\"p50_us\":"; put_number(out, double(histogram::quantile(t.buckets, t.calls, 0.50)) / 1000);
+        out += ",\"p90_us\":"; put_number(out, double(histogram::quantile(t.buckets, t.calls, 0.90)) / 1000);
+        out += ",\"p99_us\":"; put_number(out, double(histogram::quantile(t.buckets, t.calls, 0.99)) / 1000);
+        out += ",\"histogram\":[";
+        bool first = true;
+        for( UINT b = 0; b < histogram::BUCKETS; ++b )
+        {
+          if( !t.buckets[b] ) continue;
+          if( !first ) out += ',';
+          first = false;
+          out += '['; put_number(out, histogram::upper_of(b));
+          out += ','; put_number(out, uint64(t.buckets[b])); out += ']';
+        }
+        out += "]}";
+      }
+      out += "],\n\"dropped\":"; put_number(out, uint64(dropped));
+      out += "}\n";
+    }
+
+    /** appends recorded calls (up to TRACE_SIZE last ones per thread) to the out
+     *  in Chrome trace_event format, complete ("X") events with microsecond timestamps.
+     **/
+    inline void write_chrome_trace( std::string& out )
+    {
+      const double us_per_tick = 1e6 / double(ticks_per_second());
+      const uint64 pid = ::GetCurrentProcessId();
+      bool first = true;
+      out += "{\"traceEvents\":[";
+      for( thread_buffer* tb = first_buffer(); tb; tb = tb->next )
+      {
+        if( !tb->trace ) continue;
+        UINT count = UINT(tb->trace_count);
+        UINT n = count < TRACE_SIZE? count: TRACE_SIZE;
+        for( UINT i = count - n; i != count; ++i )
+        {
+          const trace_record& tr = tb->trace[i % TRACE_SIZE];
+          if( !first ) out += ',';
+          first = false;
+          out += "\n{\"name\":"; put_string(out, tr.name);
+          out += ",\"cat\":"; put_string(out, group_name(tr.group));
+          out += ",\"ph\":\"X\",\"ts\":"; put_number(out, double(tr.start) * us_per_tick);
+          out += ",\"dur\":"; put_number(out, double(tr.duration) * us_per_tick);
+          out += ",\"pid\":"; put_number(out, pid);
+          out += ",\"tid\":"; put_number(out, uint64(tb->thread_id));
+          out += tr.handled? ",\"args\":{\"handled\":true}}": ",\"args\":{\"handled\":false}}";
+        }
+      }
+      out += "],\n\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    inline bool save( const char* path, const std::string& data )
+    {
+      FILE* f = fopen(path, "wb");
+      if( !f ) return false;
+      bool r = fwrite(data.c_str(), 1, data.length(), f) == data.length();
+      fclose(f);
+      return r;
+    }
+    inline bool save_json( const char* path )         { std::string s; write_json(s); return save(path, s); }
+    inline bool save_chrome_trace( const char* path ) { std::string s; write_chrome_trace(s); return save(path, s); }
+
+  }
+}
+
+#endif
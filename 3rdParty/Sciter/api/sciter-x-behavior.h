@@ -17,15 +17,25 @@
 /*!\file
 \brief Behaiviors support (a.k.a windowless scriptable controls)
 */
+#if !defined(PLATFORM_WINDOWS) && defined(_WIN32)
+  #define PLATFORM_WINDOWS
+#endif
+
 #if defined(PLATFORM_WINDOWS)
   #define WIN32_LEAN_AND_MEAN
   #include <windows.h>
 #else
+  #include <time.h>
 #endif
 
 
 #include "sciter-x-dom.h"
 #include "sciter-x-value.h"
+#include "aux-hash.h"
+
+#if defined(SCITER_PROFILE_EVENTS)
+  #include "aux-profiler.h"
+#endif
 
 #pragma pack(push,8)
 
@@ -561,6 +571,17 @@ typedef  ElementEventProc * LPElementEventProc;
       static BOOL CALLBACK  element_proc(LPVOID tag, HELEMENT he, UINT evtg, LPVOID prms )
       {
         event_handler* pThis = static_cast<event_handler*>(tag);
+#if defined(SCITER_PROFILE_EVENTS)
+        if( !pThis ) return FALSE;
+        aux::profiler::event_scope ps( aux::profiler::name_of(pThis), evtg );
+        return ps.done( dispatch_event(pThis, he, evtg, prms) );
+#else
+        return dispatch_event(pThis, he, evtg, prms);
+#endif
+      }
+
+      static BOOL dispatch_event(event_handler* pThis, HELEMENT he, UINT evtg, LPVOID prms )
+      {
         if( pThis ) switch( evtg )
           {
             case HANDLE_INITIALIZATION:
@@ -601,14 +622,125 @@ typedef  ElementEventProc * LPElementEventProc;
     // automaticly while handling HLN_ATTACH_BEHAVIOR notification
     //
 
+    struct behavior_factory;
+
+    // set of factories that override global ones in particular window(s),
+    // see behavior_factory(name, factory_set&) ctor and create_behavior() in sciter-x.h
+    struct behavior_factory_set
+    {
+      aux::name_table<behavior_factory> table;
+      unsigned                          duplicates; // factories rejected by add(): the name is in the set already
+
+      behavior_factory_set(): duplicates(0) {}
+
+      bool add(behavior_factory* f, const char* name)
+      {
+        bool r = table.insert(name, f);
+        assert(r); // duplicate name in the set, the first one stays
+        if( !r ) ++duplicates;
+        return r;
+      }
+      void attach_to(HWND hwnd)
+      {
+#if defined(PLATFORM_WINDOWS)
+        if( ::SetPropA(hwnd, prop_name(), this) )
+          ::InterlockedIncrement(&attached_count());
+#else
+        window_map& wm = windows();
+        wm.lock();
+        window_map::item** pi = wm.find(hwnd);
+        if( *pi )
+          (*pi)->set = this;
+        else
+        {
+          window_map::item* it = new window_map::item;
+          it->hwnd = hwnd; it->set = this; it->next = wm.items;
+          wm.items = it;
+          __sync_fetch_and_add(&attached_count(), 1);
+        }
+        wm.unlock();
+#endif
+      }
+      void detach_from(HWND hwnd)
+      {
+#if defined(PLATFORM_WINDOWS)
+        if( ::RemovePropA(hwnd, prop_name()) )
+          ::InterlockedDecrement(&attached_count());
+#else
+        window_map& wm = windows();
+        wm.lock();
+        window_map::item** pi = wm.find(hwnd);
+        if( window_map::item* it = *pi )
+        {
+          *pi = it->next;
+          delete it;
+          __sync_fetch_and_sub(&attached_count(), 1);
+        }
+        wm.unlock();
+#endif
+      }
+
+      static behavior_factory_set* of(HWND hwnd)
+      {
+        if( !attached_count() ) return 0; // fast path, no overrides at all
+#if defined(PLATFORM_WINDOWS)
+        return static_cast<behavior_factory_set*>(::GetPropA(hwnd, prop_name()));
+#else
+        window_map& wm = windows();
+        wm.lock();
+        window_map::item* it = *wm.find(hwnd);
+        behavior_factory_set* ps = it? it->set: 0;
+        wm.unlock();
+        return ps;
+#endif
+      }
+    private:
+      static volatile LONG& attached_count() { static volatile LONG n = 0; return n; }
+#if defined(PLATFORM_WINDOWS)
+      static const char* prop_name() { return "sciter::behavior_factory_set"; }
+#else
+      // no window properties here: sets of windows are kept in the list, under a spin lock.
+      // Few windows have overrides, and of() is not called at all while there are none.
+      struct window_map
+      {
+        struct item { HWND hwnd; behavior_factory_set* set; item* next; };
+        item*        items;
+        volatile int busy;
+        item** find(HWND hwnd) { item** pi = &items; while( *pi && (*pi)->hwnd != hwnd ) pi = &(*pi)->next; return pi; }
+        void lock()   { while( __sync_lock_test_and_set(&busy, 1) ) while( busy ) ; }
+        void unlock() { __sync_lock_release(&busy); }
+      };
+      static window_map& windows() { static window_map wm; return wm; }
+#endif
+    };
+
     struct behavior_factory
     {
       behavior_factory(const char* external_name)
         :next(0),name(external_name)
       {
+        // a factory with such name is registered already: the first one stays, this one is counted in duplicates().
+        // Static initialization order decides which one is the first, use behavior_factory_set to override.
+        for(behavior_factory* t = root(); t; t = t->next)
+          if( strcmp(t->name,external_name) == 0 )
+          {
+            assert(false);
+            ++duplicates();
+            return;
+          }
         // add this implementation to the list (singleton)
         next = root();
         root(this);
+        // registration after first lookup, e.g. by dynamically loaded module
+        if( aux::acquire_ptr(&table()) )
+          freeze();
+      }
+
+      // factory that goes to the override set rather than to the global list
+      behavior_factory(const char* external_name, behavior_factory_set& overrides)
+        :next(0),name(external_name)
+      {
+        overrides.add(this, external_name);
       }
 
       // needs to be overriden
@@ -619,15 +751,36 @@ typedef  ElementEventProc * LPElementEventProc;
       const char*       name; // name must be a pointer to a static string
 
       // returns behavior implementation by name.
-      static event_handler* create(const char* name, HELEMENT he)
+      static event_handler* create(const char* name, HELEMENT he, HWND hwnd = 0)
       {
-        for(behavior_factory* t = root(); t; t = t->next)
-          if(strcmp(t->name,name)==0)
-          {
-            return t->create(he);
-          }
-        return 0; // not found
+        behavior_factory* t = lookup(name, hwnd);
+        return t? t->create(he): 0;
       }
+
+      // returns factory by name, looking first in overrides of the window (if any)
+      static behavior_factory* lookup(const char* name, HWND hwnd = 0)
+      {
+#if defined(SCITER_PROFILE_LOOKUPS)
+        LONGLONG t0 = lookup_stats::now();
+#endif
+        behavior_factory* t = 0;
+        if( hwnd )
+        {
+          behavior_factory_set* ps = behavior_factory_set::of(hwnd);
+          if( ps ) t = ps->table.find(name);
+        }
+        if( !t )
+        {
+          registry* pr = aux::acquire_ptr(&table());
+          if( !pr ) pr = freeze();
+          t = pr->find(name);
+        }
+#if defined(SCITER_PROFILE_LOOKUPS)
+        stats().add(lookup_stats::now() - t0);
+#endif
+        return t;
+      }
+
       // implementation of static list of behaviors
       static behavior_factory* root(behavior_factory* to_set = 0)
       {
@@ -636,6 +789,45 @@ typedef  ElementEventProc * LPElementEventProc;
         return _root;
       }
 
+      // number of factories not registered because their name was taken
+      static unsigned& duplicates() { static unsigned n = 0; return n; }
+
+#if defined(SCITER_PROFILE_LOOKUPS)
+      // instrumentation: number of lookups and time spent in them, SCITER_PROFILE_LOOKUPS builds only
+      struct lookup_stats
+      {
+        volatile LONG     lookups;
+        volatile LONGLONG ticks; // QueryPerformanceCounter units, nanoseconds if not PLATFORM_WINDOWS
+#if defined(PLATFORM_WINDOWS)
+        void add(LONGLONG dt) { ::InterlockedIncrement(&lookups); ::InterlockedExchangeAdd64(&ticks, dt); }
+        double seconds() const { LARGE_INTEGER f; ::QueryPerformanceFrequency(&f); return f.QuadPart? double(ticks) / double(f.QuadPart): 0; }
+        static LONGLONG now() { LARGE_INTEGER t; ::QueryPerformanceCounter(&t); return t.QuadPart; }
+#else
+        void add(LONGLONG dt) { __sync_fetch_and_add(&lookups, 1); __sync_fetch_and_add(&ticks, dt); }
+        double seconds() const { return double(ticks) / 1e9; }
+        static LONGLONG now() { timespec t; clock_gettime(CLOCK_MONOTONIC, &t); return LONGLONG(t.tv_sec) * 1000000000 + t.tv_nsec; }
+#endif
+      };
+      static lookup_stats& stats() { static lookup_stats s = {0,0}; return s; }
+#endif
+
+    private:
+      typedef aux::name_table<behavior_factory> registry;
+
+      // frozen (read-only) table of the list, built on first lookup
+      static registry* volatile& table() { static registry* volatile _table = 0; return _table; }
+
+      static registry* freeze()
+      {
+        registry* pr = new registry();
+        for(behavior_factory* t = root(); t; t = t->next)
+          pr->insert(t->name,t); // first one wins, as in the list
+        registry* current = aux::acquire_ptr(&table());
+        if( aux::publish_ptr(&table(), pr, current) )
+          return pr; // previous table (if any) is not deleted as it may be in use by other threads
+        delete pr;   // other thread was first
+        return aux::acquire_ptr(&table());
+      }
     };
 
     inline void attach_dom_event_handler(HWND hwnd, event_handler* ph)
@@ -6,18 +6,24 @@
 
 
 /** Each sciter extension module shall include external function 
- *  SciterInitModule with the following signature
+ *  SciterInitModule with the following signature.
+ *  This SDK has no DOM API table: pdomapi is 0 when sciter::behavior_modules loads the module,
+ *  the module calls DOM functions of sciter-x-dom.h exported by the engine directly.
+ *  Return FALSE to refuse loading.
  */
 
-EXTERN_C BOOL WINAPI SciterInitModule( SciterDomApi* pdomapi, VOID* p1, VOID* p2 )
+EXTERN_C BOOL WINAPI SciterInitModule( LPVOID pdomapi, VOID* p1, VOID* p2 )
 {
-  sciter::dom::element::api(pdomapi);
   return TRUE;
 }
 
-/** Each sciter extension module shall include function 
+/** Each sciter extension module shall include external function
+ *  SciterBehaviorFactory with the following signature, it returns TRUE and the event proc and tag
+ *  of the behavior if the module implements the behavior with the name.
+ *  To get the module loaded on first use of its behaviors list them
+ *  in behaviors.manifest of its folder, see sciter-x-modules.h
  */
-EXTERN_C BOOL WINAPI SciterBehaviorFactory( LPCSTR, HELEMENT, SciterDomApi::LPELEMENT_EVENT_PROC*, LPVOID* )
+EXTERN_C BOOL WINAPI SciterBehaviorFactory( LPCSTR name, HELEMENT he, ElementEventProc** pproc, LPVOID* ptag )
 {
   return FALSE;
 }
@@ -0,0 +1,275 @@
+/*
+ * Terra Informatica Sciter Engine
+ * http://terrainformatica.com/sciter
+ *
+ * Behavior modules loaded on demand.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __sciter_x_modules_h__
+#define __sciter_x_modules_h__
+
+#pragma once
+
+/*!\file
+\brief sciter::behavior_modules - loads extension modules (see sciter-x-module.cpp)
+       when one of their behaviors is attached first time.
+
+Folder with modules has behaviors.manifest that tells what behaviors each module implements:
+\code
+  # module file: behavior names
+  grids.dll:  grid-ext, grid-ext-header
+  charts.dll: chart-3d
+\endcode
+
+discover() reads the manifest only, modules are not touched. On first SC_ATTACH_BEHAVIOR
+with one of the listed names the module is loaded, its SciterInitModule is called and
+SciterBehaviorFactory is resolved. Next attachments go straight to the cached factory.
+A module that failed to load or to initialize is unloaded and not tried again.
+behaviors_attached() counts behaviors the factories of modules actually created.
+
+Loaded modules stay loaded until the behavior_modules object is destroyed.
+
+\par Example:
+\code
+  static sciter::behavior_modules modules;
+  modules.discover("plugins");
+  modules.install(); // consulted by sciter::create_behavior() for unknown names
+\endcode
+*/
+
+#include <string>
+#include <list>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(PLATFORM_WINDOWS) && defined(_WIN32)
+  #define PLATFORM_WINDOWS
+#endif
+
+#include "sciter-x.h"
+#include "aux-hash.h"
+
+#if defined(PLATFORM_WINDOWS)
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+  #include <pthread.h>
+#endif
+
+namespace sciter
+{
+
+  // module exports, see sciter-x-module.cpp. This SDK has no DOM API table: SciterInitModule gets 0 as pdomapi,
+  // modules shall not expect it and call DOM functions exported by the engine instead.
+  typedef BOOL WINAPI module_init_t( LPVOID pdomapi, VOID* p1, VOID* p2 );
+  typedef BOOL WINAPI module_behavior_factory_t( LPCSTR name, HELEMENT he, ElementEventProc** pproc, LPVOID* ptag );
+
+  class behavior_modules
+  {
+  public:
+    struct module
+    {
+      std::string                         path;
+      void*                               handle;
+      void* volatile                      factory; // module_behavior_factory_t*, published once the module is initialized
+      bool                                failed;
+    };
+
+    behavior_modules(): _loaded(0), _attached(0)
+    {
+#if defined(PLATFORM_WINDOWS)
+      ::InitializeCriticalSection(&_guard);
+#else
+      pthread_mutex_init(&_guard, 0);
+#endif
+    }
+    ~behavior_modules()
+    {
+      if( current() == this )
+        uninstall();
+      for( std::list<module>::iterator it = _modules.begin(); it != _modules.end(); ++it )
+        if( it->handle )
+          unload_library(it->handle);
+#if defined(PLATFORM_WINDOWS)
+      ::DeleteCriticalSection(&_guard);
+#else
+      pthread_mutex_destroy(&_guard);
+#endif
+    }
+
+    // reads <folder>/behaviors.manifest, returns number of behaviors added.
+    // call it before install(), names from the manifest that are already known are ignored.
+    int discover( const char* folder, const char* manifest_name = "behaviors.manifest" )
+    {
+      std::string dir = folder;
+      if( dir.length() && dir[dir.length() - 1] != '/' && dir[dir.length() - 1] != '\\' )
+        dir += '/';
+      FILE* f = fopen( (dir + manifest_name).c_str(), "r" );
+      if( !f ) return 0;
+      int added = 0;
+      char line[1024];
+      while( fgets(line, sizeof(line), f) )
+      {
+        char* colon = strrchr(line, ':'); // behavior names have no ':', file paths may have
+        if( line[0] == '#' || !colon ) continue;
+        *colon = 0;
+        std::string file = trim(line);
+        if( file.empty() ) continue;
+        module* pm = 0;
+        for( char* name = strtok(colon + 1, " \t,\r\n"); name; name = strtok(0, " \t,\r\n") )
+        {
+          if( _table.find(name) ) continue;
+          if( !pm )
+          {
+            module m = { dir + file, 0, 0, false };
+            _modules.push_back(m);
+            pm = &_modules.back();
+          }
+          _names.push_back(name);
+          _table.insert(_names.back().c_str(), pm);
+          ++added;
+        }
+      }
+      fclose(f);
+      return added;
+    }
+
+    // module that implements the behavior, 0 if none
+    module* find( const char* behavior_name ) const { return _table.find(behavior_name); }
+
+    // SC_ATTACH_BEHAVIOR handler
+    bool attach( LPSCN_ATTACH_BEHAVIOR lpab )
+    {
+      module* pm = _table.find(lpab->behaviorName);
+      if( !pm ) return false;
+      module_behavior_factory_t* pf = (module_behavior_factory_t*)aux::acquire_ptr(&pm->factory);
+      if( !pf && !(pf = load(*pm)) ) return false;
+      if( !pf(lpab->behaviorName, lpab->element, &lpab->elementProc, &lpab->elementTag) ) return false;
+      increment(_attached);
+      return true;
+    }
+
+    // makes sciter::create_behavior() to consult this set of modules
+    void install()   { current() = this; fallback_behavior() = &attach_current; }
+    void uninstall() { fallback_behavior() = 0; current() = 0; }
+
+    LONG modules_loaded() const { return _loaded; }
+    LONG behaviors_attached() const { return _attached; }
+    unsigned behaviors_known() const { return _table.size(); }
+
+  private:
+    std::list<module>        _modules;
+    std::list<std::string>   _names;    // storage of the table names
+    aux::name_table<module>  _table;    // behavior name -> module
+    volatile LONG            _loaded;
+    volatile LONG            _attached;
+#if defined(PLATFORM_WINDOWS)
+    CRITICAL_SECTION         _guard;
+#else
+    pthread_mutex_t          _guard;
+#endif
+
+    behavior_modules(const behavior_modules&);
+    behavior_modules& operator=(const behavior_modules&);
+
+    static behavior_modules*& current() { static behavior_modules* p = 0; return p; }
+    static bool attach_current( LPSCN_ATTACH_BEHAVIOR lpab )
+    {
+      behavior_modules* pms = current();
+      return pms && pms->attach(lpab);
+    }
+
+    static std::string trim( const char* s )
+    {
+      while( *s == ' ' || *s == '\t' ) ++s;
+      size_t n = strlen(s);
+      while( n && (s[n-1] == ' ' || s[n-1] == '\t' || s[n-1] == '\r' || s[n-1] == '\n') ) --n;
+      return std::string(s, n);
+    }
+
+    static void increment( volatile LONG& n )
+    {
+#if defined(PLATFORM_WINDOWS)
+      ::InterlockedIncrement(&n);
+#else
+      __sync_fetch_and_add(&n, 1);
+#endif
+    }
+
+    static void* load_library( const char* path )
+    {
+#if defined(PLATFORM_WINDOWS)
+      return ::LoadLibraryA(path);
+#else
+      return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+    }
+    static void* symbol( void* handle, const char* name )
+    {
+#if defined(PLATFORM_WINDOWS)
+      return (void*)::GetProcAddress((HMODULE)handle, name);
+#else
+      return dlsym(handle, name);
+#endif
+    }
+    static void unload_library( void* handle )
+    {
+#if defined(PLATFORM_WINDOWS)
+      ::FreeLibrary((HMODULE)handle);
+#else
+      dlclose(handle);
+#endif
+    }
+
+    void lock()
+    {
+#if defined(PLATFORM_WINDOWS)
+      ::EnterCriticalSection(&_guard);
+#else
+      pthread_mutex_lock(&_guard);
+#endif
+    }
+    void unlock()
+    {
+#if defined(PLATFORM_WINDOWS)
+      ::LeaveCriticalSection(&_guard);
+#else
+      pthread_mutex_unlock(&_guard);
+#endif
+    }
+
+    // slow path, first attachment of the module behaviors
+    module_behavior_factory_t* load( module& m )
+    {
+      lock();
+      module_behavior_factory_t* pf = (module_behavior_factory_t*)m.factory;
+      if( !pf && !m.failed )
+      {
+        m.handle = load_library(m.path.c_str());
+        module_init_t* pinit = m.handle? (module_init_t*)symbol(m.handle, "SciterInitModule"): 0;
+        pf = m.handle? (module_behavior_factory_t*)symbol(m.handle, "SciterBehaviorFactory"): 0;
+        if( !pf || (pinit && !pinit(0, 0, 0)) ) // no DOM API table
+        {
+          pf = 0;
+          m.failed = true;
+          if( m.handle ) unload_library(m.handle);
+          m.handle = 0;
+        }
+        else
+        {
+          aux::publish_ptr(&m.factory, (void*)pf, (void*)0);
+          increment(_loaded);
+        }
+      }
+      unlock();
+      return pf;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,492 @@
+/*
+ * Terra Informatica Sciter Engine
+ * http://terrainformatica.com/sciter
+ *
+ * Native classes for the script, bindings generated from member function pointers.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#ifndef __sciter_x_native_h__
+#define __sciter_x_native_h__
+
+#pragma once
+
+/*!\file
+\brief sciter::native_class<C> - SciterNativeDefineClass tables built from member function pointers.
+
+Each method/property gets its own SciterNativeMethod_t/SciterNativeProperty_t thunk
+instantiated for the member pointer, so argument types are known at compile time:
+ - arguments are checked by the VALUE type tag and read in place, aux::wchars/aux::bytes
+   (and std::wstring_view in C++17) point to the value data - no copies of strings;
+ - const SCITER_VALUE& arguments are passed as is;
+ - scalar results (int, bool, double) are set into retval directly,
+   without temporary SCITER_VALUE.
+
+Methods can have up to 4 arguments. Wrong number or types of arguments are reported
+to the script by SciterNativeThrow.
+
+\par Example:
+\code
+  struct counter
+  {
+    int  n;
+    counter(): n(0) {}
+    int  get_value() const { return n; }
+    void set_value( int v ) { n = v; }
+    int  add( int d ) { return n += d; }
+    int  count_of( aux::wchars s, int ch ) const { ... }
+  };
+
+  static sciter::native_class<counter> counter_class("Counter");
+  counter_class
+    .method("add",       SCITER_NATIVE_METHOD(&counter::add))
+    .method("countOf",   SCITER_NATIVE_METHOD(&counter::count_of))
+    .property("value",   SCITER_NATIVE_PROPERTY(&counter::get_value, &counter::set_value))
+    .define( SciterGetVM(hwnd) );
+
+  // script: var c = new Counter(); c.add(2); c.value = 12; stdout.println(c.countOf("abcab", 'a'));
+\endcode
+*/
+
+#include <vector>
+#include <string>
+#include <assert.h>
+
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+  #include <string_view>
+  #define SCITER_NATIVE_STRING_VIEW
+#endif
+
+#include "sciter-x-script.h"
+
+// thunks below spell ".template get<...>" as they may be used in templates with dependent pm's
+
+// thunk of member function, e.g. SCITER_NATIVE_METHOD(&my_class::method)
+#define SCITER_NATIVE_METHOD(pm) sciter::native::method_of(pm).template get<pm>()
+// thunk of property, e.g. SCITER_NATIVE_PROPERTY(&my_class::get_x, &my_class::set_x)
+#define SCITER_NATIVE_PROPERTY(getter, setter) sciter::native::property_of(getter, setter).template get<getter, setter>()
+// thunk of read-only property
+#define SCITER_NATIVE_PROPERTY_RO(getter) sciter::native::property_of(getter).template get<getter>()
+
+namespace sciter
+{
+
+  namespace native
+  {
+
+    inline void raise( HVM vm, const wchar_t* what, int n, const wchar_t* expected )
+    {
+      // "argument N: integer expected", "value: string expected"
+      wchar_t msg[128]; size_t len = 0;
+      const wchar_t* parts[] = { what, L": ", expected, L" expected" };
+      for( int i = 0; i < 4; ++i )
+      {
+        for( const wchar_t* s = parts[i]; *s && len < 120; ++s )
+        {
+          msg[len++] = *s;
+          if( i == 0 && s[1] == 0 && n >= 0 ) { msg[len++] = L' '; msg[len++] = wchar_t(L'1' + n); }
+        }
+      }
+      msg[len] = 0;
+      SciterNativeThrow(vm, msg);
+    }
+
+    /** arg<T> - conversion of SCITER_VALUE to the argument of type T.
+     *  is() checks the type tag only, get() reads the value in place.
+     **/
+    template <typename T> struct arg; // no conversion to this type
+
+    template <typename T> struct arg<const T>: arg<T> {};
+    template <typename T> struct arg<const T&>: arg<T> {};
+
+    template <> struct arg<int>
+    {
+      typedef int type;
+      static const wchar_t* expected() { return L"integer"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_INT; }
+      static int  get( const SCITER_VALUE& v ) { INT r = 0; ValueIntData(&v, &r); return r; }
+    };
+    template <> struct arg<unsigned>
+    {
+      typedef unsigned type;
+      static const wchar_t* expected() { return L"integer"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_INT; }
+      static unsigned get( const SCITER_VALUE& v ) { return unsigned(arg<int>::get(v)); }
+    };
+    template <> struct arg<bool>
+    {
+      typedef bool type;
+      static const wchar_t* expected() { return L"boolean"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_BOOL || v.t == T_INT; }
+      static bool get( const SCITER_VALUE& v ) { return arg<int>::get(v) != 0; }
+    };
+    template <> struct arg<double>
+    {
+      typedef double type;
+      static const wchar_t* expected() { return L"number"; }
+      static bool   is( const SCITER_VALUE& v ) { return v.t == T_FLOAT || v.t == T_INT; }
+      static double get( const SCITER_VALUE& v )
+      {
+        if( v.t == T_INT ) return arg<int>::get(v);
+        FLOAT_VALUE r = 0; ValueFloatData(&v, &r); return r;
+      }
+    };
+    template <> struct arg<float>
+    {
+      typedef float type;
+      static const wchar_t* expected() { return L"number"; }
+      static bool  is( const SCITER_VALUE& v ) { return arg<double>::is(v); }
+      static float get( const SCITER_VALUE& v ) { return float(arg<double>::get(v)); }
+    };
+    // points to the string data of the value, valid during the call
+    template <> struct arg<aux::wchars>
+    {
+      typedef aux::wchars type;
+      static const wchar_t* expected() { return L"string"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_STRING; }
+      static aux::wchars get( const SCITER_VALUE& v ) { return v.get_chars(); }
+    };
+    // points to the bytes of the value, valid during the call
+    template <> struct arg<aux::bytes>
+    {
+      typedef aux::bytes type;
+      static const wchar_t* expected() { return L"bytes"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_BYTES; }
+      static aux::bytes get( const SCITER_VALUE& v ) { return v.get_bytes(); }
+    };
+    template <> struct arg<std::wstring>
+    {
+      typedef std::wstring type;
+      static const wchar_t* expected() { return L"string"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_STRING; }
+      static std::wstring get( const SCITER_VALUE& v ) { aux::wchars s = v.get_chars(); return std::wstring(s.start, s.length); }
+    };
+    // any value, passed without copying
+    template <> struct arg<SCITER_VALUE>
+    {
+      typedef const SCITER_VALUE& type;
+      static const wchar_t* expected() { return L"value"; }
+      static bool is( const SCITER_VALUE& ) { return true; }
+      static const SCITER_VALUE& get( const SCITER_VALUE& v ) { return v; }
+    };
+#if defined(SCITER_NATIVE_STRING_VIEW)
+    template <> struct arg<std::wstring_view>
+    {
+      typedef std::wstring_view type;
+      static const wchar_t* expected() { return L"string"; }
+      static bool is( const SCITER_VALUE& v ) { return v.t == T_STRING; }
+      static std::wstring_view get( const SCITER_VALUE& v ) { aux::wchars s = v.get_chars(); return std::wstring_view(s.start, s.length); }
+    };
+#endif
+
+    /** ret<T> - stores result of type T into retval.
+     **/
+    template <typename T> struct ret; // no conversion from this type
+
+    template <typename T> struct ret<const T>: ret<T> {};
+    template <typename T> struct ret<const T&>: ret<T> {};
+
+    template <> struct ret<int>
+    {
+      static void set( SCITER_VALUE* rv, int v ) { ValueIntDataSet(rv, v, T_INT, 0); }
+    };
+    template <> struct ret<unsigned>
+    {
+      static void set( SCITER_VALUE* rv, unsigned v ) { ValueIntDataSet(rv, INT(v), T_INT, 0); }
+    };
+    template <> struct ret<bool>
+    {
+      static void set( SCITER_VALUE* rv, bool v ) { ValueIntDataSet(rv, v? 1: 0, T_BOOL, 0); }
+    };
+    template <> struct ret<double>
+    {
+      static void set( SCITER_VALUE* rv, double v ) { ValueFloatDataSet(rv, v, T_FLOAT, 0); }
+    };
+    template <> struct ret<float>
+    {
+      static void set( SCITER_VALUE* rv, float v ) { ValueFloatDataSet(rv, v, T_FLOAT, 0); }
+    };
+    template <> struct ret<aux::wchars>
+    {
+      static void set( SCITER_VALUE* rv, aux::wchars v ) { ValueStringDataSet(rv, v.start, v.length, 0); }
+    };
+    template <> struct ret<aux::bytes>
+    {
+      static void set( SCITER_VALUE* rv, aux::bytes v ) { ValueBinaryDataSet(rv, v.start, v.length, T_BYTES, 0); }
+    };
+    template <> struct ret<std::wstring>
+    {
+      static void set( SCITER_VALUE* rv, const std::wstring& v ) { ValueStringDataSet(rv, v.c_str(), UINT(v.length()), 0); }
+    };
+    template <> struct ret<SCITER_VALUE>
+    {
+      static void set( SCITER_VALUE* rv, const SCITER_VALUE& v ) { *rv = v; }
+    };
+#if defined(SCITER_NATIVE_STRING_VIEW)
+    template <> struct ret<std::wstring_view>
+    {
+      static void set( SCITER_VALUE* rv, std::wstring_view v ) { ValueStringDataSet(rv, v.data(), UINT(v.length()), 0); }
+    };
+#endif
+
+    /** result - receiver of the call result: "f(...), result(rv)".
+     *  For void functions the built-in comma is used and nothing is stored.
+     **/
+    struct result
+    {
+      SCITER_VALUE* rv;
+      explicit result( SCITER_VALUE* p ): rv(p) {}
+    };
+    template <typename T>
+      inline void operator , ( const T& v, const result& r ) { ret<T>::set(r.rv, v); }
+
+    template <class C>
+      inline C* object_of( HVM vm, SCITER_VALUE* self )
+      {
+        C* p = (self && self->is_object_native())? static_cast<C*>(self->get_object_data()): 0;
+        if( !p ) SciterNativeThrow(vm, L"native object expected");
+        return p;
+      }
+
+    inline bool argc_ok( HVM vm, INT argc, INT n )
+    {
+      if( argc == n ) return true;
+      wchar_t expected[] = L"0 argument(s)";
+      expected[0] = wchar_t(L'0' + n);
+      raise(vm, L"call", -1, expected);
+      return false;
+    }
+
+    template <typename A>
+      inline bool arg_ok( HVM vm, const SCITER_VALUE* argv, int n )
+      {
+        if( arg<A>::is(argv[n]) ) return true;
+        raise(vm, L"argument", n, arg<A>::expected());
+        return false;
+      }
+
+    /** method0 .. method4 - thunks of member functions by number of arguments.
+     *  PM is type of the member pointer, with or without const.
+     **/
+    template <class C, class R, class PM>
+      struct method0
+      {
+        template <PM M>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj || !argc_ok(vm, argc, 0) ) return;
+            ((obj->*M)(), result(rv));
+          }
+        template <PM M> SciterNativeMethod_t* get() const { return &thunk<M>; }
+      };
+
+    template <class C, class R, class A0, class PM>
+      struct method1
+      {
+        template <PM M>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj || !argc_ok(vm, argc, 1) || !arg_ok<A0>(vm, argv, 0) ) return;
+            ((obj->*M)( arg<A0>::get(argv[0]) ), result(rv));
+          }
+        template <PM M> SciterNativeMethod_t* get() const { return &thunk<M>; }
+      };
+
+    template <class C, class R, class A0, class A1, class PM>
+      struct method2
+      {
+        template <PM M>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj || !argc_ok(vm, argc, 2) ||
+                !arg_ok<A0>(vm, argv, 0) || !arg_ok<A1>(vm, argv, 1) ) return;
+            ((obj->*M)( arg<A0>::get(argv[0]), arg<A1>::get(argv[1]) ), result(rv));
+          }
+        template <PM M> SciterNativeMethod_t* get() const { return &thunk<M>; }
+      };
+
+    template <class C, class R, class A0, class A1, class A2, class PM>
+      struct method3
+      {
+        template <PM M>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj || !argc_ok(vm, argc, 3) ||
+                !arg_ok<A0>(vm, argv, 0) || !arg_ok<A1>(vm, argv, 1) || !arg_ok<A2>(vm, argv, 2) ) return;
+            ((obj->*M)( arg<A0>::get(argv[0]), arg<A1>::get(argv[1]), arg<A2>::get(argv[2]) ), result(rv));
+          }
+        template <PM M> SciterNativeMethod_t* get() const { return &thunk<M>; }
+      };
+
+    template <class C, class R, class A0, class A1, class A2, class A3, class PM>
+      struct method4
+      {
+        template <PM M>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj || !argc_ok(vm, argc, 4) ||
+                !arg_ok<A0>(vm, argv, 0) || !arg_ok<A1>(vm, argv, 1) ||
+                !arg_ok<A2>(vm, argv, 2) || !arg_ok<A3>(vm, argv, 3) ) return;
+            ((obj->*M)( arg<A0>::get(argv[0]), arg<A1>::get(argv[1]),
+                        arg<A2>::get(argv[2]), arg<A3>::get(argv[3]) ), result(rv));
+          }
+        template <PM M> SciterNativeMethod_t* get() const { return &thunk<M>; }
+      };
+
+    // method_of(&C::m) - selects thunk family by the member pointer type
+    template <class C, class R>
+      inline method0<C,R,R (C::*)()> method_of( R (C::*)() ) { return method0<C,R,R (C::*)()>(); }
+    template <class C, class R>
+      inline method0<C,R,R (C::*)() const> method_of( R (C::*)() const ) { return method0<C,R,R (C::*)() const>(); }
+    template <class C, class R, class A0>
+      inline method1<C,R,A0,R (C::*)(A0)> method_of( R (C::*)(A0) ) { return method1<C,R,A0,R (C::*)(A0)>(); }
+    template <class C, class R, class A0>
+      inline method1<C,R,A0,R (C::*)(A0) const> method_of( R (C::*)(A0) const ) { return method1<C,R,A0,R (C::*)(A0) const>(); }
+    template <class C, class R, class A0, class A1>
+      inline method2<C,R,A0,A1,R (C::*)(A0,A1)> method_of( R (C::*)(A0,A1) ) { return method2<C,R,A0,A1,R (C::*)(A0,A1)>(); }
+    template <class C, class R, class A0, class A1>
+      inline method2<C,R,A0,A1,R (C::*)(A0,A1) const> method_of( R (C::*)(A0,A1) const ) { return method2<C,R,A0,A1,R (C::*)(A0,A1) const>(); }
+    template <class C, class R, class A0, class A1, class A2>
+      inline method3<C,R,A0,A1,A2,R (C::*)(A0,A1,A2)> method_of( R (C::*)(A0,A1,A2) ) { return method3<C,R,A0,A1,A2,R (C::*)(A0,A1,A2)>(); }
+    template <class C, class R, class A0, class A1, class A2>
+      inline method3<C,R,A0,A1,A2,R (C::*)(A0,A1,A2) const> method_of( R (C::*)(A0,A1,A2) const ) { return method3<C,R,A0,A1,A2,R (C::*)(A0,A1,A2) const>(); }
+    template <class C, class R, class A0, class A1, class A2, class A3>
+      inline method4<C,R,A0,A1,A2,A3,R (C::*)(A0,A1,A2,A3)> method_of( R (C::*)(A0,A1,A2,A3) ) { return method4<C,R,A0,A1,A2,A3,R (C::*)(A0,A1,A2,A3)>(); }
+    template <class C, class R, class A0, class A1, class A2, class A3>
+      inline method4<C,R,A0,A1,A2,A3,R (C::*)(A0,A1,A2,A3) const> method_of( R (C::*)(A0,A1,A2,A3) const ) { return method4<C,R,A0,A1,A2,A3,R (C::*)(A0,A1,A2,A3) const>(); }
+
+    /** property<C,R,A,G,S> - thunk of getter "R get() const" and setter "void set(A)".
+     **/
+    template <class C, class R, class A, class G, class S>
+      struct property
+      {
+        template <G GET, S SET>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, BOOL set, SCITER_VALUE* val )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj ) return;
+            if( !set )
+              ret<R>::set(val, (obj->*GET)());
+            else if( arg<A>::is(*val) )
+              (obj->*SET)( arg<A>::get(*val) );
+            else
+              raise(vm, L"value", -1, arg<A>::expected());
+          }
+        template <G GET, S SET> SciterNativeProperty_t* get() const { return &thunk<GET, SET>; }
+      };
+
+    template <class C, class R, class G>
+      struct property_ro
+      {
+        template <G GET>
+          static VOID CALLBACK thunk( HVM vm, SCITER_VALUE* self, BOOL set, SCITER_VALUE* val )
+          {
+            C* obj = object_of<C>(vm, self);
+            if( !obj ) return;
+            if( set )
+              SciterNativeThrow(vm, L"read-only property");
+            else
+              ret<R>::set(val, (obj->*GET)());
+          }
+        template <G GET> SciterNativeProperty_t* get() const { return &thunk<GET>; }
+      };
+
+    template <class C, class R, class A>
+      inline property<C,R,A,R (C::*)() const,void (C::*)(A)> property_of( R (C::*)() const, void (C::*)(A) )
+        { return property<C,R,A,R (C::*)() const,void (C::*)(A)>(); }
+    template <class C, class R, class A>
+      inline property<C,R,A,R (C::*)(),void (C::*)(A)> property_of( R (C::*)(), void (C::*)(A) )
+        { return property<C,R,A,R (C::*)(),void (C::*)(A)>(); }
+    template <class C, class R>
+      inline property_ro<C,R,R (C::*)() const> property_of( R (C::*)() const )
+        { return property_ro<C,R,R (C::*)() const>(); }
+    template <class C, class R>
+      inline property_ro<C,R,R (C::*)()> property_of( R (C::*)() )
+        { return property_ro<C,R,R (C::*)()>(); }
+
+    // "this" method - the constructor, C shall be default constructible
+    template <class C>
+      VOID CALLBACK construct( HVM vm, SCITER_VALUE* self, SCITER_VALUE* argv, INT argc, SCITER_VALUE* rv )
+      {
+        if( !self || !self->is_object_native() ) { SciterNativeThrow(vm, L"native object expected"); return; }
+        delete static_cast<C*>(self->get_object_data());
+        self->set_object_data(new C());
+      }
+
+    template <class C>
+      VOID CALLBACK destroy( HVM vm, LPVOID* p_data_slot_value )
+      {
+        delete static_cast<C*>(*p_data_slot_value);
+        *p_data_slot_value = 0;
+      }
+
+  }
+
+  /** native_class<C> - definition of the script class backed by instances of C.
+   *  Instances are created by "new" in script (C::C()) and deleted by GC.
+   *  Tables are referenced by the VM so the object shall outlive it, e.g. be static.
+   **/
+  template <class C>
+    class native_class
+    {
+      std::vector<SciterNativeMethodDef>   _methods;
+      std::vector<SciterNativePropertyDef> _properties;
+      SciterNativeClassDef                 _def;
+
+      native_class(const native_class&);
+      native_class& operator=(const native_class&);
+    public:
+      native_class( const char* name )
+      {
+        _def.name = name;
+        _def.methods = 0;
+        _def.properties = 0;
+        _def.dtor = &native::destroy<C>;
+        method("this", &native::construct<C>);
+      }
+
+      native_class& method( LPCSTR name, SciterNativeMethod_t* pm )
+      {
+        assert(!_def.methods); // already defined
+        SciterNativeMethodDef md = { name, pm };
+        _methods.push_back(md);
+        return *this;
+      }
+
+      native_class& property( LPCSTR name, SciterNativeProperty_t* pp )
+      {
+        assert(!_def.properties); // already defined
+        SciterNativePropertyDef pd = { name, pp };
+        _properties.push_back(pd);
+        return *this;
+      }
+
+      // registers the class in the VM, can be called for many VMs
+      BOOL define( HVM vm )
+      {
+        if( !_def.methods )
+        {
+          SciterNativeMethodDef md = { 0, 0 };
+          _methods.push_back(md);
+          SciterNativePropertyDef pd = { 0, 0 };
+          _properties.push_back(pd);
+          _def.methods = &_methods[0];
+          _def.properties = &_properties[0];
+        }
+        return SciterNativeDefineClass(vm, &_def);
+      }
+
+      const SciterNativeClassDef& def() const { return _def; }
+    };
+
+}
+
+#endif
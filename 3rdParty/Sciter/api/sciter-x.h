@@ -1,5 +1,9 @@
 #ifndef __SCITER_X__
 #define __SCITER_X__
+
+#if !defined(PLATFORM_WINDOWS) && defined(_WIN32)
+  #define PLATFORM_WINDOWS
+#endif
 
 #if defined(PLATFORM_WINDOWS)
   #define WIN32_LEAN_AND_MEAN
@@ -485,17 +489,22 @@ EXTERN_C VOID SCAPI SciterSetupDebugOutput(
     };
 #endif
 
+    // behaviors that are not in the factory list, e.g. from lazily loaded modules (see sciter-x-modules.h)
+    typedef bool fallback_behavior_t( LPSCN_ATTACH_BEHAVIOR lpab );
+    inline fallback_behavior_t*& fallback_behavior() { static fallback_behavior_t* pf = 0; return pf; }
+
     // standard implementation of SCN_ATTACH_BEHAVIOR notification
     inline bool create_behavior( LPSCN_ATTACH_BEHAVIOR lpab )
     {
-      event_handler *pb = behavior_factory::create(lpab->behaviorName, lpab->element);
+      event_handler *pb = behavior_factory::create(lpab->behaviorName, lpab->element, lpab->hwnd);
       if(pb)
       {
         lpab->elementTag  = pb;
         lpab->elementProc = event_handler::element_proc;
         return true;
       }
-      return false;
+      fallback_behavior_t* pf = fallback_behavior();
+      return pf && pf(lpab);
     }
   }
 
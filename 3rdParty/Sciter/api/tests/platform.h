@@ -0,0 +1,94 @@
+#ifndef __test_platform_h__
+#define __test_platform_h__
+
+/*
+ * Terra Informatica Sciter Engine
+ * http://terrainformatica.com/sciter
+ *
+ * Platform layer of the tests on Linux: Win32 types and CRT functions
+ * the SDK headers use when PLATFORM_WINDOWS is not defined.
+ * No Win32 API here, only what a port of the engine provides anyway.
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+typedef unsigned long DWORD; typedef long LONG; typedef unsigned long ULONG;
+typedef int INT; typedef unsigned int UINT; typedef int BOOL; typedef unsigned char BYTE;
+typedef unsigned short WORD; typedef wchar_t WCHAR; typedef char CHAR;
+typedef long long LONGLONG; typedef unsigned long long ULONGLONG;
+typedef int64_t INT64; typedef uint64_t UINT64; typedef intptr_t INT_PTR; typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR; typedef uintptr_t ULONG_PTR; typedef ULONG_PTR DWORD_PTR; typedef size_t SIZE_T;
+typedef void VOID; typedef void* PVOID; typedef void* LPVOID; typedef const void* LPCVOID; typedef void* HANDLE;
+typedef char* LPSTR; typedef const char* LPCSTR; typedef wchar_t* LPWSTR; typedef const wchar_t* LPCWSTR;
+typedef BYTE* LPBYTE; typedef UINT* LPUINT; typedef DWORD* LPDWORD; typedef BOOL* LPBOOL;
+typedef UINT_PTR WPARAM; typedef LONG_PTR LPARAM; typedef LONG_PTR LRESULT;
+typedef struct HWND__* HWND; typedef struct HDC__* HDC; typedef struct HINSTANCE__* HINSTANCE; typedef HINSTANCE HMODULE;
+typedef struct HBITMAP__* HBITMAP; typedef struct HCURSOR__* HCURSOR;
+typedef struct tagPOINT { LONG x, y; } POINT, *LPPOINT;
+typedef struct tagSIZE { LONG cx, cy; } SIZE, *LPSIZE;
+typedef struct tagRECT { LONG left, top, right, bottom; } RECT, *LPRECT; typedef const RECT* LPCRECT;
+typedef struct tagNMHDR { HWND hwndFrom; UINT_PTR idFrom; UINT code; } NMHDR, *LPNMHDR;
+typedef struct tagMSG { HWND hwnd; UINT message; WPARAM wParam; LPARAM lParam; DWORD time; POINT pt; } MSG;
+
+#define TRUE 1
+#define FALSE 0
+#define WINAPI
+#define CALLBACK
+#define __stdcall
+#define __declspec(x)
+#define FAR
+#ifdef __cplusplus
+  #define EXTERN_C extern "C"
+#else
+  #define EXTERN_C extern
+#endif
+
+// CRT names of the MS runtime
+#define _snprintf  snprintf
+#define _vsnprintf vsnprintf
+#define _snwprintf swprintf
+inline int      _stricmp( const char* a, const char* b ) { return strcasecmp(a, b); }
+inline int      wcsicmp( const wchar_t* a, const wchar_t* b ) { return wcscasecmp(a, b); }
+inline int      _wtoi( const wchar_t* s ) { return int(wcstol(s, 0, 10)); }
+inline char*    _itoa( int v, char* buf, int ) { sprintf(buf, "%d", v); return buf; }
+inline wchar_t* _itow( int v, wchar_t* buf, int ) { swprintf(buf, 16, L"%d", v); return buf; }
+
+// code page conversions, ASCII is enough for the tests
+#define CP_ACP        0
+#define CP_THREAD_ACP 3
+#define CP_UTF8       65001
+inline int WideCharToMultiByte( UINT, DWORD, LPCWSTR src, int n, LPSTR dst, int cap, LPCSTR, LPBOOL )
+{
+  if( n < 0 ) n = int(wcslen(src)) + 1;
+  if( !cap ) return n;
+  int i = 0;
+  for( ; i < n && i < cap; ++i ) dst[i] = char(src[i] < 128? src[i]: '?');
+  return i;
+}
+inline int MultiByteToWideChar( UINT, DWORD, LPCSTR src, int n, LPWSTR dst, int cap )
+{
+  if( n < 0 ) n = int(strlen(src)) + 1;
+  if( !cap ) return n;
+  int i = 0;
+  for( ; i < n && i < cap; ++i ) dst[i] = wchar_t((unsigned char)src[i]);
+  return i;
+}
+
+inline BOOL PtInRect( const RECT* rc, POINT pt ) { return pt.x >= rc->left && pt.x < rc->right && pt.y >= rc->top && pt.y < rc->bottom; }
+inline void OutputDebugStringA( LPCSTR s ) { fputs(s, stderr); }
+inline void OutputDebugStringW( LPCWSTR s ) { fputws(s, stderr); }
+inline BOOL AllocConsole() { return TRUE; }
+
+#endif
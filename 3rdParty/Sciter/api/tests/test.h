@@ -0,0 +1,42 @@
+#ifndef __test_h__
+#define __test_h__
+
+/*
+ * Terra Informatica Sciter Engine
+ * http://terrainformatica.com/sciter
+ *
+ * Minimal harness of the tests: platform layer and checks.
+ *
+ * The tests are built on Linux without PLATFORM_WINDOWS, e.g.
+ *   g++ -Wno-narrowing -shared -fPIC -I. tests/test_module.cpp -o _build/test_module.so
+ *   g++ -Wno-narrowing -shared -fPIC -DTEST_MODULE_REFUSE_INIT -I. tests/test_module.cpp -o _build/test_module_refused.so
+ *   g++ -Wno-narrowing -I. tests/test_modules.cpp -ldl -lpthread -o _build/test_modules && _build/test_modules _build
+ * -Wno-narrowing: value.h switches on the UINT of ValueCompare() with case HV_OK_TRUE (-1).
+ *
+ * The code and information provided "as-is" without
+ * warranty of any kind, either expressed or implied.
+ *
+ */
+
+#include "platform.h"
+#include "sciter-x.h"
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+  do { if( !(cond) ) { ++test_failures; printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while(0)
+
+#define CHECK_EQ(a, b) \
+  do { long long va_ = (long long)(a), vb_ = (long long)(b); \
+       if( va_ != vb_ ) { ++test_failures; printf("%s(%d): CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, va_, vb_); } } while(0)
+
+inline int test_result( const char* name )
+{
+  if( test_failures ) printf("%s: %d check(s) FAILED\n", name, test_failures);
+  else printf("%s: OK\n", name);
+  return test_failures? 1: 0;
+}
+
+#endif
@@ -0,0 +1,27 @@
+// Extension module of test_modules: implements "test-counter", refuses "test-refused".
+// Built with TEST_MODULE_REFUSE_INIT its SciterInitModule fails.
+
+#include "platform.h"
+#include "sciter-x.h"
+
+static int attached = 0;
+
+static BOOL CALLBACK counter_proc( LPVOID, HELEMENT, UINT, LPVOID ) { return FALSE; }
+
+EXTERN_C __attribute__((visibility("default"))) BOOL WINAPI SciterInitModule( LPVOID pdomapi, VOID*, VOID* )
+{
+#if defined(TEST_MODULE_REFUSE_INIT)
+  return FALSE;
+#else
+  return pdomapi == 0; // this SDK has no DOM API table
+#endif
+}
+
+EXTERN_C __attribute__((visibility("default"))) BOOL WINAPI SciterBehaviorFactory( LPCSTR name, HELEMENT, ElementEventProc** pproc, LPVOID* ptag )
+{
+  if( strcmp(name, "test-counter") != 0 ) return FALSE;
+  *pproc = &counter_proc;
+  *ptag = &attached;
+  ++attached;
+  return TRUE;
+}
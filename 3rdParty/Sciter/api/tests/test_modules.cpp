@@ -0,0 +1,72 @@
+// sciter::behavior_modules: manifest, load on first use, refused behaviors and modules.
+
+#include "test.h"
+#include "sciter-x-modules.h"
+
+#include <dlfcn.h>
+
+static bool attach( sciter::behavior_modules& ms, const char* name, SCN_ATTACH_BEHAVIOR& ab )
+{
+  memset(&ab, 0, sizeof(ab));
+  ab.behaviorName = name;
+  ab.element = (HELEMENT)&ab;
+  return ms.attach(&ab);
+}
+
+static bool is_loaded( const std::string& path )
+{
+  void* h = dlopen(path.c_str(), RTLD_NOW | RTLD_NOLOAD);
+  if( h ) dlclose(h);
+  return h != 0;
+}
+
+int main( int argc, char** argv )
+{
+  std::string dir = argc > 1? argv[1]: ".";
+  {
+    FILE* f = fopen((dir + "/behaviors.manifest").c_str(), "w");
+    fputs("# module file: behavior names\n"
+          "test_module.so: test-counter, test-refused\n"
+          "test_module_refused.so: test-never\n"
+          "missing.so: test-missing\n", f);
+    fclose(f);
+  }
+
+  sciter::behavior_modules ms;
+  CHECK_EQ(ms.discover(dir.c_str()), 4);
+  CHECK_EQ(ms.modules_loaded(), 0);
+  CHECK(ms.find("test-counter") && ms.find("test-counter") == ms.find("test-refused"));
+
+  SCN_ATTACH_BEHAVIOR ab;
+  // the factory says no: loaded, but nothing attached
+  CHECK(!attach(ms, "test-refused", ab));
+  CHECK_EQ(ms.modules_loaded(), 1);
+  CHECK_EQ(ms.behaviors_attached(), 0);
+
+  CHECK(attach(ms, "test-counter", ab));
+  CHECK(ab.elementProc != 0 && ab.elementTag != 0);
+  CHECK(attach(ms, "test-counter", ab));
+  CHECK_EQ(*(int*)ab.elementTag, 2);
+  CHECK_EQ(ms.behaviors_attached(), 2);
+  CHECK(is_loaded(dir + "/test_module.so"));
+
+  // SciterInitModule refuses: the module is unloaded and not tried again
+  CHECK(!attach(ms, "test-never", ab));
+  CHECK(ms.find("test-never")->failed);
+  CHECK(ms.find("test-never")->handle == 0);
+  CHECK(!is_loaded(dir + "/test_module_refused.so"));
+  CHECK(!attach(ms, "test-never", ab));
+
+  CHECK(!attach(ms, "test-missing", ab));
+  CHECK(!attach(ms, "test-unknown", ab));
+  CHECK_EQ(ms.modules_loaded(), 1);
+
+  // installed set is consulted for names without a factory
+  ms.install();
+  CHECK(sciter::create_behavior(&ab) == false); // ab is "test-unknown"
+  ab.behaviorName = "test-counter";
+  CHECK(sciter::create_behavior(&ab));
+  ms.uninstall();
+
+  return test_result("test_modules");
+}